@@ -64,6 +64,33 @@ public:
     /// <param name="response">The http_response to send.</param>
     /// <returns>A operation which is completed once the response has been sent.</returns>
     virtual pplx::task<void> respond(http::http_response response) = 0;
+
+    /// <summary>
+    /// Stops accepting connections for an http listener, and closes its connections once their requests have been
+    /// answered.
+    /// </summary>
+    /// <param name="pListener">The listener to drain.</param>
+    /// <param name="timeout">How long to wait for the connections to close.</param>
+    /// <returns>A task that completes once the connections have closed or the timeout has passed, with the number of
+    /// requests still in progress. Servers that cannot drain complete it at once.</returns>
+    virtual pplx::task<size_t> drain(_In_ web::http::experimental::listener::details::http_listener_impl* pListener,
+                                     std::chrono::milliseconds timeout)
+    {
+        (void)pListener;
+        (void)timeout;
+        return pplx::task_from_result<size_t>(0);
+    }
+
+    /// <summary>
+    /// Gets the number of requests to an http listener that have been received and not yet answered.
+    /// </summary>
+    /// <param name="pListener">The listener whose requests are counted.</param>
+    /// <returns>The number of requests in progress, or zero if the server does not count them.</returns>
+    virtual size_t in_flight_requests(_In_ web::http::experimental::listener::details::http_listener_impl* pListener)
+    {
+        (void)pListener;
+        return 0;
+    }
 };
 
 } // namespace details
@@ -65,6 +65,20 @@ public:
     static pplx::task<void> __cdecl unregister_listener(
         _In_ web::http::experimental::listener::details::http_listener_impl* pListener);
 
+    /// <summary>
+    /// Stops accepting connections for the given listener and closes its connections once their requests have been
+    /// answered.
+    /// </summary>
+    static pplx::task<size_t> __cdecl drain(
+        _In_ web::http::experimental::listener::details::http_listener_impl* pListener,
+        std::chrono::milliseconds timeout);
+
+    /// <summary>
+    /// Gets the number of requests to the given listener that have been received and not yet answered.
+    /// </summary>
+    static size_t __cdecl in_flight_requests(
+        _In_ web::http::experimental::listener::details::http_listener_impl* pListener);
+
     /// <summary>
     /// Gets static HTTP server API. Could be null if no registered listeners.
     /// </summary>
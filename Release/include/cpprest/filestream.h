@@ -695,6 +695,11 @@ private:
     template<typename _CharType1>
     friend class ::concurrency::streams::file_buffer;
 
+#if !defined(_WIN32)
+    // Lets the library send the file without reading it through the stream buffer.
+    friend struct _file_buffer_access;
+#endif
+
     pplx::task<void> flush_internal()
     {
         pplx::task_completion_event<void> result_tce;
@@ -53,6 +53,7 @@ typedef void* native_handle;
 #include "pplx/pplxtasks.h"
 #include <limits>
 #include <memory>
+#include <stdexcept>
 
 #if _WIN32_WINNT >= _WIN32_WINNT_VISTA
 #include "cpprest/oauth1.h"
@@ -65,6 +66,7 @@ typedef void* native_handle;
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
 #endif
+#include "boost/asio/ip/tcp.hpp"
 #include "boost/asio/ssl.hpp"
 #if defined(__clang__)
 #pragma clang diagnostic pop
@@ -103,12 +105,19 @@ public:
 #endif
 #if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
         , m_tlsext_sni_enabled(true)
+        , m_dns_cache_ttl(0)
+        , m_dns_negative_cache_ttl(0)
+        , m_connection_attempt_delay(std::chrono::milliseconds(250))
 #endif
 #if (defined(_WIN32) && !defined(__cplusplus_winrt)) || defined(CPPREST_FORCE_HTTP_CLIENT_WINHTTPPAL)
         , m_buffer_request(false)
 #endif
         , m_max_redirects(10)
         , m_https_to_http_redirects(false)
+        , m_max_connections_per_host(0)
+        , m_connection_pool_wait_timeout(0)
+        , m_min_idle_connections_per_host(0)
+        , m_connection_pool_eviction_interval(std::chrono::seconds(30))
     {
     }
 
@@ -178,6 +187,8 @@ public:
     /// Set the 'guarantee order' property
     /// </summary>
     /// <param name="guarantee_order">The value of the property.</param>
+    /// <remarks>Ordering all requests sends them one at a time; to only order the requests of a logical stream, give
+    /// them the same key with http_request::set_ordering_key.</remarks>
     CASABLANCA_DEPRECATED(
         "Confusing API will be removed in future releases. If you need to order HTTP requests use task continuations.")
     void set_guarantee_order(bool guarantee_order) { m_guarantee_order = guarantee_order; }
@@ -313,6 +324,90 @@ public:
         m_https_to_http_redirects = https_to_http_redirects;
     }
 
+    /// <summary>
+    /// Get the maximum number of simultaneous connections the client opens to a single host.
+    /// A value of 0 indicates that the number of connections is not limited.
+    /// </summary>
+    /// <returns>The maximum number of connections per host.</returns>
+    size_t max_connections_per_host() const { return m_max_connections_per_host; }
+
+    /// <summary>
+    /// Set the maximum number of simultaneous connections the client opens to a single host.
+    /// Requests issued while all connections to the host are busy wait, in order, for one of them to become
+    /// available. A value of 0 indicates that the number of connections is not limited.
+    /// </summary>
+    /// <param name="max_connections">The maximum number of connections per host.</param>
+    /// <remarks>Currently only supported by the Boost.Asio based client.</remarks>
+    void set_max_connections_per_host(size_t max_connections) { m_max_connections_per_host = max_connections; }
+
+    /// <summary>
+    /// Get the time a request waits for a pooled connection when the host's connection limit is reached.
+    /// </summary>
+    /// <returns>The pool wait timeout (in whatever duration); the client timeout unless set explicitly.</returns>
+    template<class T>
+    T connection_pool_wait_timeout() const
+    {
+        return std::chrono::duration_cast<T>(m_connection_pool_wait_timeout.count() != 0
+                                                 ? m_connection_pool_wait_timeout
+                                                 : m_timeout);
+    }
+
+    /// <summary>
+    /// Set the time a request waits for a pooled connection when the host's connection limit is reached.
+    /// Requests that cannot obtain a connection in time fail with a timed out error.
+    /// </summary>
+    /// <param name="timeout">The pool wait timeout (duration from microseconds range and up); zero to use the
+    /// client timeout.</param>
+    template<class T>
+    void set_connection_pool_wait_timeout(const T& timeout)
+    {
+        m_connection_pool_wait_timeout = std::chrono::duration_cast<std::chrono::microseconds>(timeout);
+    }
+
+    /// <summary>
+    /// Get the number of idle connections the client keeps open to each host it has connected to.
+    /// </summary>
+    /// <returns>The minimum number of idle connections per host.</returns>
+    size_t min_idle_connections_per_host() const { return m_min_idle_connections_per_host; }
+
+    /// <summary>
+    /// Set the number of idle connections the client keeps open to each host it has connected to.
+    /// At every eviction interval, this many of the connections that stayed idle since the previous one are kept
+    /// unless the server has closed them, and new connections are opened until the host has this many idle ones
+    /// again. Use <c>http_client::prewarm</c> to open connections before the first request. A value of 0, the
+    /// default, opens none.
+    /// </summary>
+    /// <param name="min_idle">The minimum number of idle connections per host.</param>
+    /// <remarks>Currently only supported by the Boost.Asio based client.</remarks>
+    void set_min_idle_connections_per_host(size_t min_idle) { m_min_idle_connections_per_host = min_idle; }
+
+    /// <summary>
+    /// Get the interval at which connections that stayed idle since the previous interval are closed.
+    /// </summary>
+    /// <returns>The eviction interval (in whatever duration).</returns>
+    template<class T>
+    T connection_pool_eviction_interval() const
+    {
+        return std::chrono::duration_cast<T>(m_connection_pool_eviction_interval);
+    }
+
+    /// <summary>
+    /// Set the interval at which connections that stayed idle since the previous interval are closed.
+    /// </summary>
+    /// <param name="interval">The eviction interval (duration from microseconds range and up), 30 seconds by
+    /// default. It must be at least one microsecond.</param>
+    /// <remarks>Currently only supported by the Boost.Asio based client.</remarks>
+    template<class T>
+    void set_connection_pool_eviction_interval(const T& interval)
+    {
+        const auto converted = std::chrono::duration_cast<std::chrono::microseconds>(interval);
+        if (converted.count() <= 0)
+        {
+            throw std::invalid_argument("connection pool eviction interval must be positive");
+        }
+        m_connection_pool_eviction_interval = converted;
+    }
+
     /// <summary>
     /// Sets a callback to enable custom setting of platform specific options.
     /// </summary>
@@ -368,6 +463,9 @@ public:
     /// </summary>
     /// <param name="callback">A user callback allowing for customization of the ssl context at construction
     /// time.</param>
+    /// <remarks>The connections of a client share one ssl context, so the callback is called once, when the first
+    /// secure connection is made. The context keeps the TLS session of each host, which new connections to the host
+    /// resume.</remarks>
     void set_ssl_context_callback(const std::function<void(boost::asio::ssl::context&)>& callback)
     {
         m_ssl_context_callback = callback;
@@ -394,6 +492,97 @@ public:
     /// true otherwise.</param> <remarks>Note: This setting is enabled by default as it is required in most virtual
     /// hosting scenarios.</remarks>
     void set_tlsext_sni_enabled(bool tlsext_sni_enabled) { m_tlsext_sni_enabled = tlsext_sni_enabled; }
+
+    /// <summary>
+    /// Get the time the addresses a host name resolved to are reused by new connections.
+    /// </summary>
+    /// <returns>The DNS cache time to live (in whatever duration).</returns>
+    template<class T>
+    T dns_cache_ttl() const
+    {
+        return std::chrono::duration_cast<T>(m_dns_cache_ttl);
+    }
+
+    /// <summary>
+    /// Set the time the addresses a host name resolved to are reused by new connections.
+    /// </summary>
+    /// <param name="ttl">The DNS cache time to live (duration from microseconds range and up); zero, the default,
+    /// resolves the host name for every new connection.</param>
+    /// <remarks>Clients using the system resolver share their cache, which is keyed by host name and port.</remarks>
+    template<class T>
+    void set_dns_cache_ttl(const T& ttl)
+    {
+        m_dns_cache_ttl = std::chrono::duration_cast<std::chrono::microseconds>(ttl);
+    }
+
+    /// <summary>
+    /// Get the time a failure to resolve a host name is reported to new connections without resolving it again.
+    /// </summary>
+    /// <returns>The negative DNS cache time to live (in whatever duration).</returns>
+    template<class T>
+    T dns_negative_cache_ttl() const
+    {
+        return std::chrono::duration_cast<T>(m_dns_negative_cache_ttl);
+    }
+
+    /// <summary>
+    /// Set the time a failure to resolve a host name is reported to new connections without resolving it again.
+    /// </summary>
+    /// <param name="ttl">The negative DNS cache time to live (duration from microseconds range and up); zero, the
+    /// default, disables negative caching.</param>
+    template<class T>
+    void set_dns_negative_cache_ttl(const T& ttl)
+    {
+        m_dns_negative_cache_ttl = std::chrono::duration_cast<std::chrono::microseconds>(ttl);
+    }
+
+    /// <summary>
+    /// Get the delay after which a connection attempt that has not completed yet is raced by an attempt to the next
+    /// address of the host.
+    /// </summary>
+    /// <returns>The connection attempt delay (in whatever duration).</returns>
+    template<class T>
+    T connection_attempt_delay() const
+    {
+        return std::chrono::duration_cast<T>(m_connection_attempt_delay);
+    }
+
+    /// <summary>
+    /// Set the delay after which a connection attempt that has not completed yet is raced by an attempt to the next
+    /// address of the host. The addresses are tried alternating between IPv6 and IPv4, and the first connection
+    /// established is used, as described by RFC 8305 (Happy Eyeballs).
+    /// </summary>
+    /// <param name="delay">The connection attempt delay (duration from milliseconds range and up), 250 milliseconds
+    /// by default; zero tries the addresses one after the other.</param>
+    template<class T>
+    void set_connection_attempt_delay(const T& delay)
+    {
+        m_connection_attempt_delay = std::chrono::duration_cast<std::chrono::milliseconds>(delay);
+    }
+
+    /// <summary>
+    /// Sets a function that resolves host names in place of the system resolver.
+    /// </summary>
+    /// <param name="resolver">A function returning a task of the endpoints of a host name and port (or service
+    /// name). A task completing with no endpoints or with an exception reports that the host could not be
+    /// resolved.</param>
+    /// <remarks>The results of a client's resolver are cached separately from those of the system resolver.</remarks>
+    void set_dns_resolver(
+        const std::function<pplx::task<std::vector<boost::asio::ip::tcp::endpoint>>(const std::string&,
+                                                                                    const std::string&)>& resolver)
+    {
+        m_dns_resolver = resolver;
+    }
+
+    /// <summary>
+    /// Gets the user's function resolving host names, if any.
+    /// </summary>
+    const std::function<pplx::task<std::vector<boost::asio::ip::tcp::endpoint>>(const std::string&,
+                                                                                const std::string&)>&
+    dns_resolver() const
+    {
+        return m_dns_resolver;
+    }
 #endif
 
 private:
@@ -422,6 +611,11 @@ private:
 #if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
     std::function<void(boost::asio::ssl::context&)> m_ssl_context_callback;
     bool m_tlsext_sni_enabled;
+    std::chrono::microseconds m_dns_cache_ttl;
+    std::chrono::microseconds m_dns_negative_cache_ttl;
+    std::chrono::milliseconds m_connection_attempt_delay;
+    std::function<pplx::task<std::vector<boost::asio::ip::tcp::endpoint>>(const std::string&, const std::string&)>
+        m_dns_resolver;
 #endif
 #if (defined(_WIN32) && !defined(__cplusplus_winrt)) || defined(CPPREST_FORCE_HTTP_CLIENT_WINHTTPPAL)
     bool m_buffer_request;
@@ -429,6 +623,37 @@ private:
 
     size_t m_max_redirects;
     bool m_https_to_http_redirects;
+
+    size_t m_max_connections_per_host;
+    std::chrono::microseconds m_connection_pool_wait_timeout;
+    size_t m_min_idle_connections_per_host;
+    std::chrono::microseconds m_connection_pool_eviction_interval;
+};
+
+/// <summary>
+/// Snapshot of the connection pool counters of an <c>http_client</c>.
+/// </summary>
+struct connection_pool_stats
+{
+    connection_pool_stats() : active(0), idle(0), waiting(0), created(0), reused(0), wait_timeouts(0) {}
+
+    /// <summary>Connections currently in use by a request, or being established.</summary>
+    size_t active;
+
+    /// <summary>Connections kept alive in the pool, available for reuse.</summary>
+    size_t idle;
+
+    /// <summary>Requests queued because their host reached its connection limit.</summary>
+    size_t waiting;
+
+    /// <summary>Total number of connections opened by the client.</summary>
+    uint64_t created;
+
+    /// <summary>Total number of times a pooled connection was reused for a request.</summary>
+    uint64_t reused;
+
+    /// <summary>Total number of requests which timed out waiting for a connection.</summary>
+    uint64_t wait_timeouts;
 };
 
 class http_pipeline;
@@ -474,6 +699,23 @@ public:
     /// <returns>A reference to the client configuration object.</returns>
     _ASYNCRTIMP const http_client_config& client_config() const;
 
+    /// <summary>
+    /// Gets the current connection pool counters.
+    /// </summary>
+    /// <returns>A snapshot of the pool counters; all zero if the platform does not expose its connection
+    /// pool.</returns>
+    _ASYNCRTIMP connection_pool_stats pool_stats() const;
+
+    /// <summary>
+    /// Opens connections to the host of the base URI, and performs their TLS handshake, ahead of requests.
+    /// </summary>
+    /// <param name="count">The number of idle connections the host should have once the task completes.</param>
+    /// <returns>A task returning the number of connections opened, which is less than requested if some failed
+    /// or the connection limit of the host was reached.</returns>
+    /// <remarks>Currently only supported by the Boost.Asio based client; connections through a proxy to an
+    /// https URI are not opened ahead of requests.</remarks>
+    _ASYNCRTIMP pplx::task<size_t> prewarm(size_t count);
+
     /// <summary>
     /// Adds an HTTP pipeline stage to the client.
     /// </summary>
@@ -36,13 +36,32 @@ namespace listener
 /// <summary>
 /// Configuration class used to set various options when constructing and http_listener instance.
 /// </summary>
+/// <remarks>All listeners on a host and port use the settings of the first one opened there. Apart from the timeout,
+/// the backlog and the SSL context callback, only the Boost.Asio based listener honours them.</remarks>
 class http_listener_config
 {
 public:
     /// <summary>
     /// Create an http_listener configuration with default options.
     /// </summary>
-    http_listener_config() : m_timeout(utility::seconds(120)), m_backlog(0) {}
+    http_listener_config()
+        : m_timeout(utility::seconds(120))
+        , m_backlog(0)
+        , m_reactor_threads(0)
+        , m_offload_handlers(false)
+        , m_pipeline_depth(1)
+        , m_max_connections(0)
+        , m_max_request_body_size(0)
+        , m_request_body_buffer_size(0)
+        , m_compress_responses(false)
+        , m_compression_level(-1)
+        , m_compression_min_size(1024)
+        , m_compressible_types {_XPLATSTR("text/*"),
+                                _XPLATSTR("application/json"),
+                                _XPLATSTR("application/javascript"),
+                                _XPLATSTR("application/xml")}
+    {
+    }
 
     /// <summary>
     /// Copy constructor.
@@ -51,6 +70,17 @@ public:
     http_listener_config(const http_listener_config& other)
         : m_timeout(other.m_timeout)
         , m_backlog(other.m_backlog)
+        , m_reactor_threads(other.m_reactor_threads)
+        , m_offload_handlers(other.m_offload_handlers)
+        , m_pipeline_depth(other.m_pipeline_depth)
+        , m_max_connections(other.m_max_connections)
+        , m_max_request_body_size(other.m_max_request_body_size)
+        , m_request_body_buffer_size(other.m_request_body_buffer_size)
+        , m_compress_responses(other.m_compress_responses)
+        , m_compression_level(other.m_compression_level)
+        , m_compression_min_size(other.m_compression_min_size)
+        , m_compressible_types(other.m_compressible_types)
+        , m_compress_factories(other.m_compress_factories)
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
         , m_ssl_context_callback(other.m_ssl_context_callback)
 #endif
@@ -64,6 +94,17 @@ public:
     http_listener_config(http_listener_config&& other)
         : m_timeout(std::move(other.m_timeout))
         , m_backlog(std::move(other.m_backlog))
+        , m_reactor_threads(other.m_reactor_threads)
+        , m_offload_handlers(other.m_offload_handlers)
+        , m_pipeline_depth(other.m_pipeline_depth)
+        , m_max_connections(other.m_max_connections)
+        , m_max_request_body_size(other.m_max_request_body_size)
+        , m_request_body_buffer_size(other.m_request_body_buffer_size)
+        , m_compress_responses(other.m_compress_responses)
+        , m_compression_level(other.m_compression_level)
+        , m_compression_min_size(other.m_compression_min_size)
+        , m_compressible_types(std::move(other.m_compressible_types))
+        , m_compress_factories(std::move(other.m_compress_factories))
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
         , m_ssl_context_callback(std::move(other.m_ssl_context_callback))
 #endif
@@ -80,6 +121,17 @@ public:
         {
             m_timeout = rhs.m_timeout;
             m_backlog = rhs.m_backlog;
+            m_reactor_threads = rhs.m_reactor_threads;
+            m_offload_handlers = rhs.m_offload_handlers;
+            m_pipeline_depth = rhs.m_pipeline_depth;
+            m_max_connections = rhs.m_max_connections;
+            m_max_request_body_size = rhs.m_max_request_body_size;
+            m_request_body_buffer_size = rhs.m_request_body_buffer_size;
+            m_compress_responses = rhs.m_compress_responses;
+            m_compression_level = rhs.m_compression_level;
+            m_compression_min_size = rhs.m_compression_min_size;
+            m_compressible_types = rhs.m_compressible_types;
+            m_compress_factories = rhs.m_compress_factories;
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
             m_ssl_context_callback = rhs.m_ssl_context_callback;
 #endif
@@ -97,6 +149,17 @@ public:
         {
             m_timeout = std::move(rhs.m_timeout);
             m_backlog = std::move(rhs.m_backlog);
+            m_reactor_threads = rhs.m_reactor_threads;
+            m_offload_handlers = rhs.m_offload_handlers;
+            m_pipeline_depth = rhs.m_pipeline_depth;
+            m_max_connections = rhs.m_max_connections;
+            m_max_request_body_size = rhs.m_max_request_body_size;
+            m_request_body_buffer_size = rhs.m_request_body_buffer_size;
+            m_compress_responses = rhs.m_compress_responses;
+            m_compression_level = rhs.m_compression_level;
+            m_compression_min_size = rhs.m_compression_min_size;
+            m_compressible_types = std::move(rhs.m_compressible_types);
+            m_compress_factories = std::move(rhs.m_compress_factories);
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
             m_ssl_context_callback = std::move(rhs.m_ssl_context_callback);
 #endif
@@ -114,6 +177,8 @@ public:
     /// Set the timeout
     /// </summary>
     /// <param name="timeout">The timeout (in seconds) used for each send and receive operation on the client.</param>
+    /// <remarks>A connection that waits longer than this for a request, its headers or the next part of its body is
+    /// closed. Zero lets connections wait indefinitely.</remarks>
     void set_timeout(utility::seconds timeout) { m_timeout = std::move(timeout); }
 
     /// <summary>
@@ -130,6 +195,179 @@ public:
     /// default.</param> <remarks>The implementation may not honour this value.</remarks>
     void set_backlog(int backlog) { m_backlog = backlog; }
 
+    /// <summary>
+    /// Get the number of reactor threads
+    /// </summary>
+    /// <returns>The number of reactors serving the connections of the listener, or zero to use the shared thread
+    /// pool.</returns>
+    size_t reactor_threads() const { return m_reactor_threads; }
+
+    /// <summary>
+    /// Set the number of reactor threads
+    /// </summary>
+    /// <param name="reactor_threads">The number of reactors serving the connections of the listener, or zero to use
+    /// the shared thread pool.</param>
+    /// <remarks>Each reactor is an I/O service on a thread of its own, shared by all listeners of the process.
+    /// Connections are handed to the reactors in turn, and handlers run on the reactor that read the request.</remarks>
+    void set_reactor_threads(size_t reactor_threads) { m_reactor_threads = reactor_threads; }
+
+    /// <summary>
+    /// Get whether handlers are offloaded from the reactors
+    /// </summary>
+    /// <returns>True if the handlers of requests read by a reactor run on the shared thread pool, false if they run
+    /// on the reactor.</returns>
+    bool offload_handlers() const { return m_offload_handlers; }
+
+    /// <summary>
+    /// Set whether handlers are offloaded from the reactors
+    /// </summary>
+    /// <param name="offload_handlers">True to run the handlers of requests read by a reactor on the shared thread
+    /// pool.</param>
+    /// <remarks>A handler that blocks on its reactor stalls the other connections of that reactor, and one that waits
+    /// for the body of its own request never gets it. Such handlers need to be offloaded.</remarks>
+    void set_offload_handlers(bool offload_handlers) { m_offload_handlers = offload_handlers; }
+
+    /// <summary>
+    /// Get the pipeline depth
+    /// </summary>
+    /// <returns>The largest number of requests of one connection that may be in progress at once. The default is
+    /// one.</returns>
+    size_t pipeline_depth() const { return m_pipeline_depth; }
+
+    /// <summary>
+    /// Set the pipeline depth
+    /// </summary>
+    /// <param name="pipeline_depth">The largest number of requests of one connection that may be in progress at
+    /// once. A depth of one, or zero, handles one request at a time.</param>
+    /// <remarks>With a depth above one, handlers for requests of the same connection may run concurrently. Responses
+    /// are still sent in the order of the requests.</remarks>
+    void set_pipeline_depth(size_t pipeline_depth) { m_pipeline_depth = pipeline_depth; }
+
+    /// <summary>
+    /// Get the maximum number of connections
+    /// </summary>
+    /// <returns>The largest number of connections that may be open at once, or zero for no limit.</returns>
+    size_t max_connections() const { return m_max_connections; }
+
+    /// <summary>
+    /// Set the maximum number of connections
+    /// </summary>
+    /// <param name="max_connections">The largest number of connections that may be open at once, or zero for no
+    /// limit.</param>
+    /// <remarks>While the limit is reached no more connections are accepted, so new clients wait in the listen
+    /// backlog.</remarks>
+    void set_max_connections(size_t max_connections) { m_max_connections = max_connections; }
+
+    /// <summary>
+    /// Get the maximum request body size
+    /// </summary>
+    /// <returns>The largest request body, in bytes, that is accepted, or zero for no limit.</returns>
+    size_t max_request_body_size() const { return m_max_request_body_size; }
+
+    /// <summary>
+    /// Set the maximum request body size
+    /// </summary>
+    /// <param name="max_request_body_size">The largest request body, in bytes, that is accepted, or zero for no
+    /// limit.</param>
+    /// <remarks>A larger body is answered with 413 (Request Entity Too Large), and the connection is closed.</remarks>
+    void set_max_request_body_size(size_t max_request_body_size) { m_max_request_body_size = max_request_body_size; }
+
+    /// <summary>
+    /// Get the request body buffer size
+    /// </summary>
+    /// <returns>The number of request body bytes that may wait for the handler to read them, or zero for no
+    /// limit.</returns>
+    size_t request_body_buffer_size() const { return m_request_body_buffer_size; }
+
+    /// <summary>
+    /// Set the request body buffer size
+    /// </summary>
+    /// <param name="request_body_buffer_size">The number of request body bytes that may wait for the handler to read
+    /// them, or zero for no limit.</param>
+    /// <remarks>Reading pauses while that many bytes wait. The extract methods of http_request wait for the whole
+    /// body, so handlers that use them must reply first or only receive smaller bodies.</remarks>
+    void set_request_body_buffer_size(size_t request_body_buffer_size)
+    {
+        m_request_body_buffer_size = request_body_buffer_size;
+    }
+
+    /// <summary>
+    /// Get whether responses are compressed
+    /// </summary>
+    /// <returns>True if response bodies are compressed for clients that accept it, false otherwise.</returns>
+    bool compress_responses() const { return m_compress_responses; }
+
+    /// <summary>
+    /// Set whether responses are compressed
+    /// </summary>
+    /// <param name="compress_responses">True to compress response bodies for clients that accept it.</param>
+    /// <remarks>Compressible bodies are compressed as they are sent in chunks, with the algorithm the request's
+    /// Accept-Encoding prefers. Responses with a Content-Encoding, and partial content, are sent as they are.</remarks>
+    void set_compress_responses(bool compress_responses) { m_compress_responses = compress_responses; }
+
+    /// <summary>
+    /// Get the compression level
+    /// </summary>
+    /// <returns>The level passed to the built-in gzip and deflate compressors, or -1 for their default.</returns>
+    int compression_level() const { return m_compression_level; }
+
+    /// <summary>
+    /// Set the compression level
+    /// </summary>
+    /// <param name="compression_level">The level passed to the built-in gzip and deflate compressors, from 1 for the
+    /// fastest to 9 for the smallest output, or -1 for their default.</param>
+    void set_compression_level(int compression_level) { m_compression_level = compression_level; }
+
+    /// <summary>
+    /// Get the minimum size of compressed responses
+    /// </summary>
+    /// <returns>The Content-Length below which a response body is not compressed.</returns>
+    size_t compression_min_size() const { return m_compression_min_size; }
+
+    /// <summary>
+    /// Set the minimum size of compressed responses
+    /// </summary>
+    /// <param name="compression_min_size">The Content-Length below which a response body is not compressed. Bodies
+    /// of unknown length are always compressed.</param>
+    void set_compression_min_size(size_t compression_min_size) { m_compression_min_size = compression_min_size; }
+
+    /// <summary>
+    /// Get the compressible content types
+    /// </summary>
+    /// <returns>The media types whose bodies are compressed.</returns>
+    const std::vector<utility::string_t>& compressible_types() const { return m_compressible_types; }
+
+    /// <summary>
+    /// Set the compressible content types
+    /// </summary>
+    /// <param name="compressible_types">The media types whose bodies are compressed. A type ending in "/*", such as
+    /// "text/*", matches all of its subtypes. The default is text/*, application/json, application/javascript and
+    /// application/xml.</param>
+    void set_compressible_types(std::vector<utility::string_t> compressible_types)
+    {
+        m_compressible_types = std::move(compressible_types);
+    }
+
+    /// <summary>
+    /// Get the compress factories
+    /// </summary>
+    /// <returns>The factories of the compressors responses may be compressed with, or an empty collection for the
+    /// built-in ones.</returns>
+    const std::vector<std::shared_ptr<http::compression::compress_factory>>& compress_factories() const
+    {
+        return m_compress_factories;
+    }
+
+    /// <summary>
+    /// Set the compress factories
+    /// </summary>
+    /// <param name="compress_factories">The factories of the compressors responses may be compressed with, or an
+    /// empty collection for the built-in ones, which use the compression level.</param>
+    void set_compress_factories(std::vector<std::shared_ptr<http::compression::compress_factory>> compress_factories)
+    {
+        m_compress_factories = std::move(compress_factories);
+    }
+
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
     /// <summary>
     /// Get the callback of ssl context
@@ -154,6 +392,17 @@ public:
 private:
     utility::seconds m_timeout;
     int m_backlog;
+    size_t m_reactor_threads;
+    bool m_offload_handlers;
+    size_t m_pipeline_depth;
+    size_t m_max_connections;
+    size_t m_max_request_body_size;
+    size_t m_request_body_buffer_size;
+    bool m_compress_responses;
+    int m_compression_level;
+    size_t m_compression_min_size;
+    std::vector<utility::string_t> m_compressible_types;
+    std::vector<std::shared_ptr<http::compression::compress_factory>> m_compress_factories;
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
     std::function<void(boost::asio::ssl::context&)> m_ssl_context_callback;
 #endif
@@ -175,6 +424,9 @@ public:
     _ASYNCRTIMP pplx::task<void> open();
     _ASYNCRTIMP pplx::task<void> close();
 
+    _ASYNCRTIMP pplx::task<size_t> drain(std::chrono::milliseconds timeout);
+    _ASYNCRTIMP size_t in_flight_requests();
+
     /// <summary>
     /// Handler for all requests. The HTTP host uses this to dispatch a message to the pipeline.
     /// </summary>
@@ -216,7 +468,9 @@ public:
     /// <summary>
     /// Create a listener from a URI.
     /// </summary>
-    /// <remarks>The listener will not have been opened when returned.</remarks>
+    /// <remarks>The listener will not have been opened when returned. On Linux and OS X, a path segment of the
+    /// form <c>{name}</c>, percent-encoded in the URI, matches any single segment of a request path; its value is
+    /// available from <c>http_request::path_parameters</c>.</remarks>
     /// <param name="address">URI at which the listener should accept requests.</param>
     http_listener(http::uri address)
         : m_impl(utility::details::make_unique<details::http_listener_impl>(std::move(address)))
@@ -278,6 +532,26 @@ public:
     /// </remarks>
     pplx::task<void> close() { return m_impl->close(); }
 
+    /// <summary>
+    /// Asynchronously stop accepting connections and close the open ones once their requests have been answered.
+    /// </summary>
+    /// <param name="timeout">How long to wait for the connections to close.</param>
+    /// <returns>A task that will be completed once all the connections have closed or the timeout has passed, with the
+    /// number of requests still in progress at that point.</returns>
+    /// <remarks>Idle connections are closed at once. The responses to the requests already received are still sent,
+    /// the last one on each connection with a "Connection: close" header. The listener keeps handling those requests
+    /// until close() is called, which closes any connections that remain. Draining applies to all the listeners
+    /// opened on the same host and port, and only the Boost.Asio based listener supports it; the others complete the
+    /// task at once.</remarks>
+    pplx::task<size_t> drain(std::chrono::milliseconds timeout) { return m_impl->drain(timeout); }
+
+    /// <summary>
+    /// Gets the number of requests that have been received and not yet answered.
+    /// </summary>
+    /// <returns>The number of requests in progress on the host and port of this listener, or zero if the listener is
+    /// not open or does not count them.</returns>
+    size_t in_flight_requests() const { return m_impl->in_flight_requests(); }
+
     /// <summary>
     /// Add a general handler to support all requests.
     /// </summary>
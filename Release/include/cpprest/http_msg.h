@@ -824,9 +824,9 @@ public:
     pplx::task<http::http_response> content_ready() const
     {
         http_response resp = *this;
-        return pplx::create_task(_m_impl->_get_data_available()).then([resp](utility::size64_t) mutable {
-            return resp;
-        });
+        return pplx::create_task(_m_impl->_get_data_available())
+            .then([resp](utility::size64_t) mutable { return resp; },
+                  pplx::task_continuation_context::use_synchronous_execution());
     }
 
     std::shared_ptr<http::details::_http_response> _get_impl() const { return _m_impl; }
@@ -867,6 +867,8 @@ public:
 
     const utility::string_t& remote_address() const { return m_remote_address; }
 
+    const std::map<utility::string_t, utility::string_t>& path_parameters() const { return m_path_parameters; }
+
     const pplx::cancellation_token& cancellation_token() const { return m_cancellationToken; }
 
     void set_cancellation_token(const pplx::cancellation_token& token) { m_cancellationToken = token; }
@@ -890,6 +892,10 @@ public:
 
     const std::shared_ptr<progress_handler>& _progress_handler() const { return m_progress_handler; }
 
+    const utility::string_t& ordering_key() const { return m_ordering_key; }
+
+    void set_ordering_key(const utility::string_t& key) { m_ordering_key = key; }
+
     http::details::_http_server_context* _get_server_context() const { return m_server_context.get(); }
 
     void _set_server_context(std::unique_ptr<http::details::_http_server_context> server_context)
@@ -903,6 +909,11 @@ public:
 
     void _set_remote_address(const utility::string_t& remote_address) { m_remote_address = remote_address; }
 
+    void _set_path_parameters(std::map<utility::string_t, utility::string_t> parameters)
+    {
+        m_path_parameters = std::move(parameters);
+    }
+
 private:
     // Actual initiates sending the response, without checking if a response has already been sent.
     pplx::task<void> _reply_impl(http_response response);
@@ -927,9 +938,13 @@ private:
 
     std::shared_ptr<progress_handler> m_progress_handler;
 
+    utility::string_t m_ordering_key;
+
     pplx::task_completion_event<http_response> m_response;
 
     utility::string_t m_remote_address;
+
+    std::map<utility::string_t, utility::string_t> m_path_parameters;
 };
 
 } // namespace details
@@ -1033,6 +1048,18 @@ public:
     CASABLANCA_DEPRECATED("Use `remote_address()` instead.")
     const utility::string_t& get_remote_address() const { return _m_impl->remote_address(); }
 
+    /// <summary>
+    /// Returns the values of the parameters of the listener path that matched this request. A listener registered
+    /// for a path such as <c>/users/{id}/items</c> receives the decoded segment in place of <c>{id}</c> under the
+    /// name <c>id</c>.
+    /// </summary>
+    /// <returns>The path parameters, keyed by name. The map is empty when the listener path has no
+    /// parameters.</returns>
+    const std::map<utility::string_t, utility::string_t>& path_parameters() const
+    {
+        return _m_impl->path_parameters();
+    }
+
     /// <summary>
     /// Extract the body of the request message as a string value, checking that the content type is a MIME text type.
     /// A body can only be extracted once because in some cases an optimization is made where the data is 'moved' out.
@@ -1378,6 +1405,24 @@ public:
     /// </remarks>
     void set_progress_handler(const progress_handler& handler) { return _m_impl->set_progress_handler(handler); }
 
+    /// <summary>
+    /// Gets the key which orders this request with the others sent by the same client.
+    /// </summary>
+    /// <returns>The ordering key, empty if the request is not ordered.</returns>
+    const utility::string_t& ordering_key() const { return _m_impl->ordering_key(); }
+
+    /// <summary>
+    /// Sets the key which orders this request with the others sent by the same client.
+    /// </summary>
+    /// <param name="key">The ordering key; an empty key leaves the request unordered.</param>
+    /// <remarks>
+    ///   An http_client sends the requests which share an ordering key one at a time, in the order they were
+    ///   passed to it: each one is sent once the previous one has completed. Requests with different keys,
+    ///   and requests without one, are sent in parallel. The key is read when the request is passed to the
+    ///   client, so changing it afterwards does not affect that request.
+    /// </remarks>
+    void set_ordering_key(const utility::string_t& key) { _m_impl->set_ordering_key(key); }
+
     /// <summary>
     /// Asynchronously responses to this HTTP request.
     /// </summary>
@@ -1508,7 +1553,9 @@ public:
     pplx::task<http_request> content_ready() const
     {
         http_request req = *this;
-        return pplx::create_task(_m_impl->_get_data_available()).then([req](utility::size64_t) mutable { return req; });
+        return pplx::create_task(_m_impl->_get_data_available())
+            .then([req](utility::size64_t) mutable { return req; },
+                  pplx::task_continuation_context::use_synchronous_execution());
     }
 
     /// <summary>
@@ -1553,6 +1600,11 @@ public:
 
     void _set_listener_path(const utility::string_t& path) { _m_impl->_set_listener_path(path); }
 
+    void _set_path_parameters(std::map<utility::string_t, utility::string_t> parameters)
+    {
+        _m_impl->_set_path_parameters(std::move(parameters));
+    }
+
     const std::shared_ptr<http::details::_http_request>& _get_impl() const { return _m_impl; }
 
     void _set_cancellation_token(const pplx::cancellation_token& token) { _m_impl->set_cancellation_token(token); }
@@ -17,10 +17,14 @@
 
 #include "cpprest/asyncrt_utils.h"
 #include "cpprest/details/basic_types.h"
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <new>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -39,8 +43,149 @@ class _Boolean;
 class _String;
 class _Object;
 class _Array;
+struct _Document_node;
+class _Document_arena;
 template<typename CharType>
 class JSON_Parser;
+
+/// <summary>
+/// Owning pointer to the _Value behind a json::value. Null, boolean, number and string values are constructed inside
+/// the pointer's own buffer, and short strings keep their characters there too, so they need no separate heap
+/// allocation. Objects and arrays are always allocated on the heap, so that references returned by as_object() and
+/// as_array() stay valid when the owning value is moved.
+/// </summary>
+/// <remarks>The buffer makes a json::value larger than a single pointer (40 bytes instead of 8 on 64-bit platforms),
+/// which changes the binary layout of json::value and of the containers holding it.</remarks>
+class _Value_ptr
+{
+public:
+    _Value_ptr() CPPREST_NOEXCEPT : m_ptr(nullptr) {}
+
+    explicit _Value_ptr(std::unique_ptr<_Value> value) CPPREST_NOEXCEPT : m_ptr(value.release()) {}
+
+    _Value_ptr(_Value_ptr&& other) CPPREST_NOEXCEPT : m_ptr(nullptr) { take(other); }
+
+    _Value_ptr& operator=(_Value_ptr&& other) CPPREST_NOEXCEPT
+    {
+        if (this != &other)
+        {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    ~_Value_ptr() { reset(); }
+
+    template<typename _Type>
+    static _Value_ptr make()
+    {
+        _Value_ptr result;
+        result.m_ptr = new (result.allocate<_Type>()) _Type();
+        return result;
+    }
+
+    template<typename _Type, typename _Arg1>
+    static _Value_ptr make(_Arg1&& arg1)
+    {
+        _Value_ptr result;
+        void* storage = result.allocate<_Type>();
+        result.m_ptr = construct<_Type>(storage, std::forward<_Arg1>(arg1));
+        return result;
+    }
+
+    template<typename _Type, typename _Arg1, typename _Arg2>
+    static _Value_ptr make(_Arg1&& arg1, _Arg2&& arg2)
+    {
+        _Value_ptr result;
+        void* storage = result.allocate<_Type>();
+        result.m_ptr = construct<_Type>(storage, std::forward<_Arg1>(arg1), std::forward<_Arg2>(arg2));
+        return result;
+    }
+
+    _Value* get() const CPPREST_NOEXCEPT { return m_ptr; }
+    _Value* operator->() const CPPREST_NOEXCEPT { return m_ptr; }
+    _Value& operator*() const CPPREST_NOEXCEPT { return *m_ptr; }
+
+    void swap(_Value_ptr& other) CPPREST_NOEXCEPT
+    {
+        _Value_ptr temp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(temp);
+    }
+
+private:
+    // Large enough for the vtable pointer and members of _Null, _Boolean, _Number and _String.
+    typedef std::aligned_storage<2 * sizeof(void*) + 2 * sizeof(double), std::alignment_of<double>::value>::type
+        storage_type;
+
+    template<typename _Type>
+    struct is_stored_in_place
+    {
+        static const bool value = !std::is_same<_Type, _Object>::value && !std::is_same<_Type, _Array>::value &&
+                                  sizeof(_Type) <= sizeof(storage_type) &&
+                                  std::alignment_of<_Type>::value <= std::alignment_of<storage_type>::value;
+    };
+
+    bool is_in_place() const CPPREST_NOEXCEPT
+    {
+        return static_cast<const void*>(m_ptr) == static_cast<const void*>(&m_storage);
+    }
+
+    // Returns the memory a _Type should be constructed in; heap memory is released by construct() if the constructor
+    // throws.
+    template<typename _Type>
+    void* allocate()
+    {
+        return is_stored_in_place<_Type>::value ? static_cast<void*>(&m_storage) : ::operator new(sizeof(_Type));
+    }
+
+    template<typename _Type, typename _Arg1>
+    static _Value* construct(void* storage, _Arg1&& arg1)
+    {
+        try
+        {
+            return new (storage) _Type(std::forward<_Arg1>(arg1));
+        }
+        catch (...)
+        {
+            deallocate<_Type>(storage);
+            throw;
+        }
+    }
+
+    template<typename _Type, typename _Arg1, typename _Arg2>
+    static _Value* construct(void* storage, _Arg1&& arg1, _Arg2&& arg2)
+    {
+        try
+        {
+            return new (storage) _Type(std::forward<_Arg1>(arg1), std::forward<_Arg2>(arg2));
+        }
+        catch (...)
+        {
+            deallocate<_Type>(storage);
+            throw;
+        }
+    }
+
+    template<typename _Type>
+    static void deallocate(void* storage) CPPREST_NOEXCEPT
+    {
+        if (!is_stored_in_place<_Type>::value)
+        {
+            ::operator delete(storage);
+        }
+    }
+
+    inline void take(_Value_ptr& other) CPPREST_NOEXCEPT;
+    inline void reset() CPPREST_NOEXCEPT;
+
+    _Value* m_ptr;
+    storage_type m_storage;
+
+    _Value_ptr(const _Value_ptr&);
+    _Value_ptr& operator=(const _Value_ptr&);
+};
 } // namespace details
 
 namespace details
@@ -65,6 +210,8 @@ void _ASYNCRTIMP __cdecl keep_object_element_order(bool keep_order);
 class number;
 class array;
 class object;
+class document_value;
+class writer;
 
 /// <summary>
 /// A JSON value represented as a C++ class.
@@ -722,6 +869,7 @@ private:
     friend class web::json::details::_Array;
     template<typename CharType>
     friend class web::json::details::JSON_Parser;
+    friend class web::json::writer;
 
 #ifdef _WIN32
     /// <summary>
@@ -737,14 +885,14 @@ private:
     _ASYNCRTIMP void format(std::basic_string<char>& string) const;
 
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
-    explicit value(std::unique_ptr<details::_Value> v, value_type kind) : m_value(std::move(v)), m_kind(kind)
+    explicit value(details::_Value_ptr v, value_type kind) : m_value(std::move(v)), m_kind(kind)
 #else
-    explicit value(std::unique_ptr<details::_Value> v) : m_value(std::move(v))
+    explicit value(details::_Value_ptr v) : m_value(std::move(v))
 #endif
     {
     }
 
-    std::unique_ptr<details::_Value> m_value;
+    details::_Value_ptr m_value;
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     value_type m_kind;
 #endif
@@ -998,13 +1146,28 @@ public:
     typedef storage_type::size_type size_type;
 
 private:
-    object(bool keep_order = false) : m_elements(), m_keep_order(keep_order) {}
-    object(storage_type elements, bool keep_order = false) : m_elements(std::move(elements)), m_keep_order(keep_order)
+    object(bool keep_order = false)
+        : m_elements()
+        , m_keep_order(keep_order)
+        , m_indexed(false)
+        , m_index_used(0)
+        , m_index_stale(false)
+        , m_stale_lookups(0)
+    {
+    }
+    object(storage_type elements, bool keep_order = false)
+        : m_elements(std::move(elements))
+        , m_keep_order(keep_order)
+        , m_indexed(false)
+        , m_index_used(0)
+        , m_index_stale(false)
+        , m_stale_lookups(0)
     {
         if (!keep_order)
         {
             sort(m_elements.begin(), m_elements.end(), compare_pairs);
         }
+        rebuild_index();
     }
 
 public:
@@ -1012,7 +1175,7 @@ public:
     /// Gets the beginning iterator element of the object
     /// </summary>
     /// <returns>An <c>iterator</c> to the beginning of the JSON object.</returns>
-    iterator begin() { return m_elements.begin(); }
+    iterator begin() { return elements_for_update().begin(); }
 
     /// <summary>
     /// Gets the beginning const iterator element of the object.
@@ -1024,7 +1187,7 @@ public:
     /// Gets the end iterator element of the object
     /// </summary>
     /// <returns>An <c>iterator</c> to the end of the JSON object.</returns>
-    iterator end() { return m_elements.end(); }
+    iterator end() { return elements_for_update().end(); }
 
     /// <summary>
     /// Gets the end const iterator element of the object.
@@ -1036,7 +1199,7 @@ public:
     /// Gets the beginning reverse iterator element of the object
     /// </summary>
     /// <returns>An <c>reverse_iterator</c> to the beginning of the JSON object.</returns>
-    reverse_iterator rbegin() { return m_elements.rbegin(); }
+    reverse_iterator rbegin() { return elements_for_update().rbegin(); }
 
     /// <summary>
     /// Gets the beginning const reverse iterator element of the object
@@ -1048,7 +1211,7 @@ public:
     /// Gets the end reverse iterator element of the object
     /// </summary>
     /// <returns>An <c>reverse_iterator</c> to the end of the JSON object.</returns>
-    reverse_iterator rend() { return m_elements.rend(); }
+    reverse_iterator rend() { return elements_for_update().rend(); }
 
     /// <summary>
     /// Gets the end const reverse iterator element of the object
@@ -1087,7 +1250,11 @@ public:
     /// <returns>Iterator to the new location of the element following the erased element.</returns>
     /// <remarks>GCC doesn't support erase with const_iterator on vector yet. In the future this should be
     /// changed.</remarks>
-    iterator erase(iterator position) { return m_elements.erase(position); }
+    iterator erase(iterator position)
+    {
+        index_erase(static_cast<size_type>(position - m_elements.begin()));
+        return m_elements.erase(position);
+    }
 
     /// <summary>
     /// Deletes an element of the JSON object. If the key doesn't exist, this method throws.
@@ -1101,7 +1268,7 @@ public:
             throw web::json::json_exception("Key not found");
         }
 
-        m_elements.erase(iter);
+        erase(iter);
     }
 
     /// <summary>
@@ -1148,7 +1315,8 @@ public:
 
         if (iter == m_elements.end() || key != iter->first)
         {
-            return m_elements.insert(iter, std::pair<utility::string_t, value>(key, value()))->second;
+            iter = m_elements.insert(iter, std::pair<utility::string_t, value>(key, value()));
+            index_insert(static_cast<size_type>(iter - m_elements.begin()));
         }
 
         return iter->second;
@@ -1173,6 +1341,25 @@ public:
     /// <returns>True if empty.</returns>
     bool empty() const { return m_elements.empty(); }
 
+    /// <summary>
+    /// Sets whether the object keeps a hash index of its keys. Objects with at least <c>index_threshold</c> elements
+    /// always keep one; this enables it for smaller objects that are looked up often.
+    /// </summary>
+    /// <remarks>The index maps keys to positions and checks the key found at a position, so it stays usable while
+    /// elements are changed through mutable iterators. Until it is rebuilt, keys it does not find are searched for
+    /// without it.</remarks>
+    /// <param name="indexed">True to keep an index regardless of size.</param>
+    void set_indexed(bool indexed)
+    {
+        m_indexed = indexed;
+        rebuild_index();
+    }
+
+    /// <summary>
+    /// The number of elements from which an object keeps a hash index of its keys, making lookups constant time.
+    /// </summary>
+    static const size_type index_threshold = 32;
+
 private:
     static bool compare_pairs(const std::pair<utility::string_t, value>& p1,
                               const std::pair<utility::string_t, value>& p2)
@@ -1186,6 +1373,20 @@ private:
 
     storage_type::iterator find_insert_location(const utility::string_t& key)
     {
+        refresh_index();
+        if (!m_index.empty())
+        {
+            const size_type position = index_find(key);
+            if (position != m_elements.size())
+            {
+                return m_elements.begin() + position;
+            }
+            if (m_keep_order && !m_index_stale)
+            {
+                return m_elements.end();
+            }
+        }
+
         if (m_keep_order)
         {
             return std::find_if(m_elements.begin(),
@@ -1200,6 +1401,15 @@ private:
 
     storage_type::const_iterator find_by_key(const utility::string_t& key) const
     {
+        if (!m_index.empty())
+        {
+            const size_type position = index_find(key);
+            if (position != m_elements.size() || !m_index_stale)
+            {
+                return m_elements.begin() + position;
+            }
+        }
+
         if (m_keep_order)
         {
             return std::find_if(m_elements.begin(),
@@ -1227,8 +1437,152 @@ private:
         return iter;
     }
 
+    // The hash index is an open addressing table with linear probing. Each slot holds the position of an element in
+    // m_elements plus one, or zero when empty, and a lookup only trusts a slot whose element has the key looked for.
+    // Changes that move elements, such as a sorted insertion, an erase or a mutable iteration, leave the slots in place
+    // and mark the index stale: it still finds the elements that did not move, and keys it misses are searched for
+    // without it until refresh_index() rebuilds it. Const lookups never modify the object.
+    static size_type hash_key(const utility::string_t& key) { return std::hash<utility::string_t>()(key); }
+
+    bool wants_index() const { return m_indexed || m_elements.size() >= index_threshold; }
+
+    storage_type& elements_for_update()
+    {
+        m_index_stale = !m_index.empty();
+        return m_elements;
+    }
+
+    void clear_index()
+    {
+        m_index.clear();
+        m_index_used = 0;
+        m_index_stale = false;
+        m_stale_lookups = 0;
+    }
+
+    void rebuild_index()
+    {
+        clear_index();
+        if (!wants_index())
+        {
+            return;
+        }
+
+        size_type capacity = 16;
+        while (capacity < m_elements.size() * 2)
+        {
+            capacity *= 2;
+        }
+        m_index.assign(capacity, 0);
+        for (size_type position = 0; position < m_elements.size(); ++position)
+        {
+            index_place(position);
+        }
+    }
+
+    // Called by non-const lookups. Keep-order objects would search a stale index's misses linearly, so it is rebuilt
+    // at once; sorted objects search them with a binary search, so it is rebuilt after as many lookups as there are
+    // elements. Either way the rebuild costs no more than the lookups it speeds up.
+    void refresh_index()
+    {
+        if (m_index_stale && (m_keep_order || ++m_stale_lookups >= m_elements.size()))
+        {
+            rebuild_index();
+        }
+    }
+
+    void index_place(size_type position)
+    {
+        const size_type mask = m_index.size() - 1;
+        size_type slot = hash_key(m_elements[position].first) & mask;
+        while (m_index[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        m_index[slot] = position + 1;
+        ++m_index_used;
+    }
+
+    // Returns the position of key in m_elements, or m_elements.size() if the index does not find it.
+    size_type index_find(const utility::string_t& key) const
+    {
+        const size_type mask = m_index.size() - 1;
+        for (size_type slot = hash_key(key) & mask; m_index[slot] != 0; slot = (slot + 1) & mask)
+        {
+            const size_type position = m_index[slot] - 1;
+            if (position < m_elements.size() && m_elements[position].first == key)
+            {
+                return position;
+            }
+        }
+        return m_elements.size();
+    }
+
+    // Called after an element was inserted at position.
+    void index_insert(size_type position)
+    {
+        if (m_index.empty() || (m_index_used + 1) * 2 > m_index.size())
+        {
+            rebuild_index();
+            return;
+        }
+
+        if (position + 1 != m_elements.size())
+        {
+            // A sorted insertion moved the following elements up by one.
+            m_index_stale = true;
+        }
+        index_place(position);
+    }
+
+    // Called before the element at position is erased.
+    void index_erase(size_type position)
+    {
+        if (m_index.empty())
+        {
+            return;
+        }
+        if (!m_indexed && m_elements.size() - 1 < index_threshold)
+        {
+            clear_index();
+            return;
+        }
+        if (m_index_stale || position + 1 != m_elements.size())
+        {
+            // The following elements move down by one.
+            m_index_stale = true;
+            return;
+        }
+
+        // The last element of a current index is removed from the table. Backward shift deletion: later members of
+        // the probe sequence move into the hole, so that no lookup stops early at it.
+        const size_type mask = m_index.size() - 1;
+        size_type hole = hash_key(m_elements[position].first) & mask;
+        while (m_index[hole] != position + 1)
+        {
+            hole = (hole + 1) & mask;
+        }
+        for (size_type slot = (hole + 1) & mask; m_index[slot] != 0; slot = (slot + 1) & mask)
+        {
+            const size_type home = hash_key(m_elements[m_index[slot] - 1].first) & mask;
+            const bool movable = hole <= slot ? (home <= hole || home > slot) : (home <= hole && home > slot);
+            if (movable)
+            {
+                m_index[hole] = m_index[slot];
+                hole = slot;
+            }
+        }
+        m_index[hole] = 0;
+        --m_index_used;
+    }
+
     storage_type m_elements;
     bool m_keep_order;
+    bool m_indexed;
+    std::vector<size_type> m_index;
+    size_type m_index_used;
+    bool m_index_stale;
+    size_type m_stale_lookups;
     friend class details::_Object;
 
     template<typename CharType>
@@ -1393,6 +1747,7 @@ private:
     } m_type;
 
     friend class details::_Number;
+    friend class json::document_value;
 };
 
 namespace details
@@ -1400,7 +1755,10 @@ namespace details
 class _Value
 {
 public:
-    virtual std::unique_ptr<_Value> _copy_value() = 0;
+    virtual _Value_ptr _copy_value() = 0;
+
+    // Move constructs this value into storage owned by a _Value_ptr.
+    virtual _Value* _move_to(void* storage) CPPREST_NOEXCEPT = 0;
 
     virtual bool has_field(const utility::string_t&) const { return false; }
     virtual value get_field(const utility::string_t&) const { throw json_exception("not an object"); }
@@ -1458,7 +1816,9 @@ private:
 class _Null : public _Value
 {
 public:
-    virtual std::unique_ptr<_Value> _copy_value() { return utility::details::make_unique<_Null>(); }
+    virtual _Value_ptr _copy_value() { return _Value_ptr::make<_Null>(); }
+
+    virtual _Value* _move_to(void* storage) CPPREST_NOEXCEPT { return new (storage) _Null(std::move(*this)); }
     virtual json::value::value_type type() const { return json::value::Null; }
 };
 
@@ -1473,7 +1833,9 @@ public:
     _Number(long long value) : m_number(value) {}
     _Number(unsigned long long value) : m_number(value) {}
 
-    virtual std::unique_ptr<_Value> _copy_value() { return utility::details::make_unique<_Number>(*this); }
+    virtual _Value_ptr _copy_value() { return _Value_ptr::make<_Number>(*this); }
+
+    virtual _Value* _move_to(void* storage) CPPREST_NOEXCEPT { return new (storage) _Number(std::move(*this)); }
 
     virtual json::value::value_type type() const { return json::value::Number; }
 
@@ -1503,7 +1865,9 @@ class _Boolean : public _Value
 public:
     _Boolean(bool value) : m_value(value) {}
 
-    virtual std::unique_ptr<_Value> _copy_value() { return utility::details::make_unique<_Boolean>(*this); }
+    virtual _Value_ptr _copy_value() { return _Value_ptr::make<_Boolean>(*this); }
+
+    virtual _Value* _move_to(void* storage) CPPREST_NOEXCEPT { return new (storage) _Boolean(std::move(*this)); }
 
     virtual json::value::value_type type() const { return json::value::Boolean; }
 
@@ -1524,23 +1888,43 @@ private:
 class _String : public _Value
 {
 public:
-    _String(utility::string_t value) : m_string(std::move(value)) { m_has_escape_char = has_escape_chars(*this); }
-    _String(utility::string_t value, bool escaped_chars) : m_string(std::move(value)), m_has_escape_char(escaped_chars)
-    {
-    }
+    _String(utility::string_t value) { assign(std::move(value), has_escape_chars(value)); }
+    _String(utility::string_t value, bool escaped_chars) { assign(std::move(value), escaped_chars); }
 
 #ifdef _WIN32
-    _String(std::string&& value) : m_string(utility::conversions::to_utf16string(std::move(value)))
+    _String(std::string&& value)
     {
-        m_has_escape_char = has_escape_chars(*this);
+        utility::string_t converted = utility::conversions::to_utf16string(std::move(value));
+        const bool escaped_chars = has_escape_chars(converted);
+        assign(std::move(converted), escaped_chars);
     }
     _String(std::string&& value, bool escape_chars)
-        : m_string(utility::conversions::to_utf16string(std::move(value))), m_has_escape_char(escape_chars)
     {
+        assign(utility::conversions::to_utf16string(std::move(value)), escape_chars);
     }
 #endif
 
-    virtual std::unique_ptr<_Value> _copy_value() { return utility::details::make_unique<_String>(*this); }
+    _String(const _String& other)
+        : m_long(other.is_short() ? nullptr : new utility::string_t(*other.m_long.load(std::memory_order_relaxed)))
+        , m_short_size(other.m_short_size)
+        , m_has_escape_char(other.m_has_escape_char)
+    {
+        if (is_short()) std::copy(other.m_short, other.m_short + m_short_size, m_short);
+    }
+
+    // A materialized as_string() result moves along with the value, so references to it stay valid.
+    _String(_String&& other) CPPREST_NOEXCEPT : m_long(other.m_long.exchange(nullptr, std::memory_order_relaxed)),
+                                                m_short_size(other.m_short_size),
+                                                m_has_escape_char(other.m_has_escape_char)
+    {
+        if (is_short()) std::copy(other.m_short, other.m_short + m_short_size, m_short);
+    }
+
+    virtual ~_String() { delete m_long.load(std::memory_order_relaxed); }
+
+    virtual _Value_ptr _copy_value() { return _Value_ptr::make<_String>(*this); }
+
+    virtual _Value* _move_to(void* storage) CPPREST_NOEXCEPT { return new (storage) _String(std::move(*this)); }
 
     virtual json::value::value_type type() const { return json::value::String; }
 
@@ -1561,7 +1945,34 @@ private:
     friend class _Object;
     friend class _Array;
 
-    size_t get_reserve_size() const { return m_string.size() + 2; }
+    _String& operator=(const _String&);
+
+    // Strings of up to short_capacity characters are kept in m_short, which together with m_long, m_short_size and
+    // m_has_escape_char fills a _Value_ptr buffer.
+    static const size_t short_capacity = (2 * sizeof(double) - 2) / sizeof(utility::char_t);
+    static const unsigned char long_string = 0xFF;
+
+    void assign(utility::string_t&& value, bool escaped_chars)
+    {
+        m_has_escape_char = escaped_chars;
+        if (value.size() <= short_capacity)
+        {
+            std::copy(value.begin(), value.end(), m_short);
+            m_short_size = static_cast<unsigned char>(value.size());
+            m_long.store(nullptr, std::memory_order_relaxed);
+        }
+        else
+        {
+            m_short_size = long_string;
+            m_long.store(new utility::string_t(std::move(value)), std::memory_order_relaxed);
+        }
+    }
+
+    bool is_short() const { return m_short_size != long_string; }
+
+    size_t size() const { return is_short() ? m_short_size : m_long.load(std::memory_order_relaxed)->size(); }
+
+    size_t get_reserve_size() const { return size() + 2; }
 
     template<typename CharType>
     void serialize_impl_char_type(std::basic_string<CharType>& str) const
@@ -1575,12 +1986,16 @@ private:
     std::string as_utf8_string() const;
     utf16string as_utf16_string() const;
 
-    utility::string_t m_string;
+    // Long strings live here from construction. For short strings this is null until the first as_string() call
+    // copies the characters into a heap string, whose address stays stable when the value is moved.
+    mutable std::atomic<utility::string_t*> m_long;
+    utility::char_t m_short[short_capacity];
+    unsigned char m_short_size;
 
     // There are significant performance gains that can be made by knowing whether
     // or not a character that requires escaping is present.
     bool m_has_escape_char;
-    static bool has_escape_chars(const _String& str);
+    static bool has_escape_chars(const utility::string_t& str);
 };
 
 template<typename CharType>
@@ -1598,7 +2013,9 @@ public:
     _Object(bool keep_order) : m_object(keep_order) {}
     _Object(object::storage_type fields, bool keep_order) : m_object(std::move(fields), keep_order) {}
 
-    virtual std::unique_ptr<_Value> _copy_value() { return utility::details::make_unique<_Object>(*this); }
+    virtual _Value_ptr _copy_value() { return _Value_ptr::make<_Object>(*this); }
+
+    virtual _Value* _move_to(void* storage) CPPREST_NOEXCEPT { return new (storage) _Object(std::move(*this)); }
 
     virtual json::object& as_object() { return m_object; }
 
@@ -1700,7 +2117,9 @@ public:
     _Array(array::size_type size) : m_array(size) {}
     _Array(array::storage_type elements) : m_array(std::move(elements)) {}
 
-    virtual std::unique_ptr<_Value> _copy_value() { return utility::details::make_unique<_Array>(*this); }
+    virtual _Value_ptr _copy_value() { return _Value_ptr::make<_Array>(*this); }
+
+    virtual _Value* _move_to(void* storage) CPPREST_NOEXCEPT { return new (storage) _Array(std::move(*this)); }
 
     virtual json::value::value_type type() const { return json::value::Array; }
 
@@ -1786,6 +2205,32 @@ private:
         return reserveSize;
     }
 };
+inline void _Value_ptr::take(_Value_ptr& other) CPPREST_NOEXCEPT
+{
+    if (other.is_in_place())
+    {
+        m_ptr = other.m_ptr->_move_to(&m_storage);
+        other.reset();
+    }
+    else
+    {
+        m_ptr = other.m_ptr;
+        other.m_ptr = nullptr;
+    }
+}
+
+inline void _Value_ptr::reset() CPPREST_NOEXCEPT
+{
+    if (is_in_place())
+    {
+        m_ptr->~_Value();
+    }
+    else
+    {
+        delete m_ptr;
+    }
+    m_ptr = nullptr;
+}
 } // namespace details
 
 /// <summary>
@@ -1815,6 +2260,314 @@ inline json::value json::value::get(const utility::string_t& key) const { return
 /// <returns>The value kept at the array index; null if outside the boundaries of the array</returns>
 inline json::value json::value::get(size_t index) const { return m_value->get_element(index); }
 
+namespace details
+{
+/// <summary>
+/// Monotonic allocator behind a json::document. Memory is carved out of large blocks and is only released, all at once,
+/// when the arena is destroyed.
+/// </summary>
+class _Document_arena
+{
+public:
+    _Document_arena() : m_next(nullptr), m_remaining(0) {}
+
+    // Returns uninitialized memory suitably aligned for any document node.
+    void* allocate(size_t size);
+
+private:
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_next;
+    size_t m_remaining;
+
+    _Document_arena(const _Document_arena&);
+    _Document_arena& operator=(const _Document_arena&);
+};
+
+struct _Document_field;
+
+/// <summary>
+/// A value inside a json::document. Nodes, their strings and their children all live in the document's arena and are
+/// never destroyed individually.
+/// </summary>
+struct _Document_node
+{
+    enum number_kind
+    {
+        double_number,
+        signed_number,
+        unsigned_number
+    };
+
+    json::value::value_type m_type;
+
+    // The number_kind of a number.
+    unsigned char m_number_kind;
+
+    // Whether the fields of an object are sorted by name, so they can be binary searched.
+    bool m_sorted;
+
+    // Number of characters of a string, elements of an array or fields of an object.
+    size_t m_size;
+
+    union {
+        bool m_boolean;
+        double m_double;
+        int64_t m_signed;
+        uint64_t m_unsigned;
+        const utility::char_t* m_string;
+        const _Document_node* m_elements;
+        const _Document_field* m_fields;
+    };
+};
+
+struct _Document_field
+{
+    const utility::char_t* m_name;
+    size_t m_name_size;
+    _Document_node m_value;
+
+    // Orders names the same way as the keys of a sorted json::object.
+    static bool name_less(const utility::char_t* left, size_t leftSize, const utility::char_t* right, size_t rightSize)
+    {
+        const int result = utility::string_t::traits_type::compare(left, right, (std::min)(leftSize, rightSize));
+        return result < 0 || (result == 0 && leftSize < rightSize);
+    }
+};
+} // namespace details
+
+/// <summary>
+/// A read-only reference to a value inside a <c>json::document</c>. It offers the read accessors of <c>json::value</c>
+/// and stays valid for as long as the document that owns it.
+/// </summary>
+class document_value
+{
+public:
+    /// <summary>
+    /// Accesses the type of JSON value the current value instance is.
+    /// </summary>
+    /// <returns>The value's type</returns>
+    json::value::value_type type() const { return m_node->m_type; }
+
+    /// <summary>
+    /// Is the current value a null value?
+    /// </summary>
+    /// <returns><c>true</c> if the value is a null value, <c>false</c> otherwise</returns>
+    bool is_null() const { return type() == json::value::Null; }
+
+    /// <summary>
+    /// Is the current value a number value?
+    /// </summary>
+    /// <returns><c>true</c> if the value is a number value, <c>false</c> otherwise</returns>
+    bool is_number() const { return type() == json::value::Number; }
+
+    /// <summary>
+    /// Is the current value represented as an integer number value?
+    /// </summary>
+    /// <returns><c>true</c> if the value is an integer number value, <c>false</c> otherwise</returns>
+    bool is_integer() const { return is_number() && m_node->m_number_kind != details::_Document_node::double_number; }
+
+    /// <summary>
+    /// Is the current value represented as a double number value?
+    /// </summary>
+    /// <returns><c>true</c> if the value is a double number value, <c>false</c> otherwise</returns>
+    bool is_double() const { return is_number() && m_node->m_number_kind == details::_Document_node::double_number; }
+
+    /// <summary>
+    /// Is the current value a Boolean value?
+    /// </summary>
+    /// <returns><c>true</c> if the value is a Boolean value, <c>false</c> otherwise</returns>
+    bool is_boolean() const { return type() == json::value::Boolean; }
+
+    /// <summary>
+    /// Is the current value a string value?
+    /// </summary>
+    /// <returns><c>true</c> if the value is a string value, <c>false</c> otherwise</returns>
+    bool is_string() const { return type() == json::value::String; }
+
+    /// <summary>
+    /// Is the current value an array?
+    /// </summary>
+    /// <returns><c>true</c> if the value is an array, <c>false</c> otherwise</returns>
+    bool is_array() const { return type() == json::value::Array; }
+
+    /// <summary>
+    /// Is the current value an object?
+    /// </summary>
+    /// <returns><c>true</c> if the value is an object, <c>false</c> otherwise</returns>
+    bool is_object() const { return type() == json::value::Object; }
+
+    /// <summary>
+    /// Gets the number of children of the value.
+    /// </summary>
+    /// <returns>The number of children. 0 for all non-composites.</returns>
+    size_t size() const { return (is_array() || is_object()) ? m_node->m_size : 0; }
+
+    /// <summary>
+    /// Converts the JSON value to a JSON number.
+    /// </summary>
+    /// <returns>The JSON number.</returns>
+    _ASYNCRTIMP json::number as_number() const;
+
+    /// <summary>
+    /// Converts the JSON value to a C++ double, if and only if it is a number value.
+    /// </summary>
+    /// <returns>A double representation of the value</returns>
+    _ASYNCRTIMP double as_double() const;
+
+    /// <summary>
+    /// Converts the JSON value to a C++ integer, if and only if it is a number value.
+    /// </summary>
+    /// <returns>An integer representation of the value</returns>
+    _ASYNCRTIMP int as_integer() const;
+
+    /// <summary>
+    /// Converts the JSON value to a C++ bool, if and only if it is a Boolean value.
+    /// </summary>
+    /// <returns>A C++ bool representation of the value</returns>
+    _ASYNCRTIMP bool as_bool() const;
+
+    /// <summary>
+    /// Converts the JSON value to a C++ STL string, if and only if it is a string value.
+    /// </summary>
+    /// <returns>A C++ STL string representation of the value</returns>
+    _ASYNCRTIMP utility::string_t as_string() const;
+
+    /// <summary>
+    /// Tests for the presence of a field.
+    /// </summary>
+    /// <param name="key">The name of the field</param>
+    /// <returns>True if the field exists, false otherwise.</returns>
+    _ASYNCRTIMP bool has_field(const utility::string_t& key) const;
+
+    /// <summary>
+    /// Accesses a field of a JSON object.
+    /// </summary>
+    /// <param name="key">The name of the field</param>
+    /// <returns>The value kept in the field.</returns>
+    /// <exception cref="json_exception">If the value is not an object or the field does not exist.</exception>
+    _ASYNCRTIMP document_value at(const utility::string_t& key) const;
+
+    /// <summary>
+    /// Accesses an element of a JSON array.
+    /// </summary>
+    /// <param name="index">The index of an element in the JSON array.</param>
+    /// <returns>The value kept at the array index.</returns>
+    /// <exception cref="json_exception">If the value is not an array or the index is out of range.</exception>
+    _ASYNCRTIMP document_value at(size_t index) const;
+
+    /// <summary>
+    /// Accesses the name of a field of a JSON object by position.
+    /// </summary>
+    /// <param name="index">The position of the field, less than <c>size()</c>.</param>
+    /// <returns>The name of the field.</returns>
+    _ASYNCRTIMP utility::string_t field_name(size_t index) const;
+
+    /// <summary>
+    /// Accesses the value of a field of a JSON object by position.
+    /// </summary>
+    /// <param name="index">The position of the field, less than <c>size()</c>.</param>
+    /// <returns>The value kept in the field.</returns>
+    _ASYNCRTIMP document_value field_value(size_t index) const;
+
+    /// <summary>
+    /// Copies this value and all of its children into a <c>json::value</c>.
+    /// </summary>
+    /// <returns>A JSON value equal to this one.</returns>
+    _ASYNCRTIMP json::value to_value() const;
+
+private:
+    friend class document;
+
+    explicit document_value(const details::_Document_node* node) : m_node(node) {}
+
+    const details::_Document_field& field(size_t index) const;
+
+    const details::_Document_node* m_node;
+};
+
+/// <summary>
+/// A read-only JSON document. All of its values, strings and containers are allocated from a single arena, so parsing
+/// is cheap and the whole tree is released at once when the document is destroyed.
+/// </summary>
+class document
+{
+public:
+    /// <summary>
+    /// Constructs a document whose root is a null value.
+    /// </summary>
+    _ASYNCRTIMP document();
+
+    _ASYNCRTIMP document(document&& other) CPPREST_NOEXCEPT;
+
+    _ASYNCRTIMP document& operator=(document&& other) CPPREST_NOEXCEPT;
+
+    _ASYNCRTIMP ~document();
+
+    /// <summary>
+    /// Parses a string into a JSON document.
+    /// </summary>
+    /// <param name="value">A C++ STL string of the platform-native character width</param>
+    /// <exception cref="json_exception">If the string is not valid JSON.</exception>
+    _ASYNCRTIMP static document __cdecl parse(const utility::string_t& value);
+
+    /// <summary>
+    /// Attempts to parse a string into a JSON document.
+    /// </summary>
+    /// <param name="value">A C++ STL string of the platform-native character width</param>
+    /// <param name="errorCode">If parsing fails, the error code is greater than 0</param>
+    /// <returns>The parsed document. Its root is null if parsing failed.</returns>
+    _ASYNCRTIMP static document __cdecl parse(const utility::string_t& value, std::error_code& errorCode);
+
+    /// <summary>
+    /// Parses a JSON document from the contents of an input stream using the native platform character width.
+    /// </summary>
+    /// <param name="input">The stream to read the JSON document from</param>
+    /// <exception cref="json_exception">If the stream does not contain valid JSON.</exception>
+    _ASYNCRTIMP static document __cdecl parse(utility::istream_t& input);
+
+    /// <summary>
+    /// Attempts to parse a JSON document from the contents of an input stream using the native platform character
+    /// width.
+    /// </summary>
+    /// <param name="input">The stream to read the JSON document from</param>
+    /// <param name="errorCode">If parsing fails, the error code is greater than 0</param>
+    /// <returns>The parsed document. Its root is null if parsing failed.</returns>
+    _ASYNCRTIMP static document __cdecl parse(utility::istream_t& input, std::error_code& errorCode);
+
+#ifdef _WIN32
+    /// <summary>
+    /// Parses a UTF8 string into a JSON document.
+    /// </summary>
+    /// <param name="value">A C++ STL string in UTF8 format</param>
+    /// <exception cref="json_exception">If the string is not valid JSON.</exception>
+    _ASYNCRTIMP static document __cdecl parse(const std::string& value);
+
+    /// <summary>
+    /// Attempts to parse a UTF8 string into a JSON document.
+    /// </summary>
+    /// <param name="value">A C++ STL string in UTF8 format</param>
+    /// <param name="errorCode">If parsing fails, the error code is greater than 0</param>
+    /// <returns>The parsed document. Its root is null if parsing failed.</returns>
+    _ASYNCRTIMP static document __cdecl parse(const std::string& value, std::error_code& errorCode);
+#endif
+
+    /// <summary>
+    /// Accesses the root value of the document.
+    /// </summary>
+    /// <returns>A reference to the root value, valid for the lifetime of the document.</returns>
+    _ASYNCRTIMP document_value root() const;
+
+private:
+    template<typename CharType>
+    friend class details::JSON_Parser;
+
+    std::unique_ptr<details::_Document_arena> m_arena;
+    const details::_Document_node* m_root;
+
+    document(const document&);
+    document& operator=(const document&);
+};
+
 /// <summary>
 /// A standard <c>std::ostream</c> operator to facilitate writing JSON values to streams.
 /// </summary>
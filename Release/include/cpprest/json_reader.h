@@ -0,0 +1,84 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * HTTP Library: Event based JSON reader for asynchronous streams
+ *
+ * For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+#pragma once
+
+#include "cpprest/json.h"
+#include "cpprest/streams.h"
+#include "pplx/pplxtasks.h"
+#include <memory>
+
+namespace web
+{
+namespace json
+{
+/// <summary>
+/// Receives the events of <c>json::parse_events</c>, in document order. Objects and arrays are reported as a start
+/// event, their contents and an end event; every other value is reported as a single <c>value</c> event. Events are
+/// delivered one at a time, on whichever thread is reading the stream. Throwing from a handler stops the parse and
+/// faults the returned task.
+/// </summary>
+class reader_handler
+{
+public:
+    virtual ~reader_handler() {}
+
+    /// <summary>
+    /// Called when an object starts.
+    /// </summary>
+    virtual void start_object() {}
+
+    /// <summary>
+    /// Called for each field name of an object, before the events of the field's value.
+    /// </summary>
+    /// <param name="name">The name of the field</param>
+    virtual void key(const utility::string_t& name) { (void)name; }
+
+    /// <summary>
+    /// Called when an object ends.
+    /// </summary>
+    virtual void end_object() {}
+
+    /// <summary>
+    /// Called when an array starts.
+    /// </summary>
+    virtual void start_array() {}
+
+    /// <summary>
+    /// Called when an array ends.
+    /// </summary>
+    virtual void end_array() {}
+
+    /// <summary>
+    /// Called for each string, number, Boolean or null value.
+    /// </summary>
+    /// <param name="value">The value</param>
+    virtual void value(const json::value& value) { (void)value; }
+};
+
+/// <summary>
+/// Parses a single UTF-8 encoded JSON value from an asynchronous stream, reporting it to <paramref name="handler"/>
+/// as it is read. Only the current token is held in memory, so arbitrarily large documents, such as the body of an
+/// <c>http_response</c>, can be processed while they are still arriving.
+/// </summary>
+/// <param name="input">The stream to read from. It must hold nothing but whitespace after the value.</param>
+/// <param name="handler">The handler receiving the events. It is kept alive until the parse completes.</param>
+/// <returns>A task that completes when the value has been read. It faults with a <c>json_exception</c> if the input
+/// is not valid JSON.</returns>
+/// <remarks>The stream is read through task continuations, so no thread is blocked while waiting for input. Events
+/// are delivered one at a time, on the threads running those continuations. Input is read in chunks of up to 4096
+/// bytes; a <c>producer_consumer_buffer</c> hands over a shorter chunk when it is synced or closed.</remarks>
+_ASYNCRTIMP pplx::task<void> __cdecl parse_events(concurrency::streams::istream input,
+                                                  std::shared_ptr<reader_handler> handler);
+
+} // namespace json
+} // namespace web
@@ -0,0 +1,119 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * HTTP Library: Streaming JSON writer for asynchronous streams
+ *
+ * For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+#pragma once
+
+#include "cpprest/json.h"
+#include "cpprest/streams.h"
+#include "pplx/pplxtasks.h"
+#include <string>
+#include <vector>
+
+namespace web
+{
+namespace json
+{
+/// <summary>
+/// Writes UTF-8 JSON text into an asynchronous stream buffer as it is produced. Output is collected in chunks of a
+/// fixed size, and each full chunk is handed to the stream buffer right away. The reader on the other end, such as an
+/// <c>http_response</c> whose body is a <c>producer_consumer_buffer</c>, can consume the first bytes while the rest
+/// is still being written.
+/// </summary>
+/// <remarks>
+/// The writer checks that calls form a single well-formed JSON value and throws a <c>json_exception</c> otherwise.
+/// A writer must only be used from one thread at a time.
+/// </remarks>
+class writer
+{
+public:
+    /// <summary>
+    /// Constructs a writer on top of a stream buffer.
+    /// </summary>
+    /// <param name="buffer">The stream buffer to write to. It is not closed by the writer.</param>
+    /// <param name="chunk_size">The size of the chunks handed to the stream buffer, in bytes.</param>
+    _ASYNCRTIMP explicit writer(concurrency::streams::streambuf<uint8_t> buffer, size_t chunk_size = 16 * 1024);
+
+    /// <summary>
+    /// Destroys the writer. Output that was not flushed is discarded.
+    /// </summary>
+    _ASYNCRTIMP ~writer();
+
+    /// <summary>
+    /// Starts an object. Fields are then written as pairs of <c>key</c> and a value.
+    /// </summary>
+    _ASYNCRTIMP void begin_object();
+
+    /// <summary>
+    /// Ends the innermost object.
+    /// </summary>
+    _ASYNCRTIMP void end_object();
+
+    /// <summary>
+    /// Starts an array.
+    /// </summary>
+    _ASYNCRTIMP void begin_array();
+
+    /// <summary>
+    /// Ends the innermost array.
+    /// </summary>
+    _ASYNCRTIMP void end_array();
+
+    /// <summary>
+    /// Writes the name of the next field of the innermost object.
+    /// </summary>
+    /// <param name="name">The name of the field</param>
+    _ASYNCRTIMP void key(const utility::string_t& name);
+
+    /// <summary>
+    /// Writes a value. Objects and arrays are walked element by element, so they are never formatted into a single
+    /// string.
+    /// </summary>
+    /// <param name="value">The value to write</param>
+    _ASYNCRTIMP void value(const json::value& value);
+
+    /// <summary>
+    /// Hands any partial chunk to the stream buffer.
+    /// </summary>
+    /// <returns>A task that completes when everything written so far has been accepted by the stream buffer. It
+    /// faults if any write to the stream buffer failed.</returns>
+    _ASYNCRTIMP pplx::task<void> flush();
+
+private:
+    enum container_state
+    {
+        object_first,
+        object_next,
+        object_value,
+        array_first,
+        array_next
+    };
+
+    void start_value();
+    void end_value();
+    void write_value(const json::value& value);
+    void spill();
+
+    concurrency::streams::streambuf<uint8_t> m_buffer;
+    size_t m_chunk_size;
+    std::string m_chunk;
+    std::vector<container_state> m_containers;
+    bool m_complete;
+
+    // The chain of writes handed to the stream buffer, so that chunks reach it in order.
+    pplx::task<void> m_pending;
+
+    writer(const writer&);
+    writer& operator=(const writer&);
+};
+
+} // namespace json
+} // namespace web
@@ -25,6 +25,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 
 #include "pplx/pplxinterface.h"
@@ -204,6 +205,43 @@ public:
 #endif
 };
 
+#if !defined(__APPLE__)
+/// <summary>
+/// An opt-in scheduler that runs tasks on its own threads, each of which owns a local queue of work. Tasks scheduled
+/// from one of the scheduler's threads are kept on that thread, with the most recently scheduled one executed next;
+/// idle threads steal work from busy ones. Install it with <c>pplx::set_ambient_scheduler</c> before the first task is
+/// created, or pass it to individual tasks through <c>pplx::task_options</c>.
+/// </summary>
+class work_stealing_scheduler : public pplx::scheduler_interface
+{
+public:
+    /// <summary>
+    /// Creates a scheduler and starts its worker threads.
+    /// </summary>
+    /// <param name="num_threads">The number of worker threads; zero selects the number of hardware threads.</param>
+    _PPLXIMP explicit work_stealing_scheduler(size_t num_threads = 0);
+
+    /// <summary>
+    /// Runs any remaining tasks and stops the worker threads.
+    /// </summary>
+    _PPLXIMP virtual ~work_stealing_scheduler();
+
+    _PPLXIMP virtual void schedule(TaskProc_t proc, _In_ void* param);
+
+    /// <summary>
+    /// Returns the number of worker threads owned by this scheduler.
+    /// </summary>
+    _PPLXIMP size_t thread_count() const;
+
+private:
+    class impl;
+    std::shared_ptr<impl> m_impl;
+
+    work_stealing_scheduler(const work_stealing_scheduler&);
+    work_stealing_scheduler& operator=(const work_stealing_scheduler&);
+};
+#endif // !__APPLE__
+
 } // namespace details
 
 /// <summary>
@@ -222,6 +222,13 @@ class task<void>;
 #define PPLX_CAPTURE_CALLSTACK() ::pplx::details::_TaskCreationCallstack::_CaptureSingleFrameCallstack(_ReturnAddress())
 #endif
 
+// The number of synchronous continuations (see task_continuation_context::use_synchronous_execution) that may run nested
+// on one thread before further ones are handed to the scheduler, unless this is overridden prior to #includ'ing
+// pplxtasks.h.
+#ifndef PPLX_MAX_INLINE_CONTINUATION_DEPTH
+#define PPLX_MAX_INLINE_CONTINUATION_DEPTH 16
+#endif
+
 /// <summary>
 ///     Returns an indication of whether the task that is currently executing has received a request to cancel its
 ///     execution. Cancellation is requested on a task if the task was created with a cancellation token, and
@@ -627,6 +634,30 @@ static void _ScheduleFuncWithAutoInline(const std::function<void()>& _Func, _Tas
     _TaskCollection_t::_RunTask(&_TaskProcThunk::_Bridge, new _TaskProcThunk(_Func), _InliningMode);
 }
 
+/// <summary>
+///     Counts the synchronous continuations running inline on the current thread, so that a long chain of them cannot
+///     overflow the stack.
+/// </summary>
+class _InlineContinuationScope
+{
+public:
+    _InlineContinuationScope() { ++_Depth(); }
+
+    ~_InlineContinuationScope() { --_Depth(); }
+
+    static bool _CanInline() { return _Depth() < PPLX_MAX_INLINE_CONTINUATION_DEPTH; }
+
+private:
+    static size_t& _Depth()
+    {
+        static thread_local size_t _S_depth = 0;
+        return _S_depth;
+    }
+
+    _InlineContinuationScope(const _InlineContinuationScope&);
+    _InlineContinuationScope& operator=(const _InlineContinuationScope&);
+};
+
 class _ContextCallback
 {
     typedef std::function<void(void)> _CallbackFunction;
@@ -1197,8 +1228,40 @@ public:
     }
 #endif /* defined (__cplusplus_winrt) */
 
+    /// <summary>
+    ///     Returns a task continuation context object that represents the synchronous execution context.
+    /// </summary>
+    /// <returns>
+    ///     The synchronous execution context.
+    /// </returns>
+    /// <remarks>
+    ///     A continuation created with this context runs on the thread that completes its antecedent, or on the thread
+    ///     calling <c>then</c> if the antecedent has already completed, instead of being handed to the scheduler. It
+    ///     should only be used for cheap, non-blocking continuations. When more than
+    ///     <c>PPLX_MAX_INLINE_CONTINUATION_DEPTH</c> synchronous continuations are already running nested on the
+    ///     current thread, the continuation is scheduled as usual.
+    /// </remarks>
+    /**/
+    static task_continuation_context use_synchronous_execution()
+    {
+        task_continuation_context _Synchronous;
+        _Synchronous._M_RunInline = true;
+        return _Synchronous;
+    }
+
+    /// <summary>
+    ///     Returns whether continuations using this context run synchronously. Used internally.
+    /// </summary>
+    /**/
+    bool _IsSynchronous() const { return _M_RunInline; }
+
 private:
-    task_continuation_context(bool _DeferCapture = false) : details::_ContextCallback(_DeferCapture) {}
+    task_continuation_context(bool _DeferCapture = false)
+        : details::_ContextCallback(_DeferCapture), _M_RunInline(false)
+    {
+    }
+
+    bool _M_RunInline;
 };
 
 class task_options;
@@ -2091,6 +2154,12 @@ struct _Task_impl_base
                 },
                 _PTaskHandle->_M_inliningMode);
         }
+        else if (_PTaskHandle->_M_continuationContext._IsSynchronous() &&
+                 details::_InlineContinuationScope::_CanInline())
+        {
+            details::_InlineContinuationScope _Scope;
+            _ScheduleTask(_PTaskHandle, details::_ForceInline);
+        }
         else
         {
             _ScheduleTask(_PTaskHandle, _PTaskHandle->_M_inliningMode);
@@ -16,6 +16,7 @@
 #include "stdafx.h"
 
 #include "http_client_impl.h"
+#include <atomic>
 
 namespace web
 {
@@ -182,7 +183,11 @@ concurrency::streams::streambuf<uint8_t> request_context::_get_writebuffer()
 }
 
 request_context::request_context(const std::shared_ptr<_http_client_communicator>& client, const http_request& request)
-    : m_http_client(client), m_request(request), m_uploaded(0), m_downloaded(0)
+    : m_http_client(client)
+    , m_request(request)
+    , m_ordering_key(request.ordering_key())
+    , m_uploaded(0)
+    , m_downloaded(0)
 {
     auto responseImpl = m_response._get_impl();
 
@@ -227,14 +232,79 @@ void _http_client_communicator::async_send_request(const std::shared_ptr<request
             m_outstanding = true;
         }
     }
+    else if (!request->m_ordering_key.empty())
+    {
+        if (enqueue_ordered_request(request))
+        {
+            start_send_request(request);
+        }
+    }
+    else
+    {
+        start_send_request(request);
+    }
+}
+
+void _http_client_communicator::start_send_request(const std::shared_ptr<request_context>& request)
+{
+    if (sends_without_blocking())
+    {
+        try
+        {
+            send_request(request);
+        }
+        catch (...)
+        {
+            request->report_exception(std::current_exception());
+        }
+    }
     else
     {
         async_send_request_impl(request);
     }
 }
 
-void _http_client_communicator::finish_request()
+bool _http_client_communicator::enqueue_ordered_request(const std::shared_ptr<request_context>& request)
 {
+    pplx::extensibility::scoped_critical_section_t l(m_client_lock);
+
+    auto found = m_ordered_queues.find(request->m_ordering_key);
+    if (found == m_ordered_queues.end())
+    {
+        m_ordered_queues.emplace(request->m_ordering_key, std::deque<std::shared_ptr<request_context>>());
+        return true;
+    }
+
+    found->second.push_back(request);
+    return false;
+}
+
+void _http_client_communicator::finish_request(request_context& request)
+{
+    if (!m_client_config.guarantee_order() && !request.m_ordering_key.empty())
+    {
+        std::shared_ptr<request_context> next;
+        {
+            pplx::extensibility::scoped_critical_section_t l(m_client_lock);
+
+            auto found = m_ordered_queues.find(request.m_ordering_key);
+            if (found == m_ordered_queues.end())
+            {
+                return;
+            }
+            if (found->second.empty())
+            {
+                m_ordered_queues.erase(found);
+                return;
+            }
+            next = std::move(found->second.front());
+            found->second.pop_front();
+        }
+
+        start_send_request(next);
+        return;
+    }
+
     // If guarantee order is specified we don't need to do anything.
     if (m_client_config.guarantee_order())
     {
@@ -272,7 +342,7 @@ inline void request_context::finish()
         m_request._cancellation_token().deregister_callback(m_cancellationRegistration);
     }
 
-    m_http_client->finish_request();
+    m_http_client->finish_request(*this);
 }
 
 } // namespace details
@@ -283,7 +353,10 @@ inline void request_context::finish()
 class http_pipeline
 {
 public:
-    http_pipeline(std::shared_ptr<details::_http_client_communicator> last) : m_last_stage(std::move(last)) {}
+    http_pipeline(std::shared_ptr<details::_http_client_communicator> last)
+        : m_last_stage(std::move(last)), m_first_stage(m_last_stage.get())
+    {
+    }
 
     // pplx::extensibility::recursive_lock_t does not support move/copy, but does not delete the functions either.
     http_pipeline(const http_pipeline&) = delete;
@@ -297,12 +370,7 @@ public:
     /// <param name="request">Http request</param>
     pplx::task<http_response> propagate(http_request request)
     {
-        std::shared_ptr<http_pipeline_stage> first;
-        {
-            pplx::extensibility::scoped_recursive_lock_t l(m_lock);
-            first = (m_stages.size() > 0) ? m_stages[0] : m_last_stage;
-        }
-        return first->propagate(request);
+        return m_first_stage.load(std::memory_order_acquire)->propagate(std::move(request));
     }
 
     /// <summary>
@@ -321,6 +389,7 @@ public:
         stage->set_next_stage(m_last_stage);
 
         m_stages.push_back(stage);
+        m_first_stage.store(m_stages[0].get(), std::memory_order_release);
     }
 
     // The last stage is always set up by the client or listener and cannot
@@ -329,9 +398,12 @@ public:
     const std::shared_ptr<details::_http_client_communicator> m_last_stage;
 
 private:
-    // The vector of pipeline stages.
+    // The vector of pipeline stages, which own them; stages are never removed.
     std::vector<std::shared_ptr<http_pipeline_stage>> m_stages;
 
+    // The stage requests enter the pipeline at, read without taking m_lock, which only guards appending stages.
+    std::atomic<http_pipeline_stage*> m_first_stage;
+
     pplx::extensibility::recursive_lock_t m_lock;
 };
 
@@ -401,6 +473,10 @@ const http_client_config& http_client::client_config() const { return m_pipeline
 
 const uri& http_client::base_uri() const { return m_pipeline->m_last_stage->base_uri(); }
 
+connection_pool_stats http_client::pool_stats() const { return m_pipeline->m_last_stage->pool_stats(); }
+
+pplx::task<size_t> http_client::prewarm(size_t count) { return m_pipeline->m_last_stage->prewarm(count); }
+
 // Macros to help build string at compile time and avoid overhead.
 #define STRINGIFY(x) _XPLATSTR(#x)
 #define TOSTRING(x) STRINGIFY(x)
@@ -44,6 +44,8 @@
 #include "cpprest/details/http_helpers.h"
 #include "http_client_impl.h"
 #include "pplx/threadpool.h"
+#include <deque>
+#include <map>
 #include <memory>
 #include <unordered_set>
 
@@ -131,6 +133,16 @@ enum class httpclient_errorcode_context
     close
 };
 
+// Appends a string of the platform character type to the UTF-8 head of a request.
+static void append_utf8(std::string& head, const utility::string_t& value)
+{
+#ifdef _UTF16_STRINGS
+    head.append(utility::conversions::to_utf8string(value));
+#else
+    head.append(value);
+#endif
+}
+
 static std::string generate_base64_userpass(const ::web::credentials& creds)
 {
     auto userpass = creds.username() + U(":") + *creds._internal_decrypt();
@@ -139,41 +151,489 @@ static std::string generate_base64_userpass(const ::web::credentials& creds)
     return utility::conversions::to_utf8string(utility::conversions::to_base64(credentials_buffer));
 }
 
+// Verifies a certificate of the chain presented by a host; openssl_failed records, across the calls for the chain,
+// that OpenSSL could not verify part of it.
+static bool verify_certificate(bool preverified,
+                               boost::asio::ssl::verify_context& verifyCtx,
+                               const std::string& cn_hostname,
+                               bool& openssl_failed)
+{
+    // OpenSSL calls the verification callback once per certificate in the chain,
+    // starting with the root CA certificate. The 'leaf', non-Certificate Authority (CA)
+    // certificate, i.e. actual server certificate is at the '0' position in the
+    // certificate chain, the rest are optional intermediate certificates, followed
+    // finally by the root CA self signed certificate.
+
+#ifdef CPPREST_PLATFORM_ASIO_CERT_VERIFICATION_AVAILABLE
+    // If OpenSSL fails we will doing verification at the end using the whole certificate
+    // chain so wait until the 'leaf' cert. For now return true so OpenSSL continues down
+    // the certificate chain.
+    if (!preverified)
+    {
+        openssl_failed = true;
+    }
+
+    if (openssl_failed)
+    {
+        return verify_cert_chain_platform_specific(verifyCtx, cn_hostname);
+    }
+#else
+    (void)openssl_failed;
+#endif // CPPREST_PLATFORM_ASIO_CERT_VERIFICATION_AVAILABLE
+
+    boost::asio::ssl::rfc2818_verification rfc2818(cn_hostname);
+    return rfc2818(preverified, verifyCtx);
+}
+
+// The TLS configuration shared by the connections of a client: one SSL context, set up once, and the session of the
+// latest handshake with each host, which later connections to the host resume instead of performing a full
+// handshake.
+class asio_ssl_context
+{
+public:
+    explicit asio_ssl_context(const std::function<void(boost::asio::ssl::context&)>& ssl_context_callback)
+        : m_context(boost::asio::ssl::context::sslv23)
+    {
+        m_context.set_default_verify_paths();
+        m_context.set_options(boost::asio::ssl::context::default_workarounds);
+
+        // OpenSSL hands each new session to on_new_session instead of keeping it in its own cache, which would look
+        // sessions up by server address rather than by host name.
+        SSL_CTX* native = m_context.native_handle();
+        SSL_CTX_set_ex_data(native, context_index(), this);
+        SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(native, &asio_ssl_context::on_new_session);
+
+        if (ssl_context_callback)
+        {
+            ssl_context_callback(m_context);
+        }
+    }
+
+    ~asio_ssl_context()
+    {
+        for (auto& session : m_sessions)
+        {
+            SSL_SESSION_free(session.second);
+        }
+    }
+
+    asio_ssl_context(const asio_ssl_context&) = delete;
+    asio_ssl_context& operator=(const asio_ssl_context&) = delete;
+
+    boost::asio::ssl::context& context() { return m_context; }
+
+    // Offers the latest session with the host to a connection about to perform its handshake, and has the sessions
+    // the connection receives stored for the host. The host name must outlive the handshake.
+    void resume_session(SSL* ssl, const std::string& host)
+    {
+        SSL_set_ex_data(ssl, host_index(), const_cast<std::string*>(&host));
+
+        std::lock_guard<std::mutex> lock(m_sessions_lock);
+        auto it = m_sessions.find(host);
+        if (it != m_sessions.end())
+        {
+            SSL_set_session(ssl, it->second);
+        }
+    }
+
+private:
+    static int context_index()
+    {
+        static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        return index;
+    }
+
+    static int host_index()
+    {
+        static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        return index;
+    }
+
+    static int on_new_session(SSL* ssl, SSL_SESSION* session)
+    {
+        auto host = static_cast<const std::string*>(SSL_get_ex_data(ssl, host_index()));
+        auto self = static_cast<asio_ssl_context*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+        if (host == nullptr || self == nullptr)
+        {
+            return 0;
+        }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+        // OpenSSL marks the session of a connection that is freed without a TLS shutdown as not resumable, which
+        // is how servers usually close idle connections, so a copy is kept instead.
+        SSL_SESSION* copy = SSL_SESSION_dup(session);
+        if (copy == nullptr)
+        {
+            return 0;
+        }
+#else
+        SSL_SESSION* copy = session;
+#endif
+
+        std::lock_guard<std::mutex> lock(self->m_sessions_lock);
+        SSL_SESSION*& stored = self->m_sessions[*host];
+        if (stored != nullptr)
+        {
+            SSL_SESSION_free(stored);
+        }
+        stored = copy;
+
+        // Returning 1 takes over the reference OpenSSL passed in; returning 0 leaves it to OpenSSL.
+        return copy == session ? 1 : 0;
+    }
+
+    boost::asio::ssl::context m_context;
+    std::mutex m_sessions_lock;
+    std::map<std::string, SSL_SESSION*> m_sessions;
+};
+
+// Caches the endpoints of host names, keyed by host and port. A lookup of a name that is being resolved waits for
+// that resolution. Once it is done, each lookup uses its endpoints only while they are younger than the DNS cache TTL
+// of the client looking them up, or its failure while it is younger than the client's negative TTL. Entries are
+// evicted once they are older than the longest TTL they were looked up with.
+class asio_dns_cache final : public std::enable_shared_from_this<asio_dns_cache>
+{
+public:
+    typedef std::function<pplx::task<std::vector<tcp::endpoint>>(const std::string&, const std::string&)>
+        resolver_type;
+
+    explicit asio_dns_cache(const resolver_type& resolver) : m_resolver(resolver) {}
+
+    // The cache of the clients using the system resolver.
+    static std::shared_ptr<asio_dns_cache> shared_instance()
+    {
+        static const std::shared_ptr<asio_dns_cache> instance =
+            std::make_shared<asio_dns_cache>(&asio_dns_cache::system_resolve);
+        return instance;
+    }
+
+    pplx::task<std::vector<tcp::endpoint>> resolve(const std::string& host,
+                                                  const std::string& port,
+                                                  const std::chrono::microseconds& ttl,
+                                                  const std::chrono::microseconds& negative_ttl)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::string key = host + ":" + port;
+        pplx::task<std::vector<tcp::endpoint>> lookup;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto found = m_entries.find(key);
+            if (found != m_entries.end())
+            {
+                auto& cached = found->second;
+                if (cached.m_resolved_at == std::chrono::steady_clock::time_point::max())
+                {
+                    return cached.m_lookup;
+                }
+
+                const auto& caller_ttl = cached.m_failed ? negative_ttl : ttl;
+                if (now - cached.m_resolved_at < caller_ttl)
+                {
+                    cached.m_expires = (std::max)(cached.m_expires, cached.m_resolved_at + caller_ttl);
+                    return cached.m_lookup;
+                }
+            }
+
+            remove_expired(now);
+            try
+            {
+                lookup = m_resolver(host, port);
+            }
+            catch (...)
+            {
+                lookup = pplx::task_from_exception<std::vector<tcp::endpoint>>(std::current_exception());
+            }
+
+            auto& entry = m_entries[key];
+            entry.m_lookup = lookup;
+            entry.m_resolved_at = std::chrono::steady_clock::time_point::max();
+            entry.m_failed = false;
+            entry.m_expires = std::chrono::steady_clock::time_point::max();
+        }
+
+        std::weak_ptr<asio_dns_cache> weak_cache = shared_from_this();
+        lookup.then([weak_cache, key, ttl, negative_ttl](pplx::task<std::vector<tcp::endpoint>> done) {
+            bool resolved = false;
+            try
+            {
+                resolved = !done.get().empty();
+            }
+            catch (...)
+            {
+            }
+
+            auto cache = weak_cache.lock();
+            if (cache)
+            {
+                cache->resolved(key, done, resolved, resolved ? ttl : negative_ttl);
+            }
+        });
+        return lookup;
+    }
+
+private:
+    struct entry
+    {
+        pplx::task<std::vector<tcp::endpoint>> m_lookup;
+        std::chrono::steady_clock::time_point m_resolved_at; // the latest time point while still resolving
+        bool m_failed;
+        std::chrono::steady_clock::time_point m_expires;
+    };
+
+    static pplx::task<std::vector<tcp::endpoint>> system_resolve(const std::string& host, const std::string& port)
+    {
+        auto resolver = std::make_shared<tcp::resolver>(crossplat::threadpool::shared_instance().service());
+        pplx::task_completion_event<std::vector<tcp::endpoint>> resolved;
+        resolver->async_resolve(
+            tcp::resolver::query(host, port),
+            [resolver, resolved](const boost::system::error_code& ec, tcp::resolver::iterator endpoints) {
+                if (ec)
+                {
+                    resolved.set_exception(boost::system::system_error(ec));
+                }
+                else
+                {
+                    resolved.set(std::vector<tcp::endpoint>(endpoints, tcp::resolver::iterator()));
+                }
+            });
+        return pplx::create_task(resolved);
+    }
+
+    void resolved(const std::string& key,
+                  const pplx::task<std::vector<tcp::endpoint>>& lookup,
+                  bool succeeded,
+                  const std::chrono::microseconds& ttl)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto found = m_entries.find(key);
+        if (found == m_entries.end() || found->second.m_lookup != lookup)
+        {
+            return;
+        }
+
+        if (ttl.count() <= 0)
+        {
+            m_entries.erase(found);
+        }
+        else
+        {
+            found->second.m_resolved_at = std::chrono::steady_clock::now();
+            found->second.m_failed = !succeeded;
+            found->second.m_expires = found->second.m_resolved_at + ttl;
+        }
+    }
+
+    void remove_expired(const std::chrono::steady_clock::time_point& now)
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end();)
+        {
+            if (now < it->second.m_expires)
+            {
+                ++it;
+            }
+            else
+            {
+                it = m_entries.erase(it);
+            }
+        }
+    }
+
+    const resolver_type m_resolver;
+    std::mutex m_lock;
+    std::map<std::string, entry> m_entries;
+};
+
+// Connects to the first endpoint of a host that accepts a connection, as described by RFC 8305: the endpoints are
+// tried alternating between address families, and an attempt that has neither succeeded nor failed within the attempt
+// delay is raced by an attempt to the next endpoint. A zero delay tries the endpoints one after the other.
+class asio_connect_race final : public std::enable_shared_from_this<asio_connect_race>
+{
+public:
+    typedef std::function<void(const boost::system::error_code&, std::unique_ptr<tcp::socket>&&)> handler_type;
+
+    asio_connect_race(boost::asio::io_service& io_service,
+                      std::vector<tcp::endpoint>&& endpoints,
+                      const std::chrono::milliseconds& attempt_delay)
+        : m_io_service(io_service)
+        , m_endpoints(interleave_families(endpoints))
+        , m_attempt_delay(attempt_delay)
+        , m_timer(io_service)
+        , m_pending(0)
+        , m_done(false)
+        , m_canceled(false)
+    {
+    }
+
+    // Note: the handler is called with the connected socket, or the error of the last attempt once all failed.
+    void start(handler_type&& handler)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        assert(!m_endpoints.empty());
+        m_handler = std::move(handler);
+        start_attempt();
+    }
+
+    void cancel()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_canceled = true;
+        close_attempts();
+    }
+
+private:
+    static std::vector<tcp::endpoint> interleave_families(const std::vector<tcp::endpoint>& endpoints)
+    {
+        std::vector<tcp::endpoint> preferred;
+        std::vector<tcp::endpoint> others;
+        for (const auto& endpoint : endpoints)
+        {
+            (endpoint.protocol() == endpoints.front().protocol() ? preferred : others).push_back(endpoint);
+        }
+
+        std::vector<tcp::endpoint> result;
+        result.reserve(endpoints.size());
+        for (size_t i = 0; i < preferred.size() || i < others.size(); ++i)
+        {
+            if (i < preferred.size()) result.push_back(preferred[i]);
+            if (i < others.size()) result.push_back(others[i]);
+        }
+        return result;
+    }
+
+    // Note: m_lock must be held.
+    void start_attempt()
+    {
+        const size_t index = m_sockets.size();
+        m_sockets.emplace_back(new tcp::socket(m_io_service));
+        ++m_pending;
+
+        auto self = shared_from_this();
+        m_sockets.back()->async_connect(m_endpoints[index],
+                                        [self, index](const boost::system::error_code& ec) {
+                                            self->handle_connect(ec, index);
+                                        });
+
+        if (m_attempt_delay.count() > 0 && m_sockets.size() < m_endpoints.size())
+        {
+            m_timer.expires_from_now(m_attempt_delay);
+            m_timer.async_wait([self, index](const boost::system::error_code& ec) {
+                if (!ec)
+                {
+                    self->handle_attempt_delay(index);
+                }
+            });
+        }
+    }
+
+    void handle_attempt_delay(size_t index)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        // Only the latest attempt is raced; a timer rearmed after this one fired may still call in.
+        if (!m_done && !m_canceled && index + 1 == m_sockets.size())
+        {
+            start_attempt();
+        }
+    }
+
+    void handle_connect(const boost::system::error_code& ec, size_t index)
+    {
+        handler_type handler;
+        std::unique_ptr<tcp::socket> socket;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            --m_pending;
+            if (m_done)
+            {
+                return;
+            }
+
+            if (!ec && !m_canceled)
+            {
+                socket = std::move(m_sockets[index]);
+            }
+            else
+            {
+                m_error = m_canceled ? boost::asio::error::operation_aborted : ec;
+                if (!m_canceled && m_sockets.size() < m_endpoints.size())
+                {
+                    start_attempt();
+                    return;
+                }
+
+                if (m_pending != 0)
+                {
+                    return;
+                }
+            }
+
+            m_done = true;
+            close_attempts();
+            handler = std::move(m_handler);
+        }
+
+        handler(socket ? boost::system::error_code() : m_error, std::move(socket));
+    }
+
+    // Note: m_lock must be held.
+    void close_attempts()
+    {
+        boost::system::error_code ignored;
+        m_timer.cancel(ignored);
+        for (auto& socket : m_sockets)
+        {
+            if (socket)
+            {
+                socket->close(ignored);
+            }
+        }
+    }
+
+    boost::asio::io_service& m_io_service;
+    const std::vector<tcp::endpoint> m_endpoints;
+    const std::chrono::milliseconds m_attempt_delay;
+    std::mutex m_lock;
+    boost::asio::steady_timer m_timer;
+    std::vector<std::unique_ptr<tcp::socket>> m_sockets;
+    size_t m_pending;
+    bool m_done;
+    bool m_canceled;
+    boost::system::error_code m_error;
+    handler_type m_handler;
+};
+
 class asio_connection_pool;
 
 class asio_connection
 {
     friend class asio_client;
+    friend class asio_connection_pool;
 
 public:
     asio_connection(boost::asio::io_service& io_service)
         : m_socket_lock()
         , m_socket(io_service)
+        , m_ssl_context()
         , m_ssl_stream()
         , m_cn_hostname()
         , m_is_reused(false)
         , m_keep_alive(true)
         , m_closed(false)
+        , m_pool()
+        , m_pool_key()
     {
     }
 
-    ~asio_connection() { close(); }
+    ~asio_connection();
 
     // This simply instantiates the internal state to support ssl. It does not perform the handshake.
-    void upgrade_to_ssl(std::string&& cn_hostname,
-                        const std::function<void(boost::asio::ssl::context&)>& ssl_context_callback)
+    void upgrade_to_ssl(std::string&& cn_hostname, const std::shared_ptr<asio_ssl_context>& ssl_context)
     {
         std::lock_guard<std::mutex> lock(m_socket_lock);
         assert(!is_ssl());
-        boost::asio::ssl::context ssl_context(boost::asio::ssl::context::sslv23);
-        ssl_context.set_default_verify_paths();
-        ssl_context.set_options(boost::asio::ssl::context::default_workarounds);
-        if (ssl_context_callback)
-        {
-            ssl_context_callback(ssl_context);
-        }
+        m_ssl_context = ssl_context;
         m_ssl_stream = utility::details::make_unique<boost::asio::ssl::stream<boost::asio::ip::tcp::socket&>>(
-            m_socket, ssl_context);
+            m_socket, m_ssl_context->context());
         m_cn_hostname = std::move(cn_hostname);
     }
 
@@ -185,6 +645,12 @@ public:
         m_keep_alive = false;
         m_closed = true;
 
+        auto connect_race = m_connect_race.lock();
+        if (connect_race)
+        {
+            connect_race->cancel();
+        }
+
         boost::system::error_code error;
         m_socket.shutdown(tcp::socket::shutdown_both, error);
         m_socket.close(error);
@@ -198,11 +664,34 @@ public:
         return error;
     }
 
+    // Checks an idle connection without blocking: the server has closed it if the socket reports end of file, and it
+    // is not reusable either if anything else arrived on it unrequested.
+    bool closed_by_server()
+    {
+        std::lock_guard<std::mutex> lock(m_socket_lock);
+        if (m_closed)
+        {
+            return true;
+        }
+
+        char peeked;
+        boost::system::error_code error;
+        m_socket.non_blocking(true, error);
+        if (!error)
+        {
+            m_socket.receive(boost::asio::buffer(&peeked, 1), tcp::socket::message_peek, error);
+        }
+        boost::system::error_code ignored;
+        m_socket.non_blocking(false, ignored);
+        return error != boost::asio::error::would_block;
+    }
+
     bool is_reused() const { return m_is_reused; }
     void set_keep_alive(bool keep_alive) { m_keep_alive = keep_alive; }
     bool keep_alive() const { return m_keep_alive; }
     bool is_ssl() const { return m_ssl_stream ? true : false; }
     const std::string& cn_hostname() const { return m_cn_hostname; }
+    const std::string& pool_key() const { return m_pool_key; }
 
     // Check if the error code indicates that the connection was closed by the
     // server: this is used to detect if a connection in the pool was closed during
@@ -242,14 +731,24 @@ public:
         return false;
     }
 
-    template<typename Iterator, typename Handler>
-    void async_connect(const Iterator& begin, const Handler& handler)
+    // Connects the socket to the first of the endpoints that accepts a connection, see asio_connect_race.
+    template<typename Handler>
+    void async_connect(std::vector<tcp::endpoint>&& endpoints,
+                       const std::chrono::milliseconds& attempt_delay,
+                       const Handler& handler)
     {
         {
             std::lock_guard<std::mutex> lock(m_socket_lock);
             if (!m_closed)
             {
-                m_socket.async_connect(begin, handler);
+                auto connect_race = std::make_shared<asio_connect_race>(
+                    crossplat::threadpool::shared_instance().service(), std::move(endpoints), attempt_delay);
+                m_connect_race = connect_race;
+                // The handler keeps the request context, and with it this connection, alive.
+                connect_race->start([this, handler](const boost::system::error_code& ec,
+                                                    std::unique_ptr<tcp::socket>&& socket) {
+                    handler(ec ? ec : adopt_socket(std::move(socket)));
+                });
                 return;
             }
         } // unlock
@@ -283,6 +782,7 @@ public:
             SSL_set_tlsext_host_name(m_ssl_stream->native_handle(), &m_cn_hostname[0]);
         }
 
+        m_ssl_context->resume_session(m_ssl_stream->native_handle(), m_cn_hostname);
         m_ssl_stream->async_handshake(type, handshake_handler);
     }
 
@@ -330,6 +830,24 @@ public:
 
     void start_reuse() { m_is_reused = true; }
 
+    // The buffer the head of each request sent over the connection is formatted in, and written from.
+    std::string& request_head() { return m_request_head; }
+
+    boost::system::error_code adopt_socket(std::unique_ptr<tcp::socket>&& socket)
+    {
+        std::lock_guard<std::mutex> lock(m_socket_lock);
+        m_connect_race.reset();
+        if (m_closed)
+        {
+            boost::system::error_code ignored;
+            socket->close(ignored);
+            return boost::asio::error::operation_aborted;
+        }
+
+        m_socket = std::move(*socket);
+        return boost::system::error_code();
+    }
+
     void enable_no_delay()
     {
         boost::asio::ip::tcp::no_delay option(true);
@@ -343,19 +861,26 @@ private:
     // as normal message processing.
     std::mutex m_socket_lock;
     tcp::socket m_socket;
+    std::shared_ptr<asio_ssl_context> m_ssl_context; // outlives the stream, whose SSL object refers to it
     std::unique_ptr<boost::asio::ssl::stream<tcp::socket&>> m_ssl_stream;
     std::string m_cn_hostname;
+    std::weak_ptr<asio_connect_race> m_connect_race;
+    std::string m_request_head;
 
     bool m_is_reused;
     bool m_keep_alive;
     bool m_closed;
+
+    // The pool this connection holds a slot in, and the key of that slot.
+    std::weak_ptr<asio_connection_pool> m_pool;
+    std::string m_pool_key;
 };
 
 /// <summary>Implements a connection pool with adaptive connection removal</summary>
 /// <remarks>
-/// Every 30 seconds, the lambda in `start_epoch_interval` fires, triggering the
-/// cleanup of any connections that have resided in the pool since the last
-/// cleanup phase.
+/// At every eviction interval, 30 seconds by default, the lambda in `start_epoch_interval`
+/// fires, triggering the cleanup of any connections that have resided in the pool since
+/// the last cleanup phase.
 ///
 /// During the cleanup phase, connections are removed starting with the oldest. This
 /// ensures that if a high intensity workload is followed by a low intensity workload,
@@ -371,13 +896,39 @@ private:
 ///     pool.release(std::move(conn));
 ///   }
 /// </code>
+///
+/// Every open connection holds one of its host's slots until it is destroyed. When the
+/// host has reached its connection limit, requests queue up in FIFO order and are handed
+/// either a released connection or the slot of a destroyed one.
+///
+/// The interval between cleanups is configurable. Hosts keep their minimum number of idle
+/// connections through a cleanup unless the server has closed them; the warm handler is asked
+/// to replace the ones missing at every cleanup.
 /// </remarks>
 class asio_connection_pool final : public std::enable_shared_from_this<asio_connection_pool>
 {
 public:
-    asio_connection_pool()
+    // Invoked when a queued request can proceed: with a connection handed over by the pool, with a null
+    // connection if a slot for a new connection was reserved on its behalf, or with an error if the wait
+    // timed out or was canceled.
+    typedef std::function<void(const std::shared_ptr<asio_connection>&, const boost::system::error_code&)>
+        wait_handler;
+
+    // Invoked at a cleanup for each host that has fewer than its minimum number of idle connections.
+    typedef std::function<void(const std::string&)> warm_handler;
+
+    asio_connection_pool(size_t max_connections_per_host,
+                         size_t min_idle_per_host,
+                         const std::chrono::microseconds& eviction_interval)
         : m_lock()
         , m_connections()
+        , m_max_connections_per_host(max_connections_per_host)
+        , m_min_idle_per_host(min_idle_per_host)
+        , m_eviction_interval(eviction_interval)
+        , m_warm_handler()
+        , m_created(0)
+        , m_reused(0)
+        , m_wait_timeouts(0)
         , m_is_timer_running(false)
         , m_pool_epoch_timer(crossplat::threadpool::shared_instance().service())
     {
@@ -386,25 +937,73 @@ public:
     asio_connection_pool(const asio_connection_pool&) = delete;
     asio_connection_pool& operator=(const asio_connection_pool&) = delete;
 
-    std::shared_ptr<asio_connection> try_acquire(const std::string& cn_hostname)
+    // Note: must be set before the pool is used.
+    void set_warm_handler(warm_handler&& handler) { m_warm_handler = std::move(handler); }
+
+    // Returns an idle connection for the host if there is one. Otherwise tries to reserve a slot for a new
+    // connection, which the caller must then create and adopt(). If neither is possible the host is saturated,
+    // nullptr is returned with slot_reserved left false, and the caller should wait().
+    std::shared_ptr<asio_connection> try_acquire(const std::string& cn_hostname, bool& slot_reserved)
     {
         std::lock_guard<std::mutex> lock(m_lock);
-        if (m_connections.empty())
+        return try_acquire_locked(m_connections[cn_hostname], slot_reserved);
+    }
+
+    // Queues the caller until a connection or a connection slot for the host becomes available.
+    void wait(const std::string& cn_hostname,
+              const std::chrono::microseconds& timeout,
+              const pplx::cancellation_token& token,
+              wait_handler handler)
+    {
+        auto waiter = std::make_shared<pool_waiter>(cn_hostname, token, std::move(handler));
+        std::weak_ptr<asio_connection_pool> weak_pool = shared_from_this();
+        std::weak_ptr<pool_waiter> weak_waiter = waiter;
+
+        // Must not be registered under m_lock: the callback runs inline if the token is already canceled.
+        if (token != pplx::cancellation_token::none())
         {
-            return nullptr;
+            waiter->m_registration = token.register_callback([weak_pool, weak_waiter]() {
+                auto pool = weak_pool.lock();
+                auto waiter = weak_waiter.lock();
+                if (pool && waiter)
+                {
+                    pool->abandon_wait(waiter, boost::asio::error::operation_aborted);
+                }
+            });
         }
 
-        auto conn = m_connections[cn_hostname].try_acquire();
-        if (conn)
+        std::shared_ptr<asio_connection> conn;
         {
-            conn->start_reuse();
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (waiter->m_done)
+            {
+                return;
+            }
+
+            // Connections may have been released since the caller last tried to acquire one.
+            auto& host = m_connections[cn_hostname];
+            bool slot_reserved = false;
+            conn = try_acquire_locked(host, slot_reserved);
+            if (!conn && !slot_reserved)
+            {
+                enqueue_waiter(host, waiter, timeout);
+                return;
+            }
+
+            waiter->m_done = true;
         }
 
-        return conn;
+        complete_wait(std::move(waiter), std::move(conn), boost::system::error_code());
     }
 
     void release(std::shared_ptr<asio_connection>&& connection)
     {
+        if (!connection)
+        {
+            // The request never obtained a connection.
+            return;
+        }
+
         connection->cancel();
         if (!connection->keep_alive())
         {
@@ -412,24 +1011,256 @@ public:
             return;
         }
 
+        std::shared_ptr<pool_waiter> waiter;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto& host = m_connections[connection->pool_key()];
+            if (host.m_waiters.empty())
+            {
+                if (!m_is_timer_running)
+                {
+                    start_epoch_interval(shared_from_this());
+                    m_is_timer_running = true;
+                }
+
+                host.m_idle.release(std::move(connection));
+                return;
+            }
+
+            // Hand the connection straight to the longest waiting request.
+            waiter = take_waiter(host);
+            connection->start_reuse();
+            ++m_reused;
+        }
+
+        complete_wait(std::move(waiter), std::move(connection), boost::system::error_code());
+    }
+
+    // Makes a newly created connection hold the slot reserved by try_acquire() or a wait().
+    void adopt(asio_connection& connection, const std::string& cn_hostname)
+    {
+        connection.m_pool = shared_from_this();
+        connection.m_pool_key = cn_hostname;
+
         std::lock_guard<std::mutex> lock(m_lock);
-        if (!m_is_timer_running)
+        ++m_created;
+
+        // From now on, the cleanups must replace the host's idle connections when they fall below the minimum.
+        if (m_min_idle_per_host != 0 && !m_is_timer_running)
         {
             start_epoch_interval(shared_from_this());
             m_is_timer_running = true;
         }
+    }
+
+    // Reserves slots for the connections a host needs to have `target` idle connections, counting the ones already
+    // being warmed up. The caller must create and adopt() a connection for each slot, and call end_warming() once
+    // each connection has been released or destroyed.
+    size_t reserve_warm_slots(const std::string& cn_hostname, size_t target)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto& host = m_connections[cn_hostname];
+        size_t reserved = 0;
+        while (host.m_waiters.empty() && host.m_idle.size() + host.m_warming < target &&
+               (m_max_connections_per_host == 0 || host.m_open < m_max_connections_per_host))
+        {
+            ++host.m_open;
+            ++host.m_warming;
+            ++reserved;
+        }
 
-        m_connections[connection->cn_hostname()].release(std::move(connection));
+        return reserved;
+    }
+
+    void end_warming(const std::string& cn_hostname)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto& host = m_connections[cn_hostname];
+        assert(host.m_warming != 0);
+        --host.m_warming;
+    }
+
+    // Gives back a slot, either because its connection was destroyed or because it could not be created.
+    void release_slot(const std::string& cn_hostname)
+    {
+        std::shared_ptr<pool_waiter> waiter;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto& host = m_connections[cn_hostname];
+            if (host.m_waiters.empty())
+            {
+                assert(host.m_open != 0);
+                --host.m_open;
+                return;
+            }
+
+            // The slot passes directly to the longest waiting request, which opens a new connection.
+            waiter = take_waiter(host);
+        }
+
+        complete_wait(std::move(waiter), nullptr, boost::system::error_code());
+    }
+
+    connection_pool_stats stats()
+    {
+        connection_pool_stats result;
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (const auto& entry : m_connections)
+        {
+            const size_t idle = entry.second.m_idle.size();
+            result.active += entry.second.m_open - idle;
+            result.idle += idle;
+            result.waiting += entry.second.m_waiters.size();
+        }
+
+        result.created = m_created;
+        result.reused = m_reused;
+        result.wait_timeouts = m_wait_timeouts;
+        return result;
     }
 
 private:
+    struct pool_waiter
+    {
+        pool_waiter(const std::string& cn_hostname, const pplx::cancellation_token& token, wait_handler&& handler)
+            : m_cn_hostname(cn_hostname)
+            , m_token(token)
+            , m_registration()
+            , m_handler(std::move(handler))
+            , m_timer(crossplat::threadpool::shared_instance().service())
+            , m_done(false)
+        {
+        }
+
+        const std::string m_cn_hostname;
+        const pplx::cancellation_token m_token;
+        pplx::cancellation_token_registration m_registration;
+        const wait_handler m_handler;
+        boost::asio::deadline_timer m_timer;
+
+        // Guarded by the pool's m_lock.
+        bool m_done;
+    };
+
+    struct host_connections
+    {
+        host_connections() : m_idle(), m_open(0), m_warming(0), m_waiters() {}
+
+        connection_pool_stack<asio_connection> m_idle;
+
+        // Connections counted against the limit: idle, in use, or reserved but not yet created.
+        size_t m_open;
+
+        // Connections being opened ahead of requests, see reserve_warm_slots().
+        size_t m_warming;
+
+        std::deque<std::shared_ptr<pool_waiter>> m_waiters;
+    };
+
+    // Note: must be called under m_lock
+    void enqueue_waiter(host_connections& host,
+                        const std::shared_ptr<pool_waiter>& waiter,
+                        const std::chrono::microseconds& timeout)
+    {
+        std::weak_ptr<asio_connection_pool> weak_pool = shared_from_this();
+        std::weak_ptr<pool_waiter> weak_waiter = waiter;
+
+        host.m_waiters.push_back(waiter);
+        waiter->m_timer.expires_from_now(boost::posix_time::microseconds(timeout.count()));
+        waiter->m_timer.async_wait([weak_pool, weak_waiter](const boost::system::error_code& ec) {
+            if (ec)
+            {
+                return;
+            }
+
+            auto pool = weak_pool.lock();
+            auto waiter = weak_waiter.lock();
+            if (pool && waiter)
+            {
+                pool->abandon_wait(waiter, boost::asio::error::timed_out);
+            }
+        });
+    }
+
+    // Note: must be called under m_lock
+    std::shared_ptr<asio_connection> try_acquire_locked(host_connections& host, bool& slot_reserved)
+    {
+        auto conn = host.m_idle.try_acquire();
+        if (conn)
+        {
+            conn->start_reuse();
+            ++m_reused;
+        }
+        else if (host.m_waiters.empty() &&
+                 (m_max_connections_per_host == 0 || host.m_open < m_max_connections_per_host))
+        {
+            ++host.m_open;
+            slot_reserved = true;
+        }
+
+        return conn;
+    }
+
+    // Note: must be called under m_lock
+    static std::shared_ptr<pool_waiter> take_waiter(host_connections& host)
+    {
+        auto waiter = std::move(host.m_waiters.front());
+        host.m_waiters.pop_front();
+        waiter->m_done = true;
+        boost::system::error_code ignored;
+        waiter->m_timer.cancel(ignored);
+        return waiter;
+    }
+
+    void abandon_wait(const std::shared_ptr<pool_waiter>& waiter, const boost::system::error_code& ec)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (waiter->m_done)
+            {
+                return;
+            }
+
+            waiter->m_done = true;
+            boost::system::error_code ignored;
+            waiter->m_timer.cancel(ignored);
+
+            auto& waiters = m_connections[waiter->m_cn_hostname].m_waiters;
+            waiters.erase(std::remove(waiters.begin(), waiters.end(), waiter), waiters.end());
+            if (ec == boost::asio::error::timed_out)
+            {
+                ++m_wait_timeouts;
+            }
+        }
+
+        complete_wait(std::shared_ptr<pool_waiter>(waiter), nullptr, ec);
+    }
+
+    // Note: must not be called under m_lock, as the last references to the waiter (and through it the waiting
+    // request) or to the connection may be dropped here.
+    static void complete_wait(std::shared_ptr<pool_waiter>&& waiter,
+                              std::shared_ptr<asio_connection>&& connection,
+                              const boost::system::error_code& ec)
+    {
+        crossplat::threadpool::shared_instance().service().post([waiter, connection, ec]() {
+            // A canceled token has already invoked, or is invoking, the callback.
+            if (waiter->m_token != pplx::cancellation_token::none() && !waiter->m_token.is_canceled())
+            {
+                waiter->m_token.deregister_callback(waiter->m_registration);
+            }
+
+            waiter->m_handler(connection, ec);
+        });
+    }
+
     // Note: must be called under m_lock
     static void start_epoch_interval(const std::shared_ptr<asio_connection_pool>& pool)
     {
         auto& self = *pool;
         std::weak_ptr<asio_connection_pool> weak_pool = pool;
 
-        self.m_pool_epoch_timer.expires_from_now(boost::posix_time::seconds(30));
+        self.m_pool_epoch_timer.expires_from_now(boost::posix_time::microseconds(self.m_eviction_interval.count()));
         self.m_pool_epoch_timer.async_wait([weak_pool](const boost::system::error_code& ec) {
             if (ec)
             {
@@ -442,68 +1273,205 @@ private:
                 return;
             }
 
+            // Stale connections return their slots to the pool when destroyed, so they must outlive the lock. The
+            // minimum of idle connections is kept, except for those the server closed while they were idle, which
+            // are replaced below.
+            std::vector<std::shared_ptr<asio_connection>> stale_connections;
+            std::vector<std::string> cold_hosts;
+            const auto usable = [](asio_connection& connection) { return !connection.closed_by_server(); };
+
             auto& self = *pool;
-            std::lock_guard<std::mutex> lock(self.m_lock);
-            bool restartTimer = false;
-            for (auto& entry : self.m_connections)
             {
-                if (entry.second.free_stale_connections())
+                std::lock_guard<std::mutex> lock(self.m_lock);
+                bool restartTimer = false;
+                for (auto& entry : self.m_connections)
                 {
-                    restartTimer = true;
+                    auto& host = entry.second;
+                    if (host.m_idle.free_stale_connections(stale_connections, self.m_min_idle_per_host, usable))
+                    {
+                        restartTimer = true;
+                    }
+
+                    if (host.m_idle.size() + host.m_warming < self.m_min_idle_per_host)
+                    {
+                        cold_hosts.push_back(entry.first);
+                        restartTimer = true;
+                    }
                 }
-            }
 
-            if (restartTimer)
-            {
-                start_epoch_interval(pool);
+                if (restartTimer)
+                {
+                    start_epoch_interval(pool);
+                }
+                else
+                {
+                    self.m_is_timer_running = false;
+                }
             }
-            else
+
+            stale_connections.clear();
+            if (self.m_warm_handler)
             {
-                self.m_is_timer_running = false;
+                for (const auto& cn_hostname : cold_hosts)
+                {
+                    self.m_warm_handler(cn_hostname);
+                }
             }
         });
     }
 
     std::mutex m_lock;
-    std::map<std::string, connection_pool_stack<asio_connection>> m_connections;
+    std::map<std::string, host_connections> m_connections;
+    const size_t m_max_connections_per_host;
+    const size_t m_min_idle_per_host;
+    const std::chrono::microseconds m_eviction_interval;
+    warm_handler m_warm_handler;
+    uint64_t m_created;
+    uint64_t m_reused;
+    uint64_t m_wait_timeouts;
     bool m_is_timer_running;
     boost::asio::deadline_timer m_pool_epoch_timer;
 };
 
+asio_connection::~asio_connection()
+{
+    close();
+
+    // Give back this connection's slot, possibly to a request waiting on the host's connection limit.
+    auto pool = m_pool.lock();
+    if (pool)
+    {
+        pool->release_slot(m_pool_key);
+    }
+}
+
+class asio_context;
+
 class asio_client final : public _http_client_communicator
 {
+    friend class asio_connection_warmer;
+
 public:
     asio_client(http::uri&& address, http_client_config&& client_config)
         : _http_client_communicator(std::move(address), std::move(client_config))
-        , m_pool(std::make_shared<asio_connection_pool>())
+        , m_pool(std::make_shared<asio_connection_pool>(
+              this->client_config().max_connections_per_host(),
+              this->client_config().min_idle_connections_per_host(),
+              this->client_config().connection_pool_eviction_interval<std::chrono::microseconds>()))
+        , m_dns_cache(this->client_config().dns_resolver()
+                          ? std::make_shared<asio_dns_cache>(this->client_config().dns_resolver())
+                          : asio_dns_cache::shared_instance())
     {
     }
 
     virtual void send_request(const std::shared_ptr<request_context>& request_ctx) override;
 
+    virtual connection_pool_stats pool_stats() const override { return m_pool->stats(); }
+
+    virtual pplx::task<size_t> prewarm(size_t count) override;
+
+    // Sending only starts asynchronous operations, but some of its first-use work then also runs on the caller's
+    // thread: the SSL context is set up with the first connection that needs it, which loads the system's certificate
+    // store and calls the ssl_context_callback, and new connections call the nativehandle_options callback and the
+    // dns_resolver of the client. Those callbacks must not block on requests of the same client.
+    virtual bool sends_without_blocking() const override { return true; }
+
+    // Has the pool replace the idle connections its hosts are missing from the configured minimum.
+    void keep_connections_warm()
+    {
+        if (this->client_config().min_idle_connections_per_host() == 0)
+        {
+            return;
+        }
+
+        std::weak_ptr<asio_client> weak_client = std::static_pointer_cast<asio_client>(shared_from_this());
+        m_pool->set_warm_handler([weak_client](const std::string& cn_host) {
+            auto client = weak_client.lock();
+            if (client)
+            {
+                client->warm_connections(cn_host, client->client_config().min_idle_connections_per_host());
+            }
+        });
+    }
+
     void release_connection(std::shared_ptr<asio_connection>&& conn) { m_pool->release(std::move(conn)); }
 
+    // Returns nullptr if the host has reached its connection limit; send_request() then waits for a connection.
     std::shared_ptr<asio_connection> obtain_connection(const http_request& req)
     {
         std::string cn_host = calc_cn_host(base_uri(), req.headers());
-        std::shared_ptr<asio_connection> conn = m_pool->try_acquire(cn_host);
-        if (conn == nullptr)
+        bool slot_reserved = false;
+        std::shared_ptr<asio_connection> conn = m_pool->try_acquire(cn_host, slot_reserved);
+        if (conn == nullptr && slot_reserved)
         {
             // Pool was empty. Create a new connection
-            conn = std::make_shared<asio_connection>(crossplat::threadpool::shared_instance().service());
-            if (base_uri().scheme() == U("https") && !this->client_config().proxy().is_specified())
-            {
-                conn->upgrade_to_ssl(std::move(cn_host), this->client_config().get_ssl_context_callback());
-            }
+            conn = create_connection(std::move(cn_host));
         }
 
         return conn;
     }
 
+    // Resolves a host name through the DNS cache of the client.
+    pplx::task<std::vector<tcp::endpoint>> resolve(const std::string& host, const std::string& port)
+    {
+        const auto& config = this->client_config();
+        return m_dns_cache->resolve(host,
+                                    port,
+                                    config.dns_cache_ttl<std::chrono::microseconds>(),
+                                    config.dns_negative_cache_ttl<std::chrono::microseconds>());
+    }
+
+    // The SSL context of the connections, which is set up when the first of them needs it.
+    std::shared_ptr<asio_ssl_context> ssl_context()
+    {
+        std::lock_guard<std::mutex> lock(m_ssl_context_lock);
+        if (!m_ssl_context)
+        {
+            m_ssl_context = std::make_shared<asio_ssl_context>(this->client_config().get_ssl_context_callback());
+        }
+        return m_ssl_context;
+    }
+
     virtual pplx::task<http_response> propagate(http_request request) override;
 
 private:
+    // Note: a slot for the connection must have been reserved in the pool.
+    std::shared_ptr<asio_connection> create_connection(std::string&& cn_host)
+    {
+        std::shared_ptr<asio_connection> conn;
+        try
+        {
+            conn = std::make_shared<asio_connection>(crossplat::threadpool::shared_instance().service());
+        }
+        catch (...)
+        {
+            m_pool->release_slot(cn_host);
+            throw;
+        }
+
+        m_pool->adopt(*conn, cn_host);
+        upgrade_new_connection(*conn, std::move(cn_host));
+        return conn;
+    }
+
+    void upgrade_new_connection(asio_connection& conn, std::string&& cn_host)
+    {
+        if (base_uri().scheme() == U("https") && !this->client_config().proxy().is_specified())
+        {
+            conn.upgrade_to_ssl(std::move(cn_host), ssl_context());
+        }
+    }
+
+    void wait_for_connection(const std::shared_ptr<asio_context>& ctx);
+
+    // Opens the connections the host needs to have `target` idle connections.
+    pplx::task<size_t> warm_connections(const std::string& cn_host, size_t target);
+
     const std::shared_ptr<asio_connection_pool> m_pool;
+    const std::shared_ptr<asio_dns_cache> m_dns_cache;
+
+    std::mutex m_ssl_context_lock;
+    std::shared_ptr<asio_ssl_context> m_ssl_context;
 };
 
 class asio_context final : public request_context, public std::enable_shared_from_this<asio_context>
@@ -518,11 +1486,8 @@ public:
         , m_content_length(0)
         , m_needChunked(false)
         , m_timer(client->client_config().timeout<std::chrono::microseconds>())
-        , m_resolver(crossplat::threadpool::shared_instance().service())
         , m_connection(connection)
-#ifdef CPPREST_PLATFORM_ASIO_CERT_VERIFICATION_AVAILABLE
         , m_openssl_failed(false)
-#endif // CPPREST_PLATFORM_ASIO_CERT_VERIFICATION_AVAILABLE
     {
     }
 
@@ -581,72 +1546,52 @@ public:
 
             m_context->m_timer.start();
 
-            tcp::resolver::query query(utility::conversions::to_utf8string(proxy_host), to_string(proxy_port));
-
-            auto client = std::static_pointer_cast<asio_client>(m_context->m_http_client);
-            m_context->m_resolver.async_resolve(query,
-                                                boost::bind(&ssl_proxy_tunnel::handle_resolve,
-                                                            shared_from_this(),
-                                                            boost::asio::placeholders::error,
-                                                            boost::asio::placeholders::iterator));
+            auto self = shared_from_this();
+            m_context->async_resolve(
+                utility::conversions::to_utf8string(proxy_host),
+                to_string(proxy_port),
+                [self](const boost::system::error_code& ec, std::vector<tcp::endpoint>& endpoints) {
+                    self->handle_resolve(ec, endpoints);
+                });
         }
 
     private:
-        void handle_resolve(const boost::system::error_code& ec, tcp::resolver::iterator endpoints)
+        void handle_resolve(const boost::system::error_code& ec, std::vector<tcp::endpoint>& endpoints)
         {
             if (ec)
             {
                 m_context->report_error("Error resolving proxy address", ec, httpclient_errorcode_context::connect);
             }
+            else if (endpoints.empty())
+            {
+                m_context->report_error("Failed to resolve proxy address", ec, httpclient_errorcode_context::connect);
+            }
             else
             {
                 m_context->m_timer.reset();
-                auto endpoint = *endpoints;
-                m_context->m_connection->async_connect(endpoint,
+                m_context->m_connection->async_connect(std::move(endpoints),
+                                                       m_context->connection_attempt_delay(),
                                                        boost::bind(&ssl_proxy_tunnel::handle_tcp_connect,
                                                                    shared_from_this(),
-                                                                   boost::asio::placeholders::error,
-                                                                   ++endpoints));
+                                                                   boost::asio::placeholders::error));
             }
         }
 
-        void handle_tcp_connect(const boost::system::error_code& ec, tcp::resolver::iterator endpoints)
+        void handle_tcp_connect(const boost::system::error_code& ec)
         {
             if (!ec)
-            {
-                m_context->m_timer.reset();
-                m_context->m_connection->enable_no_delay();
-                m_context->m_connection->async_write(m_request,
-                                                     boost::bind(&ssl_proxy_tunnel::handle_write_request,
-                                                                 shared_from_this(),
-                                                                 boost::asio::placeholders::error));
-            }
-            else if (endpoints == tcp::resolver::iterator())
-            {
-                m_context->report_error(
-                    "Failed to connect to any resolved proxy endpoint", ec, httpclient_errorcode_context::connect);
-            }
-            else
-            {
-                m_context->m_timer.reset();
-                //// Replace the connection. This causes old connection object to go out of scope.
-                auto client = std::static_pointer_cast<asio_client>(m_context->m_http_client);
-                try
-                {
-                    m_context->m_connection = client->obtain_connection(m_context->m_request);
-                }
-                catch (...)
-                {
-                    m_context->report_exception(std::current_exception());
-                    return;
-                }
-
-                auto endpoint = *endpoints;
-                m_context->m_connection->async_connect(endpoint,
-                                                       boost::bind(&ssl_proxy_tunnel::handle_tcp_connect,
-                                                                   shared_from_this(),
-                                                                   boost::asio::placeholders::error,
-                                                                   ++endpoints));
+            {
+                m_context->m_timer.reset();
+                m_context->m_connection->enable_no_delay();
+                m_context->m_connection->async_write(m_request,
+                                                     boost::bind(&ssl_proxy_tunnel::handle_write_request,
+                                                                 shared_from_this(),
+                                                                 boost::asio::placeholders::error));
+            }
+            else
+            {
+                m_context->report_error(
+                    "Failed to connect to any resolved proxy endpoint", ec, httpclient_errorcode_context::connect);
             }
         }
 
@@ -785,13 +1730,15 @@ public:
                 return;
             }
 
-            std::ostream request_stream(&ctx->m_body_buf);
-            request_stream.imbue(std::locale::classic());
+            // The head of the request is formatted in a buffer of the connection, which keeps its storage.
+            std::string& request_head = ctx->m_connection->request_head();
+            request_head.clear();
             const auto& host = utility::conversions::to_utf8string(base_uri.host());
 
-            request_stream << utility::conversions::to_utf8string(method) << " "
-                           << utility::conversions::to_utf8string(encoded_resource) << " "
-                           << "HTTP/1.1\r\n";
+            append_utf8(request_head, method);
+            request_head.push_back(' ');
+            append_utf8(request_head, encoded_resource);
+            request_head.append(" HTTP/1.1\r\n");
 
             int port = base_uri.port();
 
@@ -803,30 +1750,36 @@ public:
             // Add the Host header if user has not specified it explicitly
             if (!ctx->m_request.headers().has(header_names::host))
             {
-                request_stream << "Host: " << host;
+                request_head.append("Host: ").append(host);
                 if (!base_uri.is_port_default())
                 {
-                    request_stream << ":" << port;
+                    request_head.push_back(':');
+                    request_head.append(to_string(port));
                 }
-                request_stream << CRLF;
+                request_head.append(CRLF);
             }
 
-            // Extra request headers are constructed here.
-            std::string extra_headers;
+            for (const auto& header : ctx->m_request.headers())
+            {
+                append_utf8(request_head, header.first);
+                request_head.push_back(':');
+                append_utf8(request_head, header.second);
+                request_head.append(CRLF);
+            }
 
             // Add header for basic proxy authentication
             if (proxy_type == http_proxy_type::http &&
                 ctx->m_http_client->client_config().proxy().credentials().is_set())
             {
-                extra_headers.append(ctx->generate_basic_proxy_auth_header());
+                request_head.append(ctx->generate_basic_proxy_auth_header());
             }
 
             if (ctx->m_http_client->client_config().credentials().is_set())
             {
-                extra_headers.append(ctx->generate_basic_auth_header());
+                request_head.append(ctx->generate_basic_auth_header());
             }
 
-            extra_headers += utility::conversions::to_utf8string(ctx->get_compression_header());
+            append_utf8(request_head, ctx->get_compression_header());
 
             // Check user specified transfer-encoding.
             std::string transferencoding;
@@ -841,28 +1794,25 @@ public:
                 if (ctx->m_request.body())
                 {
                     ctx->m_needChunked = true;
-                    extra_headers.append("Transfer-Encoding:chunked\r\n");
+                    request_head.append("Transfer-Encoding:chunked\r\n");
                 }
                 else if (ctx->m_request.method() == methods::POST || ctx->m_request.method() == methods::PUT)
                 {
                     // Some servers do not accept POST/PUT requests with a content length of 0, such as
                     // lighttpd - http://serverfault.com/questions/315849/curl-post-411-length-required
                     // old apache versions - https://issues.apache.org/jira/browse/TS-2902
-                    extra_headers.append("Content-Length: 0\r\n");
+                    request_head.append("Content-Length: 0\r\n");
                 }
             }
 
             if (proxy_type == http_proxy_type::http)
             {
-                extra_headers.append("Cache-Control: no-store, no-cache\r\n"
-                                     "Pragma: no-cache\r\n");
+                request_head.append("Cache-Control: no-store, no-cache\r\n"
+                                    "Pragma: no-cache\r\n");
             }
 
-            request_stream << utility::conversions::to_utf8string(
-                ::web::http::details::flatten_http_headers(ctx->m_request.headers()));
-            request_stream << extra_headers;
             // Enforce HTTP connection keep alive (even for the old HTTP/1.0 protocol).
-            request_stream << "Connection: Keep-Alive\r\n\r\n";
+            request_head.append("Connection: Keep-Alive\r\n\r\n");
 
             // Start connection timeout timer.
             if (!ctx->m_timer.has_started())
@@ -885,12 +1835,12 @@ public:
                 auto tcp_host = proxy_type == http_proxy_type::http ? proxy_host : host;
                 auto tcp_port = proxy_type == http_proxy_type::http ? proxy_port : port;
 
-                tcp::resolver::query query(tcp_host, to_string(tcp_port));
-                ctx->m_resolver.async_resolve(query,
-                                              boost::bind(&asio_context::handle_resolve,
-                                                          ctx,
-                                                          boost::asio::placeholders::error,
-                                                          boost::asio::placeholders::iterator));
+                ctx->async_resolve(
+                    tcp_host,
+                    to_string(tcp_port),
+                    [ctx](const boost::system::error_code& ec, std::vector<tcp::endpoint>& endpoints) {
+                        ctx->handle_resolve(ec, endpoints);
+                    });
             }
 
             // Register for notification on cancellation to abort this request.
@@ -934,7 +1884,10 @@ public:
     void report_exception(std::exception_ptr exceptionPtr) override
     {
         // Don't recycle connections that had an error into the connection pool.
-        m_connection->close();
+        if (m_connection)
+        {
+            m_connection->close();
+        }
         request_context::report_exception(exceptionPtr);
     }
 
@@ -942,8 +1895,7 @@ private:
     void upgrade_to_ssl()
     {
         auto& client = static_cast<asio_client&>(*m_http_client);
-        m_connection->upgrade_to_ssl(calc_cn_host(client.base_uri(), m_request.headers()),
-                                     client.client_config().get_ssl_context_callback());
+        m_connection->upgrade_to_ssl(calc_cn_host(client.base_uri(), m_request.headers()), client.ssl_context());
     }
 
     std::string generate_basic_auth_header()
@@ -1006,7 +1958,7 @@ private:
         request_context::report_error(errorcodeValue, message);
     }
 
-    void handle_connect(const boost::system::error_code& ec, tcp::resolver::iterator endpoints)
+    void handle_connect(const boost::system::error_code& ec)
     {
         m_timer.reset();
         if (!ec)
@@ -1019,50 +1971,59 @@ private:
         {
             report_error("Request canceled by user.", ec, httpclient_errorcode_context::connect);
         }
-        else if (endpoints == tcp::resolver::iterator())
+        else
         {
             report_error("Failed to connect to any resolved endpoint", ec, httpclient_errorcode_context::connect);
         }
-        else
-        {
-            // Replace the connection. This causes old connection object to go out of scope.
-            auto client = std::static_pointer_cast<asio_client>(m_http_client);
+    }
+
+    // Resolves a host through the DNS cache of the client. The handler is called with the error of a failed lookup
+    // and the endpoints of the host, which may be empty.
+    template<typename Handler>
+    void async_resolve(const std::string& host, const std::string& port, const Handler& handler)
+    {
+        auto client = std::static_pointer_cast<asio_client>(m_http_client);
+        client->resolve(host, port).then([handler](pplx::task<std::vector<tcp::endpoint>> lookup) {
+            std::vector<tcp::endpoint> endpoints;
+            boost::system::error_code ec;
             try
             {
-                m_connection = client->obtain_connection(m_request);
+                endpoints = lookup.get();
+            }
+            catch (const boost::system::system_error& e)
+            {
+                ec = e.code();
             }
             catch (...)
             {
-                request_context::report_exception(std::current_exception());
-                return;
+                ec = boost::asio::error::host_not_found;
             }
+            handler(ec, endpoints);
+        });
+    }
 
-            auto endpoint = *endpoints;
-            m_connection->async_connect(
-                endpoint,
-                boost::bind(
-                    &asio_context::handle_connect, shared_from_this(), boost::asio::placeholders::error, ++endpoints));
-        }
+    std::chrono::milliseconds connection_attempt_delay() const
+    {
+        return m_http_client->client_config().connection_attempt_delay<std::chrono::milliseconds>();
     }
 
-    void handle_resolve(const boost::system::error_code& ec, tcp::resolver::iterator endpoints)
+    void handle_resolve(const boost::system::error_code& ec, std::vector<tcp::endpoint>& endpoints)
     {
         if (ec)
         {
             report_error("Error resolving address", ec, httpclient_errorcode_context::connect);
         }
-        else if (endpoints == tcp::resolver::iterator())
+        else if (endpoints.empty())
         {
             report_error("Failed to resolve address", ec, httpclient_errorcode_context::connect);
         }
         else
         {
             m_timer.reset();
-            auto endpoint = *endpoints;
             m_connection->async_connect(
-                endpoint,
-                boost::bind(
-                    &asio_context::handle_connect, shared_from_this(), boost::asio::placeholders::error, ++endpoints));
+                std::move(endpoints),
+                connection_attempt_delay(),
+                boost::bind(&asio_context::handle_connect, shared_from_this(), boost::asio::placeholders::error));
         }
     }
 
@@ -1091,19 +2052,24 @@ private:
         }
         else
         {
-            m_connection->async_write(
-                m_body_buf,
-                boost::bind(&asio_context::handle_write_headers, shared_from_this(), boost::asio::placeholders::error));
+            write_request_head();
         }
     }
 
+    // The head is written straight from the buffer of the connection it was formatted in.
+    void write_request_head()
+    {
+        auto request_head = boost::asio::buffer(m_connection->request_head());
+        m_connection->async_write(
+            request_head,
+            boost::bind(&asio_context::handle_write_headers, shared_from_this(), boost::asio::placeholders::error));
+    }
+
     void handle_handshake(const boost::system::error_code& ec)
     {
         if (!ec)
         {
-            m_connection->async_write(
-                m_body_buf,
-                boost::bind(&asio_context::handle_write_headers, shared_from_this(), boost::asio::placeholders::error));
+            write_request_head();
         }
         else
         {
@@ -1113,29 +2079,7 @@ private:
 
     bool handle_cert_verification(bool preverified, boost::asio::ssl::verify_context& verifyCtx)
     {
-        // OpenSSL calls the verification callback once per certificate in the chain,
-        // starting with the root CA certificate. The 'leaf', non-Certificate Authority (CA)
-        // certificate, i.e. actual server certificate is at the '0' position in the
-        // certificate chain, the rest are optional intermediate certificates, followed
-        // finally by the root CA self signed certificate.
-
-#ifdef CPPREST_PLATFORM_ASIO_CERT_VERIFICATION_AVAILABLE
-        // If OpenSSL fails we will doing verification at the end using the whole certificate
-        // chain so wait until the 'leaf' cert. For now return true so OpenSSL continues down
-        // the certificate chain.
-        if (!preverified)
-        {
-            m_openssl_failed = true;
-        }
-
-        if (m_openssl_failed)
-        {
-            return verify_cert_chain_platform_specific(verifyCtx, m_connection->cn_hostname());
-        }
-#endif // CPPREST_PLATFORM_ASIO_CERT_VERIFICATION_AVAILABLE
-
-        boost::asio::ssl::rfc2818_verification rfc2818(m_connection->cn_hostname());
-        return rfc2818(preverified, verifyCtx);
+        return verify_certificate(preverified, verifyCtx, m_connection->cn_hostname(), m_openssl_failed);
     }
 
     void handle_write_headers(const boost::system::error_code& ec)
@@ -1186,38 +2130,42 @@ private:
             m_body_buf.prepare(chunkSize + http::details::chunked_encoding::additional_encoding_space));
         const auto this_request = shared_from_this();
         readbuf.getn(buf + http::details::chunked_encoding::data_offset, chunkSize)
-            .then([this_request, buf, chunkSize AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
-                size_t readSize = 0;
-                try
-                {
-                    readSize = op.get();
-                }
-                catch (...)
-                {
-                    this_request->report_exception(std::current_exception());
-                    return;
-                }
+            .then(
+                [this_request, buf, chunkSize AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
+                    size_t readSize = 0;
+                    try
+                    {
+                        readSize = op.get();
+                    }
+                    catch (...)
+                    {
+                        this_request->report_exception(std::current_exception());
+                        return;
+                    }
 
-                const size_t offset = http::details::chunked_encoding::add_chunked_delimiters(
-                    buf, chunkSize + http::details::chunked_encoding::additional_encoding_space, readSize);
-                this_request->m_body_buf.commit(readSize + http::details::chunked_encoding::additional_encoding_space);
-                this_request->m_body_buf.consume(offset);
-                this_request->m_uploaded += static_cast<uint64_t>(readSize);
+                    const size_t offset = http::details::chunked_encoding::add_chunked_delimiters(
+                        buf, chunkSize + http::details::chunked_encoding::additional_encoding_space, readSize);
+                    this_request->m_body_buf.commit(readSize +
+                                                    http::details::chunked_encoding::additional_encoding_space);
+                    this_request->m_body_buf.consume(offset);
+                    this_request->m_uploaded += static_cast<uint64_t>(readSize);
 
-                if (readSize != 0)
-                {
-                    this_request->m_connection->async_write(this_request->m_body_buf,
-                                                            boost::bind(&asio_context::handle_write_chunked_body,
-                                                                        this_request,
-                                                                        boost::asio::placeholders::error));
-                }
-                else
-                {
-                    this_request->m_connection->async_write(
-                        this_request->m_body_buf,
-                        boost::bind(&asio_context::handle_write_body, this_request, boost::asio::placeholders::error));
-                }
-            });
+                    if (readSize != 0)
+                    {
+                        this_request->m_connection->async_write(this_request->m_body_buf,
+                                                                boost::bind(&asio_context::handle_write_chunked_body,
+                                                                            this_request,
+                                                                            boost::asio::placeholders::error));
+                    }
+                    else
+                    {
+                        this_request->m_connection->async_write(this_request->m_body_buf,
+                                                                boost::bind(&asio_context::handle_write_body,
+                                                                            this_request,
+                                                                            boost::asio::placeholders::error));
+                    }
+                },
+                pplx::task_continuation_context::use_synchronous_execution());
     }
 
     void handle_write_large_body(const boost::system::error_code& ec)
@@ -1248,29 +2196,31 @@ private:
             static_cast<uint64_t>(m_http_client->client_config().chunksize()), m_content_length - m_uploaded));
         auto readbuf = _get_readbuffer();
         readbuf.getn(boost::asio::buffer_cast<uint8_t*>(m_body_buf.prepare(readSize)), readSize)
-            .then([this_request AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
-                try
-                {
-                    const auto actualReadSize = op.get();
-                    if (actualReadSize == 0)
+            .then(
+                [this_request AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
+                    try
+                    {
+                        const auto actualReadSize = op.get();
+                        if (actualReadSize == 0)
+                        {
+                            this_request->report_exception(http_exception(
+                                "Unexpected end of request body stream encountered before Content-Length satisfied."));
+                            return;
+                        }
+                        this_request->m_uploaded += static_cast<uint64_t>(actualReadSize);
+                        this_request->m_body_buf.commit(actualReadSize);
+                        this_request->m_connection->async_write(this_request->m_body_buf,
+                                                                boost::bind(&asio_context::handle_write_large_body,
+                                                                            this_request,
+                                                                            boost::asio::placeholders::error));
+                    }
+                    catch (...)
                     {
-                        this_request->report_exception(http_exception(
-                            "Unexpected end of request body stream encountered before Content-Length satisfied."));
+                        this_request->report_exception(std::current_exception());
                         return;
                     }
-                    this_request->m_uploaded += static_cast<uint64_t>(actualReadSize);
-                    this_request->m_body_buf.commit(actualReadSize);
-                    this_request->m_connection->async_write(this_request->m_body_buf,
-                                                            boost::bind(&asio_context::handle_write_large_body,
-                                                                        this_request,
-                                                                        boost::asio::placeholders::error));
-                }
-                catch (...)
-                {
-                    this_request->report_exception(std::current_exception());
-                    return;
-                }
-            });
+                },
+                pplx::task_continuation_context::use_synchronous_execution());
     }
 
     void handle_write_body(const boost::system::error_code& ec)
@@ -1406,6 +2356,9 @@ private:
             new_ctx->m_request_completion = m_request_completion;
             new_ctx->m_cancellationRegistration = m_cancellationRegistration;
 
+            // The resent request still holds the place of its ordering key.
+            new_ctx->m_ordering_key = m_ordering_key;
+
             auto client = std::static_pointer_cast<asio_client>(m_http_client);
             // Resend the request using the new context.
             client->send_request(new_ctx);
@@ -1664,47 +2617,52 @@ private:
                         auto shared_decompressed = std::make_shared<std::vector<uint8_t>>(std::move(decompressed));
 
                         writeBuffer.putn_nocopy(shared_decompressed->data(), shared_decompressed->size())
-                            .then([this_request, to_read, shared_decompressed AND_CAPTURE_MEMBER_FUNCTION_POINTERS](
-                                      pplx::task<size_t> op) {
+                            .then(
+                                [this_request, to_read, shared_decompressed AND_CAPTURE_MEMBER_FUNCTION_POINTERS](
+                                    pplx::task<size_t> op) {
+                                    try
+                                    {
+                                        op.get();
+                                        this_request->m_body_buf.consume(to_read + CRLF.size()); // consume crlf
+                                        this_request->m_connection->async_read_until(
+                                            this_request->m_body_buf,
+                                            CRLF,
+                                            boost::bind(&asio_context::handle_chunk_header,
+                                                        this_request,
+                                                        boost::asio::placeholders::error));
+                                    }
+                                    catch (...)
+                                    {
+                                        this_request->report_exception(std::current_exception());
+                                        return;
+                                    }
+                                },
+                                pplx::task_continuation_context::use_synchronous_execution());
+                    }
+                }
+                else
+                {
+                    writeBuffer.putn_nocopy(boost::asio::buffer_cast<const uint8_t*>(m_body_buf.data()), to_read)
+                        .then(
+                            [this_request, to_read AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
                                 try
                                 {
-                                    op.get();
-                                    this_request->m_body_buf.consume(to_read + CRLF.size()); // consume crlf
-                                    this_request->m_connection->async_read_until(
-                                        this_request->m_body_buf,
-                                        CRLF,
-                                        boost::bind(&asio_context::handle_chunk_header,
-                                                    this_request,
-                                                    boost::asio::placeholders::error));
+                                    op.wait();
                                 }
                                 catch (...)
                                 {
                                     this_request->report_exception(std::current_exception());
                                     return;
                                 }
-                            });
-                    }
-                }
-                else
-                {
-                    writeBuffer.putn_nocopy(boost::asio::buffer_cast<const uint8_t*>(m_body_buf.data()), to_read)
-                        .then([this_request, to_read AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
-                            try
-                            {
-                                op.wait();
-                            }
-                            catch (...)
-                            {
-                                this_request->report_exception(std::current_exception());
-                                return;
-                            }
-                            this_request->m_body_buf.consume(to_read + CRLF.size()); // consume crlf
-                            this_request->m_connection->async_read_until(this_request->m_body_buf,
-                                                                         CRLF,
-                                                                         boost::bind(&asio_context::handle_chunk_header,
-                                                                                     this_request,
-                                                                                     boost::asio::placeholders::error));
-                        });
+                                this_request->m_body_buf.consume(to_read + CRLF.size()); // consume crlf
+                                this_request->m_connection->async_read_until(
+                                    this_request->m_body_buf,
+                                    CRLF,
+                                    boost::bind(&asio_context::handle_chunk_header,
+                                                this_request,
+                                                boost::asio::placeholders::error));
+                            },
+                            pplx::task_continuation_context::use_synchronous_execution());
                 }
             }
         }
@@ -1794,15 +2752,45 @@ private:
                     auto shared_decompressed = std::make_shared<std::vector<uint8_t>>(std::move(decompressed));
 
                     writeBuffer.putn_nocopy(shared_decompressed->data(), shared_decompressed->size())
-                        .then([this_request, read_size, shared_decompressed AND_CAPTURE_MEMBER_FUNCTION_POINTERS](
-                                  pplx::task<size_t> op) {
+                        .then(
+                            [this_request, read_size, shared_decompressed AND_CAPTURE_MEMBER_FUNCTION_POINTERS](
+                                pplx::task<size_t> op) {
+                                size_t writtenSize = 0;
+                                (void)writtenSize;
+                                try
+                                {
+                                    writtenSize = op.get();
+                                    this_request->m_downloaded += static_cast<uint64_t>(read_size);
+                                    this_request->m_body_buf.consume(read_size);
+                                    this_request->async_read_until_buffersize(
+                                        static_cast<size_t>((std::min)(
+                                            static_cast<uint64_t>(
+                                                this_request->m_http_client->client_config().chunksize()),
+                                            this_request->m_content_length - this_request->m_downloaded)),
+                                        boost::bind(&asio_context::handle_read_content,
+                                                    this_request,
+                                                    boost::asio::placeholders::error));
+                                }
+                                catch (...)
+                                {
+                                    this_request->report_exception(std::current_exception());
+                                    return;
+                                }
+                            },
+                            pplx::task_continuation_context::use_synchronous_execution());
+                }
+            }
+            else
+            {
+                writeBuffer.putn_nocopy(boost::asio::buffer_cast<const uint8_t*>(m_body_buf.data()), read_size)
+                    .then(
+                        [this_request AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
                             size_t writtenSize = 0;
-                            (void)writtenSize;
                             try
                             {
                                 writtenSize = op.get();
-                                this_request->m_downloaded += static_cast<uint64_t>(read_size);
-                                this_request->m_body_buf.consume(read_size);
+                                this_request->m_downloaded += static_cast<uint64_t>(writtenSize);
+                                this_request->m_body_buf.consume(writtenSize);
                                 this_request->async_read_until_buffersize(
                                     static_cast<size_t>((std::min)(
                                         static_cast<uint64_t>(this_request->m_http_client->client_config().chunksize()),
@@ -1816,33 +2804,8 @@ private:
                                 this_request->report_exception(std::current_exception());
                                 return;
                             }
-                        });
-                }
-            }
-            else
-            {
-                writeBuffer.putn_nocopy(boost::asio::buffer_cast<const uint8_t*>(m_body_buf.data()), read_size)
-                    .then([this_request AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
-                        size_t writtenSize = 0;
-                        try
-                        {
-                            writtenSize = op.get();
-                            this_request->m_downloaded += static_cast<uint64_t>(writtenSize);
-                            this_request->m_body_buf.consume(writtenSize);
-                            this_request->async_read_until_buffersize(
-                                static_cast<size_t>((std::min)(
-                                    static_cast<uint64_t>(this_request->m_http_client->client_config().chunksize()),
-                                    this_request->m_content_length - this_request->m_downloaded)),
-                                boost::bind(&asio_context::handle_read_content,
-                                            this_request,
-                                            boost::asio::placeholders::error));
-                        }
-                        catch (...)
-                        {
-                            this_request->report_exception(std::current_exception());
-                            return;
-                        }
-                    });
+                        },
+                        pplx::task_continuation_context::use_synchronous_execution());
             }
         }
         else
@@ -1938,25 +2901,31 @@ private:
     uint64_t m_content_length;
     bool m_needChunked;
     timeout_timer m_timer;
-    tcp::resolver m_resolver;
     boost::asio::streambuf m_body_buf;
     std::shared_ptr<asio_connection> m_connection;
 
-#ifdef CPPREST_PLATFORM_ASIO_CERT_VERIFICATION_AVAILABLE
     bool m_openssl_failed;
-#endif // CPPREST_PLATFORM_ASIO_CERT_VERIFICATION_AVAILABLE
 };
 
 std::shared_ptr<_http_client_communicator> create_platform_final_pipeline_stage(uri&& base_uri,
                                                                                 http_client_config&& client_config)
 {
-    return std::make_shared<asio_client>(std::move(base_uri), std::move(client_config));
+    auto client = std::make_shared<asio_client>(std::move(base_uri), std::move(client_config));
+    client->keep_connections_warm();
+    return client;
 }
 
 void asio_client::send_request(const std::shared_ptr<request_context>& request_ctx)
 {
     auto ctx = std::static_pointer_cast<asio_context>(request_ctx);
 
+    if (!ctx->m_connection)
+    {
+        // The host has reached its connection limit.
+        wait_for_connection(ctx);
+        return;
+    }
+
     try
     {
         if (ctx->m_connection->is_ssl())
@@ -1977,6 +2946,230 @@ void asio_client::send_request(const std::shared_ptr<request_context>& request_c
     ctx->start_request();
 }
 
+void asio_client::wait_for_connection(const std::shared_ptr<asio_context>& ctx)
+{
+    auto self = std::static_pointer_cast<asio_client>(shared_from_this());
+    std::string cn_host = calc_cn_host(base_uri(), ctx->m_request.headers());
+
+    m_pool->wait(
+        cn_host,
+        client_config().connection_pool_wait_timeout<std::chrono::microseconds>(),
+        ctx->m_request._cancellation_token(),
+        [self, ctx, cn_host](const std::shared_ptr<asio_connection>& conn, const boost::system::error_code& ec) {
+            if (ec == boost::asio::error::timed_out)
+            {
+                ctx->request_context::report_error(make_error_code(std::errc::timed_out).value(),
+                                                   "Timed out waiting for a connection from the pool");
+                return;
+            }
+            else if (ec)
+            {
+                ctx->request_context::report_error(make_error_code(std::errc::operation_canceled).value(),
+                                                   "Request canceled by user.");
+                return;
+            }
+
+            try
+            {
+                // A null connection means a slot was reserved for this request.
+                ctx->m_connection = conn ? conn : self->create_connection(std::string(cn_host));
+            }
+            catch (...)
+            {
+                ctx->report_exception(std::current_exception());
+                return;
+            }
+
+            self->send_request(ctx);
+        });
+}
+
+// Opens a connection ahead of requests: connects it, performs its TLS handshake if it needs one, and releases it to
+// the pool. The task returned by warm() reports whether the connection was opened within the client timeout.
+class asio_connection_warmer final : public std::enable_shared_from_this<asio_connection_warmer>
+{
+public:
+    asio_connection_warmer(const std::shared_ptr<asio_client>& client, std::shared_ptr<asio_connection>&& connection)
+        : m_client(client)
+        , m_lock()
+        , m_connection(std::move(connection))
+        , m_cn_host(m_connection->pool_key())
+        , m_timer(crossplat::threadpool::shared_instance().service())
+        , m_openssl_failed(false)
+    {
+    }
+
+    static pplx::task<bool> warm(const std::shared_ptr<asio_client>& client,
+                                 std::shared_ptr<asio_connection>&& connection,
+                                 const std::string& host,
+                                 const std::string& port)
+    {
+        auto warmer = std::make_shared<asio_connection_warmer>(client, std::move(connection));
+        auto warmed = pplx::create_task(warmer->m_warmed);
+        warmer->start(host, port);
+        return warmed;
+    }
+
+private:
+    void start(const std::string& host, const std::string& port)
+    {
+        std::weak_ptr<asio_connection_warmer> weak_self = shared_from_this();
+        m_timer.expires_from_now(m_client->client_config().timeout<std::chrono::microseconds>());
+        m_timer.async_wait([weak_self](const boost::system::error_code& ec) {
+            auto self = weak_self.lock();
+            if (!ec && self)
+            {
+                std::lock_guard<std::mutex> lock(self->m_lock);
+                if (self->m_connection)
+                {
+                    self->m_connection->close();
+                }
+            }
+        });
+
+        auto self = shared_from_this();
+        m_client->resolve(host, port).then([self](pplx::task<std::vector<tcp::endpoint>> lookup) {
+            std::vector<tcp::endpoint> endpoints;
+            try
+            {
+                endpoints = lookup.get();
+            }
+            catch (...)
+            {
+            }
+
+            if (endpoints.empty())
+            {
+                self->finish(false);
+                return;
+            }
+
+            self->m_connection->async_connect(
+                std::move(endpoints),
+                self->m_client->client_config().connection_attempt_delay<std::chrono::milliseconds>(),
+                [self](const boost::system::error_code& ec) { self->handle_connect(ec); });
+        });
+    }
+
+    void handle_connect(const boost::system::error_code& ec)
+    {
+        if (ec)
+        {
+            finish(false);
+            return;
+        }
+
+        m_connection->enable_no_delay();
+        if (!m_connection->is_ssl())
+        {
+            finish(true);
+            return;
+        }
+
+        auto self = shared_from_this();
+        std::weak_ptr<asio_connection_warmer> weak_self = self;
+        m_connection->async_handshake(
+            boost::asio::ssl::stream_base::client,
+            m_client->client_config(),
+            [self](const boost::system::error_code& ec) { self->finish(!ec); },
+            [weak_self](bool preverified, boost::asio::ssl::verify_context& verify_context) {
+                // The connection owns the verification callback, so it must not keep the warmer alive.
+                auto self = weak_self.lock();
+                return self && verify_certificate(preverified, verify_context, self->m_cn_host, self->m_openssl_failed);
+            });
+    }
+
+    void finish(bool warmed)
+    {
+        std::shared_ptr<asio_connection> connection;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            connection = std::move(m_connection);
+        }
+
+        boost::system::error_code ignored;
+        m_timer.cancel(ignored);
+        m_client->m_pool->end_warming(m_cn_host);
+        if (warmed)
+        {
+            m_client->release_connection(std::move(connection));
+        }
+        else
+        {
+            // Gives the connection's slot back to the pool.
+            connection.reset();
+        }
+
+        m_warmed.set(warmed);
+    }
+
+    const std::shared_ptr<asio_client> m_client;
+
+    // Guards m_connection against the timer, which closes the connection if it is still being opened.
+    std::mutex m_lock;
+    std::shared_ptr<asio_connection> m_connection;
+    const std::string m_cn_host;
+    boost::asio::steady_timer m_timer;
+    bool m_openssl_failed;
+    pplx::task_completion_event<bool> m_warmed;
+};
+
+pplx::task<size_t> asio_client::prewarm(size_t count)
+{
+    return warm_connections(calc_cn_host(base_uri(), http_headers()), count);
+}
+
+pplx::task<size_t> asio_client::warm_connections(const std::string& cn_host, size_t target)
+{
+    std::string host = utility::conversions::to_utf8string(base_uri().host());
+    int port = base_uri().port();
+    if (base_uri().is_port_default())
+    {
+        port = base_uri().scheme() == U("https") ? 443 : 80;
+    }
+
+    if (client_config().proxy().is_specified())
+    {
+        if (base_uri().scheme() == U("https"))
+        {
+            // The tunnel through the proxy is set up by the first request sent over the connection.
+            return pplx::task_from_result<size_t>(0);
+        }
+
+        const auto& proxy_uri = client_config().proxy().address();
+        host = utility::conversions::to_utf8string(proxy_uri.host());
+        port = proxy_uri.port() == -1 ? 8080 : proxy_uri.port();
+    }
+
+    auto self = std::static_pointer_cast<asio_client>(shared_from_this());
+    std::vector<pplx::task<bool>> warmups;
+    const size_t reserved = m_pool->reserve_warm_slots(cn_host, target);
+    for (size_t i = 0; i < reserved; ++i)
+    {
+        std::shared_ptr<asio_connection> conn;
+        try
+        {
+            conn = create_connection(std::string(cn_host));
+        }
+        catch (...)
+        {
+            m_pool->end_warming(cn_host);
+            continue;
+        }
+
+        warmups.push_back(asio_connection_warmer::warm(self, std::move(conn), host, to_string(port)));
+    }
+
+    if (warmups.empty())
+    {
+        return pplx::task_from_result<size_t>(0);
+    }
+
+    return pplx::when_all(warmups.begin(), warmups.end()).then([](const std::vector<bool>& warmed) {
+        return static_cast<size_t>(std::count(warmed.begin(), warmed.end(), true));
+    });
+}
+
 static bool is_retrieval_redirection(status_code code)
 {
     // See https://tools.ietf.org/html/rfc7231#section-6.4
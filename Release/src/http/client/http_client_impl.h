@@ -16,9 +16,11 @@
 #include "cpprest/details/basic_types.h"
 #include "cpprest/http_client.h"
 #include "cpprest/http_msg.h"
+#include <deque>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 
 namespace web
 {
@@ -94,6 +96,9 @@ public:
     http_request m_request;
     http_response m_response;
 
+    // The ordering key of the request when it was sent, which the caller may change afterwards.
+    utility::string_t m_ordering_key;
+
     utility::size64_t m_uploaded;
     utility::size64_t m_downloaded;
 
@@ -123,18 +128,28 @@ public:
     // Asynchronously send a HTTP request and process the response.
     void async_send_request(const std::shared_ptr<request_context>& request);
 
-    void finish_request();
+    void finish_request(request_context& request);
 
     const http_client_config& client_config() const;
 
     const uri& base_uri() const;
 
+    // Snapshot of the connection pool counters; implementations without a pool report zeros.
+    virtual connection_pool_stats pool_stats() const { return connection_pool_stats(); }
+
+    // Opens connections ahead of requests; implementations without a pool open none.
+    virtual pplx::task<size_t> prewarm(size_t) { return pplx::task_from_result<size_t>(0); }
+
 protected:
     _http_client_communicator(http::uri&& address, http_client_config&& client_config);
 
     // HTTP client implementations must implement send_request.
     virtual void send_request(_In_ const std::shared_ptr<request_context>& request) = 0;
 
+    // Implementations whose send_request only starts asynchronous operations return true, so that requests are sent
+    // from the caller's thread rather than from a task scheduled for it.
+    virtual bool sends_without_blocking() const { return false; }
+
     // URI to connect to.
     const http::uri m_uri;
 
@@ -146,9 +161,19 @@ private:
     // Wraps opening the client around sending a request.
     void async_send_request_impl(const std::shared_ptr<request_context>& request);
 
+    // Sends the request inline when that does not block, otherwise from a scheduled task.
+    void start_send_request(const std::shared_ptr<request_context>& request);
+
+    // Queues the request behind the others with its ordering key; returns whether it is first and can be sent.
+    bool enqueue_ordered_request(const std::shared_ptr<request_context>& request);
+
     // Queue used to guarantee ordering of requests, when applicable.
     std::queue<std::shared_ptr<request_context>> m_requests_queue;
     bool m_outstanding;
+
+    // The requests waiting behind the one in flight for each ordering key that has a request in flight, guarded by
+    // m_client_lock.
+    std::unordered_map<utility::string_t, std::deque<std::shared_ptr<request_context>>> m_ordered_queues;
 };
 
 /// <summary>
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "cpprest/details/cpprest_compat.h"
+#include <algorithm>
+#include <iterator>
 #include <memory>
 #include <stddef.h>
 #include <vector>
@@ -42,6 +44,47 @@ public:
     // releases `released` back to the connection pool
     void release(std::shared_ptr<ConnectionIsh>&& released) { m_connections.push_back(std::move(released)); }
 
+    // number of connections currently held by the pool
+    size_t size() const CPPREST_NOEXCEPT { return m_connections.size(); }
+
+    // as free_stale_connections(), but moves the stale connections into `freed` instead of destroying them, so
+    // that the caller can control where they are destroyed
+    bool free_stale_connections(std::vector<std::shared_ptr<ConnectionIsh>>& freed)
+    {
+        assert(m_staleBefore <= m_connections.size());
+        freed.insert(freed.end(),
+                     std::make_move_iterator(m_connections.begin()),
+                     std::make_move_iterator(m_connections.begin() + m_staleBefore));
+        return free_stale_connections();
+    }
+
+    // as free_stale_connections(freed), but keeps the stale connections that `usable` accepts while fewer than `keep`
+    // connections would remain, checking the most recently released ones first; the kept ones are stale again at the
+    // next call
+    template<class Usable>
+    bool free_stale_connections(std::vector<std::shared_ptr<ConnectionIsh>>& freed, size_t keep, Usable usable)
+    {
+        assert(m_staleBefore <= m_connections.size());
+        size_t remaining = m_connections.size() - m_staleBefore;
+        const auto staleEnd = m_connections.begin() + m_staleBefore;
+        for (auto it = staleEnd; it != m_connections.begin();)
+        {
+            --it;
+            if (remaining < keep && usable(**it))
+            {
+                ++remaining;
+            }
+            else
+            {
+                freed.push_back(std::move(*it));
+            }
+        }
+
+        m_connections.erase(std::remove(m_connections.begin(), staleEnd, nullptr), staleEnd);
+        m_staleBefore = m_connections.size();
+        return (m_staleBefore != 0);
+    }
+
     bool free_stale_connections() CPPREST_NOEXCEPT
     {
         assert(m_staleBefore <= m_connections.size());
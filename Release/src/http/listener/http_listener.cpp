@@ -102,6 +102,21 @@ pplx::task<void> details::http_listener_impl::close()
     return m_close_task;
 }
 
+pplx::task<size_t> details::http_listener_impl::drain(std::chrono::milliseconds timeout)
+{
+    // Not thread safe with open and close.
+    if (m_closed) return pplx::task_from_result<size_t>(0);
+
+    return web::http::experimental::details::http_server_api::drain(this, timeout);
+}
+
+size_t details::http_listener_impl::in_flight_requests()
+{
+    if (m_closed) return 0;
+
+    return web::http::experimental::details::http_server_api::in_flight_requests(this);
+}
+
 void details::http_listener_impl::handle_request(http_request msg)
 {
     // Specific method handler takes priority over general.
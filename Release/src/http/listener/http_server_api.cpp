@@ -163,6 +163,24 @@ pplx::task<void> http_server_api::unregister_listener(
     });
 }
 
+pplx::task<size_t> http_server_api::drain(
+    _In_ web::http::experimental::listener::details::http_listener_impl* pListener, std::chrono::milliseconds timeout)
+{
+    pplx::extensibility::scoped_critical_section_t lock(s_lock);
+    if (s_server_api == nullptr)
+    {
+        return pplx::task_from_result<size_t>(0);
+    }
+    return s_server_api->drain(pListener, timeout);
+}
+
+size_t http_server_api::in_flight_requests(
+    _In_ web::http::experimental::listener::details::http_listener_impl* pListener)
+{
+    pplx::extensibility::scoped_critical_section_t lock(s_lock);
+    return s_server_api == nullptr ? 0 : s_server_api->in_flight_requests(pListener);
+}
+
 http_server* http_server_api::server_api() { return s_server_api.get(); }
 
 } // namespace details
@@ -17,8 +17,15 @@
 #include <boost/algorithm/string/find.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/asio/read_until.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <set>
 #include <sstream>
+#include <unordered_set>
 
 #if defined(__clang__)
 #pragma clang diagnostic push
@@ -33,9 +40,16 @@
 
 #include "../common/internal_http_helpers.h"
 #include "cpprest/asyncrt_utils.h"
+#include "cpprest/filestream.h"
+#include "cpprest/producerconsumerstream.h"
 #include "http_server_impl.h"
 #include "pplx/threadpool.h"
 
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/sendfile.h>
+#endif
+
 #ifdef __ANDROID__
 using utility::conversions::details::to_string;
 #else
@@ -87,8 +101,7 @@ private:
 
     pplx::extensibility::reader_writer_lock_t m_listeners_lock;
     std::map<std::string, std::unique_ptr<hostport_listener>, iequal_to> m_listeners;
-    std::unordered_map<http_listener_impl*, std::unique_ptr<pplx::extensibility::reader_writer_lock_t>>
-        m_registered_listeners;
+    std::unordered_set<http_listener_impl*> m_registered_listeners;
     bool m_started;
 
 public:
@@ -102,6 +115,9 @@ public:
     virtual pplx::task<void> register_listener(http_listener_impl* listener);
     virtual pplx::task<void> unregister_listener(http_listener_impl* listener);
 
+    virtual pplx::task<size_t> drain(http_listener_impl* listener, std::chrono::milliseconds timeout);
+    virtual size_t in_flight_requests(http_listener_impl* listener);
+
     pplx::task<void> respond(http_response response);
 };
 
@@ -116,12 +132,547 @@ private:
     linux_request_context& operator=(const linux_request_context&) = delete;
 };
 
+// A listener registered with a hostport_listener. Requests reach it without taking any lock; the count of requests
+// inside its handler lets unregister_listener wait until they have all returned.
+struct listener_route
+{
+    listener_route(http_listener_impl* listener, std::vector<std::string> parameters)
+        : m_listener(listener), m_parameters(std::move(parameters)), m_active(0), m_removed(false)
+    {
+    }
+
+    http_listener_impl* m_listener;
+
+    // The names of the {name} segments of the listener path, in order.
+    std::vector<std::string> m_parameters;
+
+    std::atomic<int> m_active;
+    std::atomic<bool> m_removed;
+    std::mutex m_idle_lock;
+    std::condition_variable m_idle;
+
+    // Returns false if the listener has been removed, in which case the request must not be handed to it.
+    bool enter()
+    {
+        ++m_active;
+        if (m_removed)
+        {
+            leave();
+            return false;
+        }
+        return true;
+    }
+
+    void leave()
+    {
+        if (--m_active == 0 && m_removed)
+        {
+            std::lock_guard<std::mutex> lock(m_idle_lock);
+            m_idle.notify_all();
+        }
+    }
+
+    // Stops new requests from reaching the listener and waits for those inside its handler to return.
+    void remove()
+    {
+        m_removed = true;
+        std::unique_lock<std::mutex> lock(m_idle_lock);
+        m_idle.wait(lock, [this] { return m_active == 0; });
+    }
+};
+
+// A node of the routing table of a hostport_listener: the segments that may follow the path leading to it, and the
+// listener registered for that path. Literal segments are kept sorted; a {name} segment matches any single segment.
+// A table is never modified once it is built, so lookups need no lock.
+struct route_node
+{
+    std::vector<std::pair<std::string, std::unique_ptr<route_node>>> m_literals;
+    std::unique_ptr<route_node> m_parameter;
+    std::shared_ptr<listener_route> m_route;
+};
+
+// The non-empty segments of a path, as uri::split_path would return them.
+std::vector<std::string> path_segments(const std::string& path)
+{
+    std::vector<std::string> segments;
+    size_t position = 0;
+    while (position < path.size())
+    {
+        auto segment_end = path.find('/', position);
+        if (segment_end == std::string::npos)
+        {
+            segment_end = path.size();
+        }
+        if (segment_end != position)
+        {
+            segments.push_back(path.substr(position, segment_end - position));
+        }
+        position = segment_end + 1;
+    }
+    return segments;
+}
+
+bool is_parameter_segment(const std::string& segment)
+{
+    return segment.size() >= 2 && segment.front() == '{' && segment.back() == '}';
+}
+
+std::unique_ptr<route_node> build_route_table(const std::map<std::string, std::shared_ptr<listener_route>>& routes)
+{
+    auto root = make_unique<route_node>();
+    for (const auto& route : routes)
+    {
+        route_node* node = root.get();
+        for (const auto& segment : path_segments(route.first))
+        {
+            if (is_parameter_segment(segment))
+            {
+                if (!node->m_parameter)
+                {
+                    node->m_parameter = make_unique<route_node>();
+                }
+                node = node->m_parameter.get();
+                continue;
+            }
+
+            auto it = std::lower_bound(
+                node->m_literals.begin(),
+                node->m_literals.end(),
+                segment,
+                [](const std::pair<std::string, std::unique_ptr<route_node>>& literal, const std::string& value) {
+                    return literal.first < value;
+                });
+            if (it == node->m_literals.end() || it->first != segment)
+            {
+                it = node->m_literals.insert(it, std::make_pair(segment, make_unique<route_node>()));
+            }
+            node = it->second.get();
+        }
+        node->m_route = route.second;
+    }
+    return root;
+}
+
+typedef std::pair<const char*, const char*> path_range;
+
+// The deepest node with a listener found so far by match_route, with the values of the parameters leading to it.
+struct route_match
+{
+    route_match() : m_node(nullptr), m_depth(0), m_end(nullptr) {}
+
+    const route_node* m_node;
+    size_t m_depth;
+    const char* m_end;
+    std::vector<path_range> m_values;
+};
+
+// Walks the table along the segments of [position, end), trying literal segments before parameters, and keeps the
+// listener whose path is the longest prefix of the request path.
+void match_route(const route_node& node,
+                 const char* position,
+                 const char* end,
+                 size_t depth,
+                 std::vector<path_range>& values,
+                 route_match& best)
+{
+    if (node.m_route && (best.m_node == nullptr || depth > best.m_depth))
+    {
+        best.m_node = &node;
+        best.m_depth = depth;
+        best.m_end = position;
+        best.m_values = values;
+    }
+
+    while (position != end && *position == '/')
+    {
+        ++position;
+    }
+    if (position == end)
+    {
+        return;
+    }
+    const char* segment_end = std::find(position, end, '/');
+    const size_t segment_size = static_cast<size_t>(segment_end - position);
+
+    auto it = std::lower_bound(
+        node.m_literals.begin(),
+        node.m_literals.end(),
+        path_range(position, segment_end),
+        [segment_size](const std::pair<std::string, std::unique_ptr<route_node>>& literal, const path_range& value) {
+            return literal.first.compare(0, std::string::npos, value.first, segment_size) < 0;
+        });
+    if (it != node.m_literals.end() && it->first.size() == segment_size &&
+        std::memcmp(it->first.data(), position, segment_size) == 0)
+    {
+        match_route(*it->second, segment_end, end, depth + 1, values, best);
+    }
+
+    if (node.m_parameter)
+    {
+        values.push_back(path_range(position, segment_end));
+        match_route(*node.m_parameter, segment_end, end, depth + 1, values, best);
+        values.pop_back();
+    }
+}
+
+inline const std::string& utf8_path(const std::string& path, std::string&) { return path; }
+
+inline const std::string& utf8_path(const utf16string& path, std::string& storage)
+{
+    storage = utility::conversions::to_utf8string(path);
+    return storage;
+}
+
+// The deadlines of the connections of a listener, kept in a hierarchical timer wheel. Each level has slot_count
+// slots; a slot of level n spans slot_count^n ticks, and its entries move down to the level below when the wheel
+// reaches it. Arming, moving and cancelling a deadline take constant time, and a single timer, which only runs while
+// deadlines are armed, serves every connection.
+class timer_wheel : public std::enable_shared_from_this<timer_wheel>
+{
+public:
+    struct link
+    {
+        link* m_prev;
+        link* m_next;
+    };
+
+    struct entry : link
+    {
+        entry() : m_deadline(0)
+        {
+            m_prev = nullptr;
+            m_next = nullptr;
+        }
+        virtual ~entry() {}
+
+        // Called, without the lock of the wheel held, once the deadline has passed.
+        virtual void expired() = 0;
+
+        uint64_t m_deadline; // in ticks
+    };
+
+    timer_wheel()
+        : m_start(std::chrono::steady_clock::now())
+        , m_timer(crossplat::threadpool::shared_instance().service())
+        , m_now(0)
+        , m_size(0)
+        , m_running(false)
+    {
+        for (auto& slot : m_slots)
+        {
+            slot.m_prev = &slot;
+            slot.m_next = &slot;
+        }
+    }
+
+    // Arms the entry to expire after the timeout, moving it if it was armed already. Returns whether it was not.
+    bool schedule(entry& e, std::chrono::milliseconds timeout)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_running)
+        {
+            // The wheel is empty, so it can jump to the current time.
+            m_now = current_tick();
+        }
+
+        const bool was_armed = e.m_next != nullptr;
+        if (was_armed)
+        {
+            unlink(e);
+        }
+        else
+        {
+            ++m_size;
+        }
+        const uint64_t ticks = (static_cast<uint64_t>(timeout.count()) + tick_ms - 1) / tick_ms;
+        insert(e, current_tick() + (std::max)(ticks, static_cast<uint64_t>(1)));
+
+        if (!m_running)
+        {
+            m_running = true;
+            wait_next_tick();
+        }
+        return !was_armed;
+    }
+
+    // Disarms the entry. Returns whether it was armed.
+    bool cancel(entry& e)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (e.m_next == nullptr)
+        {
+            return false;
+        }
+        unlink(e);
+        --m_size;
+        return true;
+    }
+
+    bool armed(const entry& e) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return e.m_next != nullptr;
+    }
+
+private:
+    static const uint64_t tick_ms = 100;
+    static const unsigned slot_bits = 6;
+    static const uint64_t slot_count = 1 << slot_bits;
+    static const unsigned level_count = 4;
+
+    uint64_t current_tick() const
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - m_start;
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) / tick_ms;
+    }
+
+    link& slot(unsigned level, uint64_t tick)
+    {
+        return m_slots[level * slot_count + ((tick >> (level * slot_bits)) & (slot_count - 1))];
+    }
+
+    void insert(entry& e, uint64_t deadline)
+    {
+        // Deadlines beyond the span of the wheel, about nineteen days, are brought in to its end.
+        const uint64_t max_delta = (static_cast<uint64_t>(1) << (level_count * slot_bits)) - 1;
+        e.m_deadline = (std::min)((std::max)(deadline, m_now), m_now + max_delta);
+
+        unsigned level = 0;
+        const uint64_t delta = e.m_deadline - m_now;
+        while (level + 1 < level_count && delta >= (static_cast<uint64_t>(1) << ((level + 1) * slot_bits)))
+        {
+            ++level;
+        }
+
+        link& head = slot(level, e.m_deadline);
+        e.m_prev = head.m_prev;
+        e.m_next = &head;
+        head.m_prev->m_next = &e;
+        head.m_prev = &e;
+    }
+
+    static void unlink(entry& e)
+    {
+        e.m_prev->m_next = e.m_next;
+        e.m_next->m_prev = e.m_prev;
+        e.m_prev = nullptr;
+        e.m_next = nullptr;
+    }
+
+    // Takes the entries out of a slot, leaving it empty.
+    static std::vector<entry*> take(link& head)
+    {
+        std::vector<entry*> entries;
+        for (link* l = head.m_next; l != &head; l = l->m_next)
+        {
+            entries.push_back(static_cast<entry*>(l));
+        }
+        for (auto e : entries)
+        {
+            e->m_prev = nullptr;
+            e->m_next = nullptr;
+        }
+        head.m_prev = &head;
+        head.m_next = &head;
+        return entries;
+    }
+
+    void advance(std::vector<entry*>& expired)
+    {
+        ++m_now;
+
+        // Whenever a level wraps, the next slot of the level above moves down.
+        for (unsigned level = 1; level < level_count; ++level)
+        {
+            if ((m_now & ((static_cast<uint64_t>(1) << (level * slot_bits)) - 1)) != 0)
+            {
+                break;
+            }
+            for (auto e : take(slot(level, m_now)))
+            {
+                insert(*e, e->m_deadline);
+            }
+        }
+
+        auto due = take(slot(0, m_now));
+        m_size -= due.size();
+        expired.insert(expired.end(), due.begin(), due.end());
+    }
+
+    void wait_next_tick()
+    {
+        auto self = shared_from_this();
+        m_timer.expires_at(m_start + std::chrono::milliseconds((m_now + 1) * tick_ms));
+        m_timer.async_wait([self](const boost::system::error_code&) { self->on_tick(); });
+    }
+
+    void on_tick()
+    {
+        std::vector<entry*> expired;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            const uint64_t target = current_tick();
+            while (m_size != 0 && m_now < target)
+            {
+                advance(expired);
+            }
+
+            m_running = m_size != 0;
+            if (m_running)
+            {
+                wait_next_tick();
+            }
+        }
+
+        for (auto e : expired)
+        {
+            e->expired();
+        }
+    }
+
+    const std::chrono::steady_clock::time_point m_start;
+    boost::asio::steady_timer m_timer;
+    mutable std::mutex m_lock;
+    std::array<link, level_count * slot_count> m_slots;
+    uint64_t m_now;  // the last tick whose deadlines have expired
+    size_t m_size;   // the number of armed entries
+    bool m_running;  // the timer is waiting for the next tick
+};
+
+// How the responses of a host and port are compressed, taken from the configuration of its first listener.
+struct response_compression
+{
+    explicit response_compression(const http_listener_config& config);
+
+    // Returns the compressor for the body of the response, or null if it is sent as it is.
+    std::unique_ptr<web::http::compression::compress_provider> make_compressor(const http_request& request,
+                                                                                const http_response& response) const;
+
+    std::vector<std::shared_ptr<web::http::compression::compress_factory>> m_factories;
+    size_t m_min_size;
+    std::vector<utility::string_t> m_types; // in lower case
+};
+
+response_compression::response_compression(const http_listener_config& config)
+    : m_factories(config.compress_factories()), m_min_size(config.compression_min_size())
+{
+    namespace builtin = web::http::compression::builtin;
+    if (m_factories.empty())
+    {
+        // The method, strategy and memory level are the zlib defaults.
+        const int level = config.compression_level();
+        if (builtin::algorithm::supported(builtin::algorithm::GZIP))
+        {
+            m_factories.push_back(web::http::compression::make_compress_factory(
+                builtin::algorithm::GZIP, [level] { return builtin::make_gzip_compressor(level, 8, 0, 8); }));
+        }
+        if (builtin::algorithm::supported(builtin::algorithm::DEFLATE))
+        {
+            m_factories.push_back(web::http::compression::make_compress_factory(
+                builtin::algorithm::DEFLATE, [level] { return builtin::make_deflate_compressor(level, 8, 0, 8); }));
+        }
+        if (builtin::algorithm::supported(builtin::algorithm::BROTLI))
+        {
+            m_factories.push_back(builtin::get_compress_factory(builtin::algorithm::BROTLI));
+        }
+    }
+
+    for (auto type : config.compressible_types())
+    {
+        utility::details::inplace_tolower(type);
+        m_types.push_back(std::move(type));
+    }
+}
+
+// Whether a comma separated header value lists the token, or "*", ignoring case.
+bool lists_token(const utility::string_t& value, const utility::string_t& token)
+{
+    size_t start = 0;
+    while (start <= value.size())
+    {
+        size_t end = value.find(_XPLATSTR(','), start);
+        if (end == utility::string_t::npos)
+        {
+            end = value.size();
+        }
+        auto item = value.substr(start, end - start);
+        web::http::details::trim_whitespace(item);
+        if (item == _XPLATSTR("*") || boost::iequals(item, token))
+        {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+std::unique_ptr<web::http::compression::compress_provider> response_compression::make_compressor(
+    const http_request& request, const http_response& response) const
+{
+    // A compressed body is sent in chunks, which HTTP/1.0 clients do not understand, and responses to HEAD requests
+    // and with these status codes have no body.
+    const auto status = response.status_code();
+    if (request.http_version() < web::http::http_versions::HTTP_1_1 || request.method() == methods::HEAD ||
+        status < 200 || status == status_codes::PartialContent || status == status_codes::NoContent ||
+        status == status_codes::NotModified)
+    {
+        return nullptr;
+    }
+
+    const auto& headers = response.headers();
+    size_t length;
+    if (headers.has(header_names::content_encoding) || headers.has(header_names::content_range) ||
+        (headers.match(header_names::content_length, length) && (length == 0 || length < m_min_size)))
+    {
+        return nullptr;
+    }
+
+    utility::string_t accepted;
+    if (!request.headers().match(header_names::accept_encoding, accepted))
+    {
+        return nullptr;
+    }
+
+    // The media type, without its parameters
+    utility::string_t type = headers.content_type();
+    type = type.substr(0, type.find(_XPLATSTR(';')));
+    type.erase(type.find_last_not_of(_XPLATSTR(" \t")) + 1);
+    utility::details::inplace_tolower(type);
+    const auto slash = type.find(_XPLATSTR('/'));
+    const bool compressible = std::any_of(m_types.begin(), m_types.end(), [&](const utility::string_t& allowed) {
+        if (allowed.size() > 2 && allowed.compare(allowed.size() - 2, 2, _XPLATSTR("/*")) == 0)
+        {
+            return slash == allowed.size() - 2 && type.compare(0, slash, allowed, 0, slash) == 0;
+        }
+        return type == allowed;
+    });
+    if (!compressible)
+    {
+        return nullptr;
+    }
+
+    try
+    {
+        return web::http::compression::details::get_compressor_from_header(
+            accepted, web::http::compression::details::header_types::accept_encoding, m_factories);
+    }
+    catch (const http_exception&)
+    {
+        // A malformed Accept-Encoding header only means the body is sent as it is.
+        return nullptr;
+    }
+}
+
 class hostport_listener
 {
 private:
     int m_backlog;
     std::unique_ptr<boost::asio::ip::tcp::acceptor> m_acceptor;
-    std::map<std::string, http_listener_impl*> m_listeners;
+
+    // The registered listeners keyed by their path, with parameter names left out, and the routing table built from
+    // them. Only writers take the lock; lookups load the current table.
+    std::map<std::string, std::shared_ptr<listener_route>> m_routes;
+    std::shared_ptr<const route_node> m_route_table;
     pplx::extensibility::reader_writer_lock_t m_listeners_lock;
 
     std::mutex m_connections_lock;
@@ -136,6 +687,34 @@ private:
     bool m_is_https;
     const std::function<void(boost::asio::ssl::context&)>& m_ssl_context_callback;
 
+    // Accepted connections are handed to the reactors in turn; without reactors they all use the shared thread pool.
+    size_t m_reactor_count;
+    size_t m_next_reactor;
+    bool m_offload_handlers;
+
+    size_t m_pipeline_depth;
+
+    // Accepting stops while m_max_connections connections are open, and resumes when one of them closes.
+    size_t m_max_connections;
+    bool m_accept_paused;
+
+    // The deadlines of the reads of the connections, or none if the timeout is zero.
+    std::chrono::milliseconds m_timeout;
+    std::shared_ptr<timer_wheel> m_deadlines;
+
+    // The limits on request bodies; zero means no limit.
+    size_t m_max_request_body_size;
+    size_t m_request_body_buffer_size;
+
+    // How responses are compressed, or none if they are sent as they are.
+    std::shared_ptr<const response_compression> m_compression;
+
+    // The number of requests of all the connections that have been read and not yet answered. The count and the event
+    // that is set with it once the connections have closed after a drain outlive the listener, so a drain can be
+    // waited on while the listener is closed.
+    std::shared_ptr<std::atomic<size_t>> m_in_flight;
+    std::shared_ptr<pplx::task_completion_event<size_t>> m_drained;
+
 public:
     hostport_listener(http_linux_server* server,
                       const std::string& hostport,
@@ -143,14 +722,32 @@ public:
                       const http_listener_config& config)
         : m_backlog(config.backlog())
         , m_acceptor()
-        , m_listeners()
+        , m_routes()
+        , m_route_table(std::make_shared<route_node>())
         , m_listeners_lock()
         , m_connections_lock()
         , m_connections()
         , m_p_server(server)
         , m_is_https(is_https)
         , m_ssl_context_callback(config.get_ssl_context_callback())
-    {
+        , m_reactor_count(config.reactor_threads())
+        , m_next_reactor(0)
+        , m_offload_handlers(config.offload_handlers())
+        , m_pipeline_depth((std::max)(config.pipeline_depth(), static_cast<size_t>(1)))
+        , m_max_connections(config.max_connections())
+        , m_accept_paused(false)
+        , m_timeout(config.timeout())
+        , m_deadlines(m_timeout.count() > 0 ? std::make_shared<timer_wheel>() : nullptr)
+        , m_max_request_body_size(config.max_request_body_size())
+        , m_request_body_buffer_size(config.request_body_buffer_size())
+        , m_compression(config.compress_responses() ? std::make_shared<response_compression>(config) : nullptr)
+        , m_in_flight(std::make_shared<std::atomic<size_t>>(0))
+    {
+        if (m_compression && m_compression->m_factories.empty())
+        {
+            m_compression.reset();
+        }
+
         m_all_connections_complete.set();
 
         std::istringstream hostport_in(hostport);
@@ -164,36 +761,71 @@ public:
 
     void start();
     void stop();
+    pplx::task<size_t> drain(std::chrono::milliseconds timeout);
 
     void add_listener(const std::string& path, http_listener_impl* listener);
-    void remove_listener(const std::string& path, http_listener_impl* listener);
+    std::shared_ptr<listener_route> remove_listener(const std::string& path, http_listener_impl* listener);
 
     void internal_erase_connection(asio_server_connection*);
 
-    http_listener_impl* find_listener(uri const& u)
+    size_t pipeline_depth() const { return m_pipeline_depth; }
+
+    bool offloads_handlers() const { return m_reactor_count != 0 && m_offload_handlers; }
+
+    std::chrono::milliseconds timeout() const { return m_timeout; }
+
+    const std::shared_ptr<timer_wheel>& deadlines() const { return m_deadlines; }
+
+    size_t max_request_body_size() const { return m_max_request_body_size; }
+
+    size_t request_body_buffer_size() const { return m_request_body_buffer_size; }
+
+    const std::shared_ptr<const response_compression>& compression() const { return m_compression; }
+
+    const std::shared_ptr<std::atomic<size_t>>& in_flight() const { return m_in_flight; }
+
+    // Finds the listener whose path is the longest prefix of the request path. For a listener path with parameters,
+    // also returns the matched prefix of the request path and the parameter values.
+    std::shared_ptr<listener_route> find_listener(const utility::string_t& request_path,
+                                                  utility::string_t& listener_path,
+                                                  std::map<utility::string_t, utility::string_t>& parameters) const
     {
-        auto path_segments = uri::split_path(uri::decode(u.path()));
-        for (auto i = static_cast<long>(path_segments.size()); i >= 0; --i)
+        auto table = std::atomic_load(&m_route_table);
+
+        // Only a percent-encoded path needs to be copied before it can be matched.
+        std::string storage;
+        const bool encoded = request_path.find(_XPLATSTR('%')) != utility::string_t::npos;
+        if (encoded)
         {
-            std::string path;
-            for (size_t j = 0; j < static_cast<size_t>(i); ++j)
-            {
-                path += "/" + utility::conversions::to_utf8string(path_segments[j]);
-            }
-            path += "/";
+            storage = utility::conversions::to_utf8string(uri::decode(request_path));
+        }
+        const std::string& path = encoded ? storage : utf8_path(request_path, storage);
 
-            pplx::extensibility::scoped_read_lock_t lock(m_listeners_lock);
-            auto it = m_listeners.find(path);
-            if (it != m_listeners.end())
+        std::vector<path_range> values;
+        route_match match;
+        match_route(*table, path.data(), path.data() + path.size(), 0, values, match);
+        if (match.m_node == nullptr)
+        {
+            return nullptr;
+        }
+
+        const auto& route = match.m_node->m_route;
+        if (!route->m_parameters.empty())
+        {
+            listener_path = uri::encode_uri(
+                utility::conversions::to_string_t(std::string(path.data(), match.m_end)), uri::components::path);
+            for (size_t i = 0; i < route->m_parameters.size(); ++i)
             {
-                return it->second;
+                parameters[utility::conversions::to_string_t(route->m_parameters[i])] =
+                    utility::conversions::to_string_t(std::string(match.m_values[i].first, match.m_values[i].second));
             }
         }
-        return nullptr;
+        return route;
     }
 
 private:
     void on_accept(std::unique_ptr<boost::asio::ip::tcp::socket> socket, const boost::system::error_code& ec);
+    void async_accept();
 };
 
 } // namespace
@@ -291,6 +923,214 @@ struct crlfcrlf_nonascii_searcher_t
     }
 } crlfcrlf_nonascii_searcher;
 
+// A range of bytes in the request buffer. The request line and headers are parsed in place, and only the parts that
+// are kept are copied into strings.
+struct buffer_range
+{
+    const char* first;
+    const char* last;
+
+    size_t size() const { return static_cast<size_t>(last - first); }
+
+    bool equals(const char* literal, size_t length) const
+    {
+        return size() == length && std::memcmp(first, literal, length) == 0;
+    }
+
+    // Compares with an ASCII string, ignoring case.
+    bool iequals(const utility::string_t& other) const
+    {
+        if (size() != other.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < other.size(); ++i)
+        {
+            const unsigned int left = static_cast<unsigned char>(first[i]);
+            const unsigned int right = static_cast<unsigned int>(other[i]);
+            const unsigned int lower = left | 0x20u;
+            if (left != right && !((left ^ right) == 0x20u && lower >= 'a' && lower <= 'z'))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void trim_whitespace()
+    {
+        while (first != last && utility::details::is_space(*first))
+        {
+            ++first;
+        }
+        while (first != last && utility::details::is_space(last[-1]))
+        {
+            --last;
+        }
+    }
+
+    std::string to_string() const { return std::string(first, last); }
+
+    utility::string_t to_string_t() const
+    {
+#ifdef _UTF16_STRINGS
+        return utility::conversions::utf8_to_utf16(to_string());
+#else
+        return to_string();
+#endif
+    }
+};
+
+// Returns the line starting at position, without its '\n' but including any '\r', and moves position past it. Like
+// std::getline, the last line of the buffer may lack a '\n'.
+buffer_range next_line(const char*& position, const char* end)
+{
+    buffer_range line {position, end};
+    auto lf = static_cast<const char*>(std::memchr(position, '\n', line.size()));
+    if (lf == nullptr)
+    {
+        position = end;
+    }
+    else
+    {
+        line.last = lf;
+        position = lf + 1;
+    }
+    return line;
+}
+
+// Returns the canonical spelling of the well known methods, which are matched ignoring case, or the method as sent.
+web::http::method parse_method(const buffer_range& verb)
+{
+    static const web::http::method* const known_methods[] = {&methods::GET,
+                                                             &methods::POST,
+                                                             &methods::PUT,
+                                                             &methods::DEL,
+                                                             &methods::HEAD,
+                                                             &methods::TRCE,
+                                                             &methods::CONNECT,
+                                                             &methods::OPTIONS};
+    for (auto known : known_methods)
+    {
+        if (verb.iequals(*known))
+        {
+            return *known;
+        }
+    }
+#ifdef _UTF16_STRINGS
+    return utility::conversions::latin1_to_utf16(verb.to_string());
+#else
+    return verb.to_string();
+#endif
+}
+
+// The body of a request read by a connection that limits how much of it is buffered. Once the limit is reached, the
+// connection waits for the handler: the waiter is called when a read leaves fewer bytes than the limit buffered, or
+// when the connection resumes it because reading must go on regardless.
+class request_body_buffer final : public concurrency::streams::details::basic_producer_consumer_buffer<uint8_t>
+{
+    typedef concurrency::streams::details::basic_producer_consumer_buffer<uint8_t> base_type;
+
+public:
+    request_body_buffer() : base_type(512), m_limit(0) {}
+
+    void wait_below(size_t limit, std::function<void()> waiter)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_waiter_lock);
+            if (in_avail() >= limit)
+            {
+                m_limit = limit;
+                m_waiter = std::move(waiter);
+                return;
+            }
+        }
+        waiter();
+    }
+
+    void resume()
+    {
+        std::function<void()> waiter;
+        {
+            std::lock_guard<std::mutex> lock(m_waiter_lock);
+            waiter.swap(m_waiter);
+        }
+        if (waiter)
+        {
+            waiter();
+        }
+    }
+
+    virtual void release(_Out_writes_opt_(count) uint8_t* ptr, _In_ size_t count) override
+    {
+        base_type::release(ptr, count);
+        consumed();
+    }
+
+protected:
+    virtual pplx::task<size_t> _getn(_Out_writes_(count) uint8_t* ptr, _In_ size_t count) override
+    {
+        auto self = std::static_pointer_cast<request_body_buffer>(shared_from_this());
+        return base_type::_getn(ptr, count).then([self](size_t read) {
+            self->consumed();
+            return read;
+        });
+    }
+
+    virtual size_t _sgetn(_Out_writes_(count) uint8_t* ptr, _In_ size_t count) override
+    {
+        const size_t read = base_type::_sgetn(ptr, count);
+        consumed();
+        return read;
+    }
+
+    virtual pplx::task<int_type> _bumpc() override
+    {
+        auto self = std::static_pointer_cast<request_body_buffer>(shared_from_this());
+        return base_type::_bumpc().then([self](int_type ch) {
+            self->consumed();
+            return ch;
+        });
+    }
+
+    virtual int_type _sbumpc() override
+    {
+        const int_type ch = base_type::_sbumpc();
+        consumed();
+        return ch;
+    }
+
+    virtual pplx::task<int_type> _nextc() override
+    {
+        auto self = std::static_pointer_cast<request_body_buffer>(shared_from_this());
+        return base_type::_nextc().then([self](int_type ch) {
+            self->consumed();
+            return ch;
+        });
+    }
+
+private:
+    void consumed()
+    {
+        std::function<void()> waiter;
+        {
+            std::lock_guard<std::mutex> lock(m_waiter_lock);
+            if (m_waiter && in_avail() < m_limit)
+            {
+                waiter.swap(m_waiter);
+            }
+        }
+        if (waiter)
+        {
+            waiter();
+        }
+    }
+
+    std::mutex m_waiter_lock;
+    size_t m_limit;
+    std::function<void()> m_waiter;
+};
+
 // These structures serve as proof witnesses
 struct will_erase_from_parent_t
 {
@@ -311,11 +1151,58 @@ private:
     std::unique_ptr<boost::asio::ip::tcp::socket> m_socket;
     boost::asio::streambuf m_request_buf;
     boost::asio::streambuf m_response_buf;
+    std::string m_response_head; // the status line and headers of the response being sent
     http_linux_server* m_p_server;
     hostport_listener* m_p_parent;
     mutable std::mutex m_request_mtx;
     http_request m_request_tmp;
 
+    // A request whose response has not been written yet.
+    struct pipelined_request
+    {
+        explicit pipelined_request(http_request request) : m_request(std::move(request)), m_ready(false) {}
+
+        http_request m_request;
+        http_response m_response;
+        bool m_ready;
+    };
+
+    // Requests are read while the responses to earlier ones are outstanding, up to the pipeline depth, and their
+    // responses are written in order. The reads and the writes each form a chain of asynchronous operations; the
+    // state below, guarded by m_request_mtx, is how the two hand over to each other.
+    std::deque<std::shared_ptr<pipelined_request>> m_pipeline;
+    size_t m_pipeline_depth;
+    bool m_writing;     // a response is being written
+    bool m_read_paused; // the pipeline was full when the last request had been read
+    bool m_read_ended;  // no more requests will be read
+    bool m_closed;      // no more responses will be written
+    bool m_erased;      // the connection has been erased from its parent
+    bool m_draining;    // the connection closes once the requests already read have been answered
+    std::shared_ptr<std::atomic<size_t>> m_in_flight; // the count of its parent, which includes m_pipeline
+    bool m_offload_handlers;                          // handlers run on the shared thread pool, not the reactor
+
+    // The deadline of the read in progress, which closes the connection if the client takes too long to start a
+    // request, finish its headers or send the next part of its body. It holds a reference to the connection while it
+    // is armed.
+    struct read_deadline : timer_wheel::entry
+    {
+        explicit read_deadline(asio_server_connection* connection) : m_connection(connection) {}
+        virtual void expired();
+
+        asio_server_connection* m_connection;
+    };
+    std::shared_ptr<timer_wheel> m_deadlines;
+    std::chrono::milliseconds m_timeout;
+    read_deadline m_read_deadline;
+    std::atomic<bool> m_reading_body; // the read in progress is that of a request body
+
+    // A body larger than m_max_body_size is refused, and reading it pauses while m_body_buffer_size bytes of it wait
+    // for the handler; zero means no limit. With a limit, the body of the request being read is m_body, which resumes
+    // reading once the handler has caught up. The read chain sets it under m_request_mtx.
+    size_t m_max_body_size;
+    size_t m_body_buffer_size;
+    std::shared_ptr<request_body_buffer> m_body;
+
     void set_request(http_request req)
     {
         std::lock_guard<std::mutex> lck(m_request_mtx);
@@ -330,10 +1217,24 @@ private:
 
     size_t m_read, m_write;
     size_t m_read_size, m_write_size;
-    bool m_close;
-    bool m_chunked;
+    std::atomic<bool> m_close;
+    bool m_chunked;        // the response being written is chunked
+    bool m_response_close; // the response being written closes the connection
+
+    // The body of the response being written is compressed a block at a time when m_compressor is set.
+    std::shared_ptr<const response_compression> m_compression;
+    std::unique_ptr<web::http::compression::compress_provider> m_compressor;
+    std::vector<uint8_t> m_compress_input;
+    size_t m_compress_position; // the part of m_compress_input already compressed
+    bool m_compress_eof;        // the whole body has been read
+    bool m_compress_done;       // the compressor has produced all of its output
     std::atomic<int> m_refs; // track how many threads are still referring to this
 
+    // The status line of the previous response, which is usually the same for the next one.
+    web::http::status_code m_status_code;
+    utility::string_t m_reason_phrase;
+    std::string m_status_line;
+
     using ssl_stream = boost::asio::ssl::stream<boost::asio::ip::tcp::socket&>;
 
     std::unique_ptr<boost::asio::ssl::context> m_ssl_context;
@@ -347,9 +1248,30 @@ private:
         , m_response_buf()
         , m_p_server(server)
         , m_p_parent(parent)
+        , m_pipeline_depth(parent->pipeline_depth())
+        , m_writing(false)
+        , m_read_paused(false)
+        , m_read_ended(false)
+        , m_closed(false)
+        , m_erased(false)
+        , m_draining(false)
+        , m_in_flight(parent->in_flight())
+        , m_offload_handlers(parent->offloads_handlers())
+        , m_deadlines(parent->deadlines())
+        , m_timeout(parent->timeout())
+        , m_read_deadline(this)
+        , m_reading_body(false)
+        , m_max_body_size(parent->max_request_body_size())
+        , m_body_buffer_size(parent->request_body_buffer_size())
         , m_close(false)
         , m_chunked(false)
+        , m_response_close(false)
+        , m_compression(parent->compression())
+        , m_compress_position(0)
+        , m_compress_eof(false)
+        , m_compress_done(false)
         , m_refs(1)
+        , m_status_code(0)
     {
     }
 
@@ -381,6 +1303,10 @@ public:
 
         if (is_https)
         {
+            // An SSL stream must not be read and written at once, so each request waits for the previous response.
+            m_pipeline_depth = 1;
+            arm_read_deadline(false);
+
             m_ssl_context = make_unique<boost::asio::ssl::context>(boost::asio::ssl::context::sslv23);
             if (ssl_context_callback)
             {
@@ -403,6 +1329,7 @@ public:
     }
 
     void close();
+    void drain();
 
     asio_server_connection(const asio_server_connection&) = delete;
     asio_server_connection& operator=(const asio_server_connection&) = delete;
@@ -413,14 +1340,21 @@ private:
     will_deref_and_erase_t start_request_response();
     will_deref_and_erase_t handle_http_line(const boost::system::error_code& ec);
     will_deref_and_erase_t handle_headers();
-    will_deref_t handle_body(const boost::system::error_code& ec);
-    will_deref_t handle_chunked_header(const boost::system::error_code& ec);
-    will_deref_t handle_chunked_body(const boost::system::error_code& ec, int toWrite);
-    will_deref_and_erase_t dispatch_request_to_listener();
-    will_erase_from_parent_t do_response()
+    will_deref_and_erase_t handle_body(const boost::system::error_code& ec);
+    will_deref_and_erase_t handle_chunked_header(const boost::system::error_code& ec);
+    will_deref_and_erase_t handle_chunked_body(const boost::system::error_code& ec, int toWrite);
+    will_deref_and_erase_t read_next_request();
+    will_deref_and_erase_t end_reading();
+    void arm_read_deadline(bool body);
+    void cancel_read_deadline();
+    void read_deadline_expired();
+    void resume_body_reading();
+    std::shared_ptr<pipelined_request> enqueue_request(const http_request& request);
+    void dispatch_request_to_listener(const std::shared_ptr<pipelined_request>& pipelined);
+    will_erase_from_parent_t do_response(const std::shared_ptr<pipelined_request>& pipelined)
     {
         auto unique_reference = this->get_reference();
-        get_request().get_response().then([=](pplx::task<http_response> r_task) {
+        pipelined->m_request.get_response().then([=](pplx::task<http_response> r_task) {
             http_response response;
             try
             {
@@ -431,20 +1365,21 @@ private:
                 response = http_response(status_codes::InternalError);
             }
 
-            serialize_headers(response);
+            // The handler may never read the rest of the body, which is read regardless once it has been answered.
+            this->resume_body_reading();
 
             // before sending response, the full incoming message need to be processed.
-            return get_request().content_ready().then([=](pplx::task<http_request>) {
-                (will_deref_and_erase_t) this->async_write(&asio_server_connection::handle_headers_written, response);
+            return pipelined->m_request.content_ready().then([=](pplx::task<http_request>) {
+                (will_deref_and_erase_t) this->response_ready(pipelined, response);
             });
         });
         unique_reference.release();
         return will_erase_from_parent_t {};
     }
-    will_erase_from_parent_t do_bad_response()
+    will_erase_from_parent_t do_bad_response(const std::shared_ptr<pipelined_request>& pipelined)
     {
         auto unique_reference = this->get_reference();
-        get_request().get_response().then([=](pplx::task<http_response> r_task) {
+        pipelined->m_request.get_response().then([=](pplx::task<http_response> r_task) {
             http_response response;
             try
             {
@@ -455,30 +1390,48 @@ private:
                 response = http_response(status_codes::InternalError);
             }
 
-            // before sending response, the full incoming message need to be processed.
-            serialize_headers(response);
-
-            (will_deref_and_erase_t) async_write(&asio_server_connection::handle_headers_written, response);
+            (will_deref_and_erase_t) this->response_ready(pipelined, response);
         });
         unique_reference.release();
         return will_erase_from_parent_t {};
     }
+    will_deref_and_erase_t response_ready(const std::shared_ptr<pipelined_request>& pipelined,
+                                          const http_response& response);
+    will_deref_and_erase_t write_response(const std::shared_ptr<pipelined_request>& pipelined);
+    will_deref_and_erase_t write_next_response();
+    void fail_unsent_response(const http_response& response);
 
-    will_deref_t async_handle_chunked_header();
+    will_deref_and_erase_t async_handle_chunked_header();
     template<typename ReadHandler>
     void async_read_until_buffersize(size_t size, const ReadHandler& handler);
-    void serialize_headers(http_response response);
+    template<typename Continuation>
+    void async_wait_body_drained(const Continuation& continuation);
+    void serialize_headers(const http_request& request, http_response response);
+    void apply_byte_range(const http_request& request, http_response& response);
     will_deref_and_erase_t cancel_sending_response_with_error(const http_response& response, const std::exception_ptr&);
     will_deref_and_erase_t handle_headers_written(const http_response& response, const boost::system::error_code& ec);
     will_deref_and_erase_t handle_write_large_response(const http_response& response,
                                                        const boost::system::error_code& ec);
     will_deref_and_erase_t handle_write_chunked_response(const http_response& response,
                                                          const boost::system::error_code& ec);
+    will_deref_and_erase_t handle_write_compressed_response(const http_response& response,
+                                                            const boost::system::error_code& ec);
+    will_deref_and_erase_t write_compressed_chunk(const http_response& response);
     will_deref_and_erase_t handle_response_written(const http_response& response, const boost::system::error_code& ec);
     will_deref_and_erase_t finish_request_response();
+    will_deref_and_erase_t erase_from_parent();
+#if defined(__linux__)
+    will_deref_and_erase_t async_sendfile(const http_response& response, size_t offset);
+#endif
 
     using WriteFunc = decltype(&asio_server_connection::handle_headers_written);
     will_deref_and_erase_t async_write(WriteFunc response_func_ptr, const http_response& response);
+    will_deref_and_erase_t async_write_head(const http_response& response);
+    will_deref_and_erase_t async_write_gathered(WriteFunc response_func_ptr,
+                                                const http_response& response,
+                                                boost::asio::const_buffer head,
+                                                uint8_t* block,
+                                                size_t block_size);
 
     inline will_deref_t deref()
     {
@@ -500,10 +1453,165 @@ struct is_match_condition<crlfcrlf_nonascii_searcher_t> : public boost::true_typ
 } // namespace asio
 } // namespace boost
 
+#if defined(__linux__)
+// Defined in fileio_posix.cpp.
+int _get_fsb_handle(concurrency::streams::details::_file_info* info);
+
+namespace Concurrency
+{
+namespace streams
+{
+namespace details
+{
+// Reads the file descriptor of a file stream buffer, which basic_file_buffer keeps private.
+struct _file_buffer_access
+{
+    // Returns -1 if the file is not open.
+    static int native_handle(const basic_file_buffer<uint8_t>& buffer)
+    {
+        return buffer.m_info == nullptr ? -1 : _get_fsb_handle(buffer.m_info);
+    }
+};
+} // namespace details
+} // namespace streams
+} // namespace Concurrency
+#endif
+
 namespace
 {
 const size_t ChunkSize = 4 * 1024;
 
+#if defined(__linux__)
+// The most a single step of a sendfile transfer sends before it lets the connection's other handlers run.
+const size_t SendfileChunkSize = 256 * 1024;
+#endif
+
+// Returns the file stream buffer a response body is read from, or nullptr if the body does not come from a file.
+concurrency::streams::details::basic_file_buffer<uint8_t>* file_buffer_of(
+    const concurrency::streams::streambuf<uint8_t>& buffer)
+{
+    return dynamic_cast<concurrency::streams::details::basic_file_buffer<uint8_t>*>(buffer.get_base().get());
+}
+
+enum class byte_range
+{
+    ignored,
+    satisfiable,
+    unsatisfiable
+};
+
+bool parse_range_offset(utility::string_t text, utility::size64_t& offset)
+{
+    web::http::details::trim_whitespace(text);
+    if (text.empty() || text.size() > 18)
+    {
+        return false;
+    }
+    offset = 0;
+    for (auto ch : text)
+    {
+        if (ch < U('0') || ch > U('9'))
+        {
+            return false;
+        }
+        offset = offset * 10 + static_cast<utility::size64_t>(ch - U('0'));
+    }
+    return true;
+}
+
+// Parses a Range header holding a single byte range into the first and last offsets of a body of the given size.
+// Multiple ranges and malformed headers are ignored, so that the whole body is sent.
+byte_range parse_byte_range(utility::string_t header,
+                            utility::size64_t size,
+                            utility::size64_t& first,
+                            utility::size64_t& last)
+{
+    web::http::details::trim_whitespace(header);
+    const utility::string_t unit = U("bytes=");
+    if (!boost::istarts_with(header, unit) || header.find(U(',')) != utility::string_t::npos)
+    {
+        return byte_range::ignored;
+    }
+    const auto dash = header.find(U('-'), unit.size());
+    if (dash == utility::string_t::npos)
+    {
+        return byte_range::ignored;
+    }
+    const auto first_text = header.substr(unit.size(), dash - unit.size());
+    const auto last_text = header.substr(dash + 1);
+
+    if (first_text.find_first_not_of(U(" \t")) == utility::string_t::npos)
+    {
+        // "-n" asks for the last n bytes
+        utility::size64_t suffix;
+        if (!parse_range_offset(last_text, suffix))
+        {
+            return byte_range::ignored;
+        }
+        if (suffix == 0 || size == 0)
+        {
+            return byte_range::unsatisfiable;
+        }
+        first = suffix < size ? size - suffix : 0;
+        last = size - 1;
+        return byte_range::satisfiable;
+    }
+
+    if (!parse_range_offset(first_text, first))
+    {
+        return byte_range::ignored;
+    }
+    if (last_text.find_first_not_of(U(" \t")) == utility::string_t::npos)
+    {
+        last = size - 1;
+    }
+    else if (!parse_range_offset(last_text, last) || last < first)
+    {
+        return byte_range::ignored;
+    }
+    if (first >= size)
+    {
+        return byte_range::unsatisfiable;
+    }
+    last = (std::min)(last, size - 1);
+    return byte_range::satisfiable;
+}
+
+// The Date header only changes once per second, so it is formatted at most once per second for all connections.
+void append_http_date(std::string& target)
+{
+    static std::mutex date_lock;
+    static utility::datetime::interval_type date_second = 0;
+    static std::string date;
+
+    const auto now = utility::datetime::utc_now();
+    const auto second = now.to_interval() / 10000000;
+
+    std::lock_guard<std::mutex> lock(date_lock);
+    if (second != date_second)
+    {
+        date = utility::conversions::to_utf8string(now.to_string(utility::datetime::RFC_1123));
+        date_second = second;
+    }
+    target.append(date);
+}
+
+// The I/O services of listeners configured with reactor threads. Each one runs on a thread of its own, so that the
+// connections pinned to it never contend with those of other reactors. Like the shared thread pool, they live until
+// the process exits.
+boost::asio::io_service& reactor_service(size_t index)
+{
+    static std::mutex reactors_lock;
+    static std::vector<std::unique_ptr<crossplat::threadpool>> reactors;
+
+    std::lock_guard<std::mutex> lock(reactors_lock);
+    while (reactors.size() <= index)
+    {
+        reactors.push_back(crossplat::threadpool::construct(1));
+    }
+    return reactors[index]->service();
+}
+
 void hostport_listener::internal_erase_connection(asio_server_connection* conn)
 {
     std::lock_guard<std::mutex> lock(m_connections_lock);
@@ -511,6 +1619,16 @@ void hostport_listener::internal_erase_connection(asio_server_connection* conn)
     if (m_connections.empty())
     {
         m_all_connections_complete.set();
+        if (m_drained)
+        {
+            m_drained->set(m_in_flight->load());
+        }
+    }
+
+    if (m_accept_paused && m_acceptor && m_connections.size() < m_max_connections)
+    {
+        m_accept_paused = false;
+        async_accept();
     }
 }
 
@@ -532,6 +1650,15 @@ void hostport_listener::start()
     m_acceptor->bind(endpoint);
     m_acceptor->listen(0 != m_backlog ? m_backlog : socket_base::max_connections);
 
+    async_accept();
+}
+
+void hostport_listener::async_accept()
+{
+    // The socket is created on the service of the reactor that will own the connection, so all of its completion
+    // handlers run there.
+    boost::asio::io_service& service = m_reactor_count == 0 ? crossplat::threadpool::shared_instance().service()
+                                                            : reactor_service(m_next_reactor++ % m_reactor_count);
     auto socket = new ip::tcp::socket(service);
     std::unique_ptr<ip::tcp::socket> usocket(socket);
     m_acceptor->async_accept(*socket, [this, socket](const boost::system::error_code& ec) {
@@ -544,22 +1671,52 @@ void hostport_listener::start()
 void asio_server_connection::close()
 {
     m_close = true;
-    auto sock = m_socket.get();
-    if (sock != nullptr)
+
+    // The pending operations fail once the socket is shut down. It is closed when the connection is destroyed, since
+    // the read chain may be starting another read on it at the same time.
+    boost::system::error_code ec;
+    m_socket->shutdown(tcp::socket::shutdown_both, ec);
+
+    std::vector<http_request> outstanding(1, get_request());
+    {
+        std::lock_guard<std::mutex> lock(m_request_mtx);
+        for (const auto& pipelined : m_pipeline)
+        {
+            outstanding.push_back(pipelined->m_request);
+        }
+    }
+    for (auto& request : outstanding)
+    {
+        request._reply_if_not_already(status_codes::InternalError);
+    }
+}
+
+void asio_server_connection::drain()
+{
+    bool idle;
+    {
+        std::lock_guard<std::mutex> lock(m_request_mtx);
+        m_draining = true;
+        idle = m_pipeline.empty() && !m_writing;
+    }
+
+    // No request is read after the current one, and the connection is erased once the responses have been written.
+    m_close = true;
+    if (idle)
     {
+        // The pending read fails, which ends the reads.
         boost::system::error_code ec;
-        sock->cancel(ec);
-        sock->shutdown(tcp::socket::shutdown_both, ec);
-        sock->close(ec);
+        m_socket->shutdown(tcp::socket::shutdown_receive, ec);
     }
-    get_request()._reply_if_not_already(status_codes::InternalError);
 }
 
 will_deref_and_erase_t asio_server_connection::start_request_response()
 {
     m_read_size = 0;
     m_read = 0;
-    m_request_buf.consume(m_request_buf.size()); // clear the buffer
+    arm_read_deadline(false);
+
+    // The buffer may already hold the next pipelined request, which the reads below find without waiting.
 
     if (m_ssl_stream)
     {
@@ -606,6 +1763,12 @@ void hostport_listener::on_accept(std::unique_ptr<ip::tcp::socket> socket, const
             // at this point an asynchronous task has been launched which will call
             // m_connections.erase(conn.get()) eventually
 
+            if (m_drained)
+            {
+                // It was accepted just before the drain began.
+                conn->drain();
+            }
+
             // the following cannot throw
             if (m_connections.size() == 1) m_all_connections_complete.reset();
         }
@@ -620,14 +1783,16 @@ void hostport_listener::on_accept(std::unique_ptr<ip::tcp::socket> socket, const
 
     if (m_acceptor)
     {
-        // spin off another async accept
-        auto newSocket = new ip::tcp::socket(crossplat::threadpool::shared_instance().service());
-        std::unique_ptr<ip::tcp::socket> usocket(newSocket);
-        m_acceptor->async_accept(*newSocket, [this, newSocket](const boost::system::error_code& ec) {
-            std::unique_ptr<ip::tcp::socket> usocket(newSocket);
-            this->on_accept(std::move(usocket), ec);
-        });
-        usocket.release();
+        if (m_max_connections != 0 && m_connections.size() >= m_max_connections)
+        {
+            // Until a connection closes, new clients wait in the listen backlog.
+            m_accept_paused = true;
+        }
+        else
+        {
+            // spin off another async accept
+            async_accept();
+        }
     }
 }
 
@@ -638,106 +1803,91 @@ will_deref_and_erase_t asio_server_connection::handle_http_line(const boost::sys
     if (ec)
     {
         // client closed connection
-        if (ec == boost::asio::error::eof || // peer has performed an orderly shutdown
+        if (m_close ||                       // the connection is being closed, or its deadline has passed
+            ec == boost::asio::error::eof || // peer has performed an orderly shutdown
             ec ==
                 boost::asio::error::operation_aborted ||  // this can be removed. ECONNABORTED happens only for accept()
             ec == boost::asio::error::connection_reset || // connection reset by peer
             ec == boost::asio::error::timed_out           // connection timed out
         )
         {
-            return finish_request_response();
+            return end_reading();
         }
         else
         {
             thisRequest._reply_if_not_already(status_codes::BadRequest);
             m_close = true;
-            (will_erase_from_parent_t) do_bad_response();
-            (will_deref_t) deref();
-            return will_deref_and_erase_t {};
+            (will_erase_from_parent_t) do_bad_response(enqueue_request(thisRequest));
+            return end_reading();
         }
     }
     else
     {
         // read http status line
-        std::istream request_stream(&m_request_buf);
-        request_stream.imbue(std::locale::classic());
-        std::skipws(request_stream);
+        const char* const begin = buffer_cast<const char*>(m_request_buf.data());
+        const char* const end = begin + m_request_buf.size();
+        const char* position = begin;
 
-        web::http::method http_verb;
-#ifndef _UTF16_STRINGS
-        request_stream >> http_verb;
-#else
+        // skip any blank lines before the method
+        while (position != end && utility::details::is_space(*position))
         {
-            std::string tmp;
-            request_stream >> tmp;
-            http_verb = utility::conversions::latin1_to_utf16(tmp);
+            ++position;
         }
-#endif
+        buffer_range verb {position, position};
+        while (position != end && !utility::details::is_space(*position))
+        {
+            ++position;
+        }
+        verb.last = position;
 
-        if (boost::iequals(http_verb, methods::GET))
-            http_verb = methods::GET;
-        else if (boost::iequals(http_verb, methods::POST))
-            http_verb = methods::POST;
-        else if (boost::iequals(http_verb, methods::PUT))
-            http_verb = methods::PUT;
-        else if (boost::iequals(http_verb, methods::DEL))
-            http_verb = methods::DEL;
-        else if (boost::iequals(http_verb, methods::HEAD))
-            http_verb = methods::HEAD;
-        else if (boost::iequals(http_verb, methods::TRCE))
-            http_verb = methods::TRCE;
-        else if (boost::iequals(http_verb, methods::CONNECT))
-            http_verb = methods::CONNECT;
-        else if (boost::iequals(http_verb, methods::OPTIONS))
-            http_verb = methods::OPTIONS;
+        web::http::method http_verb = parse_method(verb);
 
         // Check to see if there is not allowed character on the input
         if (!web::http::details::validate_method(http_verb))
         {
             thisRequest.reply(status_codes::BadRequest);
             m_close = true;
-            (will_erase_from_parent_t) do_bad_response();
-            (will_deref_t) deref();
-            return will_deref_and_erase_t {};
+            (will_erase_from_parent_t) do_bad_response(enqueue_request(thisRequest));
+            return end_reading();
         }
 
         thisRequest.set_method(http_verb);
 
-        std::string http_path_and_version;
-        std::getline(request_stream, http_path_and_version);
+        // The rest of the line holds a space, the path and " HTTP/1.1\r"
+        const buffer_range path_and_version = next_line(position, end);
+        m_request_buf.consume(static_cast<size_t>(position - begin));
         const size_t VersionPortionSize = sizeof(" HTTP/1.1\r") - 1;
 
         // Make sure path and version is long enough to contain the HTTP version
-        if (http_path_and_version.size() < VersionPortionSize + 2)
+        if (path_and_version.size() < VersionPortionSize + 2)
         {
             thisRequest.reply(status_codes::BadRequest);
             m_close = true;
-            (will_erase_from_parent_t) do_bad_response();
-            (will_deref_t) deref();
-            return will_deref_and_erase_t {};
+            (will_erase_from_parent_t) do_bad_response(enqueue_request(thisRequest));
+            return end_reading();
         }
 
         // Get the path - remove the version portion and prefix space
         try
         {
-            thisRequest.set_request_uri(utility::conversions::to_string_t(
-                http_path_and_version.substr(1, http_path_and_version.size() - VersionPortionSize - 1)));
+            const buffer_range path {path_and_version.first + 1, path_and_version.last - VersionPortionSize};
+            thisRequest.set_request_uri(path.to_string_t());
         }
         catch (const std::exception& e) // may be std::range_error indicating invalid Unicode, or web::uri_exception
         {
             thisRequest.reply(status_codes::BadRequest, e.what());
             m_close = true;
-            (will_erase_from_parent_t) do_bad_response();
-            (will_deref_t) deref();
-            return will_deref_and_erase_t {};
+            (will_erase_from_parent_t) do_bad_response(enqueue_request(thisRequest));
+            return end_reading();
         }
 
         // Get the version
-        std::string http_version =
-            http_path_and_version.substr(http_path_and_version.size() - VersionPortionSize + 1, VersionPortionSize - 2);
+        const buffer_range http_version {path_and_version.last - VersionPortionSize + 1, path_and_version.last - 1};
 
         auto requestImpl = thisRequest._get_impl().get();
-        web::http::http_version parsed_version = web::http::http_version::from_string(http_version);
+        web::http::http_version parsed_version = http_version.equals("HTTP/1.1", 8)
+                                                     ? web::http::http_versions::HTTP_1_1
+                                                     : web::http::http_version::from_string(http_version.to_string());
         requestImpl->_set_http_version(parsed_version);
 
         // if HTTP version is 1.0 then disable pipelining
@@ -760,62 +1910,87 @@ will_deref_and_erase_t asio_server_connection::handle_http_line(const boost::sys
 
 will_deref_and_erase_t asio_server_connection::handle_headers()
 {
-    std::istream request_stream(&m_request_buf);
-    request_stream.imbue(std::locale::classic());
-    std::string header;
+    const char* const begin = buffer_cast<const char*>(m_request_buf.data());
+    const char* const end = begin + m_request_buf.size();
+    const char* position = begin;
 
     auto currentRequest = get_request();
     auto& headers = currentRequest.headers();
 
-    while (std::getline(request_stream, header) && header != "\r")
+    while (position != end)
     {
-        auto colon = header.find(':');
-        if (colon != std::string::npos && colon != 0)
+        const buffer_range header = next_line(position, end);
+        if (header.equals("\r", 1))
+        {
+            break;
+        }
+
+        auto colon = static_cast<const char*>(std::memchr(header.first, ':', header.size()));
+        if (colon != nullptr && colon != header.first)
         {
-            auto name = utility::conversions::to_string_t(header.substr(0, colon));
-            auto value = utility::conversions::to_string_t(
-                header.substr(colon + 1, header.length() - (colon + 1))); // also exclude '\r'
-            web::http::details::trim_whitespace(name);
-            web::http::details::trim_whitespace(value);
+            buffer_range name {header.first, colon};
+            buffer_range value {colon + 1, header.last}; // '\r' is trimmed as whitespace
+            name.trim_whitespace();
+            value.trim_whitespace();
 
-            if (boost::iequals(name, header_names::content_length))
+            if (name.iequals(header_names::content_length))
             {
-                headers[header_names::content_length] = value;
+                headers[header_names::content_length] = value.to_string_t();
             }
             else
             {
-                headers.add(name, value);
+                headers.add(name.to_string_t(), value.to_string_t());
             }
         }
         else
         {
             currentRequest.reply(status_codes::BadRequest);
             m_close = true;
-            (will_erase_from_parent_t) do_bad_response();
-            (will_deref_t) deref();
-            return will_deref_and_erase_t {};
+            (will_erase_from_parent_t) do_bad_response(enqueue_request(currentRequest));
+            return end_reading();
         }
     }
+    m_request_buf.consume(static_cast<size_t>(position - begin));
 
-    m_chunked = false;
+    bool chunked = false;
     utility::string_t name;
     // check if the client has requested we close the connection
-    if (currentRequest.headers().match(header_names::connection, name))
+    if (currentRequest.headers().match(header_names::connection, name) && boost::iequals(name, U("close")))
     {
-        m_close = boost::iequals(name, U("close"));
+        m_close = true;
     }
 
     if (currentRequest.headers().match(header_names::transfer_encoding, name))
     {
-        m_chunked = boost::ifind_first(name, U("chunked"));
+        chunked = boost::ifind_first(name, U("chunked"));
     }
 
-    currentRequest._get_impl()->_prepare_to_receive_data();
-    if (m_chunked)
+    // The request takes its place among the outstanding responses before anything can answer it.
+    auto pipelined = enqueue_request(currentRequest);
+
+    // Once the body has been read, the body handlers go on to read the next request.
+    if (m_body_buffer_size != 0)
+    {
+        auto body = std::make_shared<request_body_buffer>();
+        {
+            std::lock_guard<std::mutex> lock(m_request_mtx);
+            m_body = body;
+        }
+        concurrency::streams::streambuf<uint8_t> body_buffer(body);
+        currentRequest._get_impl()->set_outstream(body_buffer.create_ostream(), true);
+        currentRequest._get_impl()->set_instream(body_buffer.create_istream());
+    }
+    else
+    {
+        currentRequest._get_impl()->_prepare_to_receive_data();
+    }
+    if (chunked)
     {
         ++m_refs;
-        (will_deref_t) async_handle_chunked_header();
-        return dispatch_request_to_listener();
+        (will_deref_and_erase_t) async_handle_chunked_header();
+        dispatch_request_to_listener(pipelined);
+        (will_deref_t) deref();
+        return will_deref_and_erase_t {};
     }
 
     if (!currentRequest.headers().match(header_names::content_length, m_read_size))
@@ -823,29 +1998,162 @@ will_deref_and_erase_t asio_server_connection::handle_headers()
         m_read_size = 0;
     }
 
+    if (m_max_body_size != 0 && m_read_size > m_max_body_size)
+    {
+        // The body is left unread, so no further request can be read from the connection.
+        currentRequest._get_impl()->_complete(0);
+        currentRequest.reply(status_codes::RequestEntityTooLarge);
+        m_close = true;
+        (will_erase_from_parent_t) do_bad_response(pipelined);
+        return end_reading();
+    }
+
     if (m_read_size == 0)
     {
         currentRequest._get_impl()->_complete(0);
+        dispatch_request_to_listener(pipelined);
+        return read_next_request();
     }
-    else // need to read the sent data
+
+    // need to read the sent data
+    m_read = 0;
+    ++m_refs;
+    async_read_until_buffersize(
+        (std::min)(ChunkSize, m_read_size),
+        [this](const boost::system::error_code& ec, size_t) { (will_deref_and_erase_t) this->handle_body(ec); });
+    dispatch_request_to_listener(pipelined);
+    (will_deref_t) deref();
+    return will_deref_and_erase_t {};
+}
+
+std::shared_ptr<asio_server_connection::pipelined_request> asio_server_connection::enqueue_request(
+    const http_request& request)
+{
+    auto pipelined = std::make_shared<pipelined_request>(request);
+    std::lock_guard<std::mutex> lock(m_request_mtx);
+    m_pipeline.push_back(pipelined);
+    ++*m_in_flight;
+    return pipelined;
+}
+
+will_deref_and_erase_t asio_server_connection::read_next_request()
+{
+    bool paused = false;
     {
-        m_read = 0;
-        ++m_refs;
-        async_read_until_buffersize(
-            (std::min)(ChunkSize, m_read_size),
-            [this](const boost::system::error_code& ec, size_t) { (will_deref_t) this->handle_body(ec); });
+        std::lock_guard<std::mutex> lock(m_request_mtx);
+        if (m_close || m_closed)
+        {
+            m_read_ended = true;
+        }
+        else if (m_pipeline.size() >= m_pipeline_depth)
+        {
+            // write_next_response resumes reading once a response has been written.
+            m_read_paused = paused = true;
+        }
+    }
+
+    if (paused)
+    {
+        cancel_read_deadline();
+        (will_deref_t) deref();
+        return will_deref_and_erase_t {};
+    }
+    if (m_read_ended)
+    {
+        return end_reading();
+    }
+    return start_request_response();
+}
+
+will_deref_and_erase_t asio_server_connection::end_reading()
+{
+    cancel_read_deadline();
+
+    bool erase;
+    {
+        std::lock_guard<std::mutex> lock(m_request_mtx);
+        m_read_ended = true;
+
+        // Otherwise the connection is erased once the outstanding responses have been written.
+        erase = !m_erased && !m_writing && (m_pipeline.empty() || m_closed);
+        m_erased = m_erased || erase;
+    }
+
+    if (erase)
+    {
+        return erase_from_parent();
     }
+    (will_deref_t) deref();
+    return will_deref_and_erase_t {};
+}
+
+void asio_server_connection::arm_read_deadline(bool body)
+{
+    if (!m_deadlines)
+    {
+        return;
+    }
+
+    m_reading_body = body;
+    ++m_refs;
+    if (!m_deadlines->schedule(m_read_deadline, m_timeout))
+    {
+        // The deadline was armed already, and holds a reference.
+        (will_deref_t) deref();
+    }
+}
+
+void asio_server_connection::cancel_read_deadline()
+{
+    if (m_deadlines && m_deadlines->cancel(m_read_deadline))
+    {
+        (will_deref_t) deref();
+    }
+}
+
+void asio_server_connection::read_deadline::expired() { m_connection->read_deadline_expired(); }
+
+void asio_server_connection::read_deadline_expired()
+{
+    // The read chain may have armed the deadline again since it expired.
+    if (!m_deadlines->armed(m_read_deadline))
+    {
+        bool busy;
+        {
+            std::lock_guard<std::mutex> lock(m_request_mtx);
+            busy = !m_reading_body && (!m_pipeline.empty() || m_writing);
+        }
 
-    return dispatch_request_to_listener();
+        if (busy)
+        {
+            // A connection waiting for the next request is not idle while earlier requests are being answered.
+            ++m_refs;
+            if (!m_deadlines->schedule(m_read_deadline, m_timeout))
+            {
+                (will_deref_t) deref();
+            }
+        }
+        else
+        {
+            // The pending read fails, which ends the reads; the responses already under way are still written. Reading
+            // may instead be paused for the handler, in which case the next read fails.
+            m_close = true;
+            boost::system::error_code ec;
+            m_socket->shutdown(tcp::socket::shutdown_receive, ec);
+            resume_body_reading();
+        }
+    }
+    (will_deref_t) deref();
 }
 
-will_deref_t asio_server_connection::handle_chunked_header(const boost::system::error_code& ec)
+will_deref_and_erase_t asio_server_connection::handle_chunked_header(const boost::system::error_code& ec)
 {
     auto requestImpl = get_request()._get_impl();
     if (ec)
     {
         requestImpl->_complete(0, std::make_exception_ptr(http_exception(ec.value())));
-        return deref();
+        m_close = true;
+        return end_reading();
     }
     else
     {
@@ -855,34 +2163,43 @@ will_deref_t asio_server_connection::handle_chunked_header(const boost::system::
         is >> std::hex >> len;
         m_request_buf.consume(CRLF.size());
         m_read += len;
+        if (m_max_body_size != 0 && m_read > m_max_body_size)
+        {
+            requestImpl->_complete(
+                0, std::make_exception_ptr(http_exception(_XPLATSTR("The request body exceeds the maximum size"))));
+            get_request()._reply_if_not_already(status_codes::RequestEntityTooLarge);
+            m_close = true;
+            return end_reading();
+        }
         if (len == 0)
         {
             requestImpl->_complete(m_read);
-            return deref();
+            return read_next_request();
         }
         else
         {
             async_read_until_buffersize(len + 2, [this, len](const boost::system::error_code& ec, size_t) {
-                (will_deref_t) this->handle_chunked_body(ec, len);
+                (will_deref_and_erase_t) this->handle_chunked_body(ec, len);
             });
-            return will_deref_t {};
+            return will_deref_and_erase_t {};
         }
     }
 }
 
-will_deref_t asio_server_connection::handle_chunked_body(const boost::system::error_code& ec, int toWrite)
+will_deref_and_erase_t asio_server_connection::handle_chunked_body(const boost::system::error_code& ec, int toWrite)
 {
     auto requestImpl = get_request()._get_impl();
     if (ec)
     {
         requestImpl->_complete(0, std::make_exception_ptr(http_exception(ec.value())));
-        return deref();
+        m_close = true;
+        return end_reading();
     }
     else
     {
         auto writebuf = requestImpl->outstream().streambuf();
         writebuf.putn_nocopy(buffer_cast<const uint8_t*>(m_request_buf.data()), toWrite)
-            .then([=](pplx::task<size_t> writeChunkTask) -> will_deref_t {
+            .then([=](pplx::task<size_t> writeChunkTask) -> will_deref_and_erase_t {
                 try
                 {
                     writeChunkTask.get();
@@ -890,24 +2207,27 @@ will_deref_t asio_server_connection::handle_chunked_body(const boost::system::er
                 catch (...)
                 {
                     requestImpl->_complete(0, std::current_exception());
-                    return deref();
+                    m_close = true;
+                    return end_reading();
                 }
 
                 m_request_buf.consume(2 + toWrite);
-                return async_handle_chunked_header();
+                async_wait_body_drained([this] { (will_deref_and_erase_t) this->async_handle_chunked_header(); });
+                return will_deref_and_erase_t {};
             });
-        return will_deref_t {};
+        return will_deref_and_erase_t {};
     }
 }
 
-will_deref_t asio_server_connection::handle_body(const boost::system::error_code& ec)
+will_deref_and_erase_t asio_server_connection::handle_body(const boost::system::error_code& ec)
 {
     auto requestImpl = get_request()._get_impl();
     // read body
     if (ec)
     {
         requestImpl->_complete(0, std::make_exception_ptr(http_exception(ec.value())));
-        return deref();
+        m_close = true;
+        return end_reading();
     }
     else if (m_read < m_read_size) // there is more to read
     {
@@ -915,7 +2235,7 @@ will_deref_t asio_server_connection::handle_body(const boost::system::error_code
         writebuf
             .putn_nocopy(boost::asio::buffer_cast<const uint8_t*>(m_request_buf.data()),
                          (std::min)(m_request_buf.size(), m_read_size - m_read))
-            .then([this](pplx::task<size_t> writtenSizeTask) -> will_deref_t {
+            .then([this](pplx::task<size_t> writtenSizeTask) -> will_deref_and_erase_t {
                 size_t writtenSize = 0;
                 try
                 {
@@ -924,159 +2244,411 @@ will_deref_t asio_server_connection::handle_body(const boost::system::error_code
                 catch (...)
                 {
                     get_request()._get_impl()->_complete(0, std::current_exception());
-                    return deref();
+                    m_close = true;
+                    return end_reading();
                 }
                 m_read += writtenSize;
                 m_request_buf.consume(writtenSize);
 
-                async_read_until_buffersize(
-                    (std::min)(ChunkSize, m_read_size - m_read),
-                    [this](const boost::system::error_code& ec, size_t) { (will_deref_t) this->handle_body(ec); });
-                return will_deref_t {};
+                async_wait_body_drained([this] {
+                    async_read_until_buffersize((std::min)(ChunkSize, m_read_size - m_read),
+                                                [this](const boost::system::error_code& ec, size_t) {
+                                                    (will_deref_and_erase_t) this->handle_body(ec);
+                                                });
+                });
+                return will_deref_and_erase_t {};
             });
-        return will_deref_t {};
+        return will_deref_and_erase_t {};
     }
     else // have read request body
     {
-        requestImpl->_complete(m_read);
-        return deref();
+        requestImpl->_complete(m_read);
+        return read_next_request();
+    }
+}
+
+will_deref_and_erase_t asio_server_connection::async_write(WriteFunc response_func_ptr, const http_response& response)
+{
+    if (m_ssl_stream)
+    {
+        boost::asio::async_write(*m_ssl_stream, m_response_buf, [=](const boost::system::error_code& ec, std::size_t) {
+            (this->*response_func_ptr)(response, ec);
+        });
+    }
+    else
+    {
+        boost::asio::async_write(*m_socket, m_response_buf, [=](const boost::system::error_code& ec, std::size_t) {
+            (this->*response_func_ptr)(response, ec);
+        });
+    }
+    return will_deref_and_erase_t {};
+}
+
+will_deref_and_erase_t asio_server_connection::async_write_head(const http_response& response)
+{
+    // When the length of the body is known and its stream buffer exposes its data directly, the first block of the
+    // body goes out in the same write as the headers, without being copied.
+    uint8_t* block = nullptr;
+    size_t block_size = 0;
+    if (!m_chunked && m_write_size != 0 && response.body())
+    {
+        auto readbuf = response._get_impl()->instream().streambuf();
+        if (readbuf.acquire(block, block_size) && block != nullptr)
+        {
+            block_size = (std::min)(block_size, m_write_size);
+        }
+        else
+        {
+            block = nullptr;
+            block_size = 0;
+        }
+    }
+
+    return async_write_gathered(&asio_server_connection::handle_headers_written,
+                                response,
+                                boost::asio::buffer(m_response_head),
+                                block,
+                                block_size);
+}
+
+will_deref_and_erase_t asio_server_connection::async_write_gathered(WriteFunc response_func_ptr,
+                                                                   const http_response& response,
+                                                                   boost::asio::const_buffer head,
+                                                                   uint8_t* block,
+                                                                   size_t block_size)
+{
+    const std::array<boost::asio::const_buffer, 2> buffers = {{head, boost::asio::buffer(block, block_size)}};
+
+    // The block stays acquired from the body's stream buffer until the write completes.
+    concurrency::streams::streambuf<uint8_t> readbuf;
+    if (block != nullptr)
+    {
+        readbuf = response._get_impl()->instream().streambuf();
+    }
+    auto handler = [=](const boost::system::error_code& ec, std::size_t) mutable {
+        if (block != nullptr)
+        {
+            readbuf.release(block, ec ? 0 : block_size);
+            if (!ec)
+            {
+                m_write += block_size;
+            }
+        }
+        (will_deref_and_erase_t)(this->*response_func_ptr)(response, ec);
+    };
+
+    if (m_ssl_stream)
+    {
+        boost::asio::async_write(*m_ssl_stream, buffers, handler);
+    }
+    else
+    {
+        boost::asio::async_write(*m_socket, buffers, handler);
+    }
+    return will_deref_and_erase_t {};
+}
+
+will_deref_and_erase_t asio_server_connection::async_handle_chunked_header()
+{
+    arm_read_deadline(true);
+    if (m_ssl_stream)
+    {
+        boost::asio::async_read_until(
+            *m_ssl_stream, m_request_buf, CRLF, [this](const boost::system::error_code& ec, size_t) {
+                (will_deref_and_erase_t) this->handle_chunked_header(ec);
+            });
+    }
+    else
+    {
+        boost::asio::async_read_until(
+            *m_socket, m_request_buf, CRLF, [this](const boost::system::error_code& ec, size_t) {
+                (will_deref_and_erase_t) this->handle_chunked_header(ec);
+            });
+    }
+    return will_deref_and_erase_t {};
+}
+
+template<typename ReadHandler>
+void asio_server_connection::async_read_until_buffersize(size_t size, const ReadHandler& handler)
+{
+    arm_read_deadline(true);
+
+    // The condition is such that after completing the async_read below, m_request_buf will contain at least `size`
+    // bytes.
+    auto condition = transfer_at_least(0);
+
+    auto bufsize = m_request_buf.size();
+    if (size > bufsize)
+    {
+        condition = transfer_at_least(size - bufsize);
+    }
+
+    if (m_ssl_stream)
+    {
+        boost::asio::async_read(*m_ssl_stream, m_request_buf, condition, handler);
+    }
+    else
+    {
+        boost::asio::async_read(*m_socket, m_request_buf, condition, handler);
+    }
+}
+
+template<typename Continuation>
+void asio_server_connection::async_wait_body_drained(const Continuation& continuation)
+{
+    // Once the request has been answered, or the connection is closing, the handler may never read the rest of the
+    // body, so reading goes on regardless.
+    auto request = get_request();
+    if (m_body_buffer_size == 0 || m_close || request.get_response().is_done() ||
+        m_body->in_avail() < m_body_buffer_size)
+    {
+        continuation();
+        return;
+    }
+
+    // A read of the body waits until all the bytes it asks for have arrived, unless the buffer is synced, which hands
+    // it what has arrived so far.
+    request._get_impl()->outstream().streambuf().sync();
+
+    // The read deadline keeps running while reading is paused, so a handler that stops reading the body, or waits
+    // for all of it with an extract method, fails once it expires as it would for a stalled client.
+    m_body->wait_below(m_body_buffer_size, [this, continuation] {
+        crossplat::threadpool::shared_instance().service().post(
+            [this, continuation] { async_wait_body_drained(continuation); });
+    });
+}
+
+void asio_server_connection::resume_body_reading()
+{
+    std::shared_ptr<request_body_buffer> body;
+    {
+        std::lock_guard<std::mutex> lock(m_request_mtx);
+        body = m_body;
+    }
+    if (body)
+    {
+        body->resume();
+    }
+}
+
+void asio_server_connection::dispatch_request_to_listener(const std::shared_ptr<pipelined_request>& pipelined)
+{
+    // locate the listener:
+    std::shared_ptr<listener_route> route;
+    utility::string_t listener_path;
+    std::map<utility::string_t, utility::string_t> parameters;
+    auto currentRequest = pipelined->m_request;
+    try
+    {
+        route = m_p_parent->find_listener(currentRequest.request_uri().path(), listener_path, parameters);
+    }
+    catch (const std::exception&) // may be web::uri_exception, or std::range_error indicating invalid Unicode
+    {
+        currentRequest.reply(status_codes::BadRequest);
+        (will_erase_from_parent_t) do_response(pipelined);
+        return;
+    }
+
+    if (route == nullptr)
+    {
+        currentRequest.reply(status_codes::NotFound);
+        (will_erase_from_parent_t) do_response(pipelined);
+        return;
     }
-}
 
-will_deref_and_erase_t asio_server_connection::async_write(WriteFunc response_func_ptr, const http_response& response)
-{
-    if (m_ssl_stream)
+    if (route->m_parameters.empty())
     {
-        boost::asio::async_write(*m_ssl_stream, m_response_buf, [=](const boost::system::error_code& ec, std::size_t) {
-            (this->*response_func_ptr)(response, ec);
-        });
+        currentRequest._set_listener_path(route->m_listener->uri().path());
     }
     else
     {
-        boost::asio::async_write(*m_socket, m_response_buf, [=](const boost::system::error_code& ec, std::size_t) {
-            (this->*response_func_ptr)(response, ec);
-        });
+        currentRequest._set_listener_path(listener_path);
+        currentRequest._set_path_parameters(std::move(parameters));
     }
-    return will_deref_and_erase_t {};
-}
+    (will_erase_from_parent_t) do_response(pipelined);
 
-will_deref_t asio_server_connection::async_handle_chunked_header()
-{
-    if (m_ssl_stream)
+    // It is possible the listener could have unregistered.
+    if (!route->enter())
     {
-        boost::asio::async_read_until(
-            *m_ssl_stream, m_request_buf, CRLF, [this](const boost::system::error_code& ec, size_t) {
-                (will_deref_t) this->handle_chunked_header(ec);
-            });
+        currentRequest.reply(status_codes::NotFound);
+        return;
+    }
+
+    auto handle = [route, currentRequest] {
+        auto request = currentRequest;
+        try
+        {
+            route->m_listener->handle_request(request);
+            route->leave();
+        }
+        catch (...)
+        {
+            route->leave();
+            request._reply_if_not_already(status_codes::InternalError);
+        }
+    };
+
+    // The handler runs on the thread that read the request, which for a reactor saves handing it to another thread.
+    // Listeners whose handlers block, for example on the body of their request, which that same reactor reads, have
+    // them offloaded to the shared thread pool.
+    if (m_offload_handlers)
+    {
+        pplx::create_task(handle);
     }
     else
     {
-        boost::asio::async_read_until(
-            *m_socket, m_request_buf, CRLF, [this](const boost::system::error_code& ec, size_t) {
-                (will_deref_t) this->handle_chunked_header(ec);
-            });
+        handle();
     }
-    return will_deref_t {};
 }
 
-template<typename ReadHandler>
-void asio_server_connection::async_read_until_buffersize(size_t size, const ReadHandler& handler)
+will_deref_and_erase_t asio_server_connection::response_ready(const std::shared_ptr<pipelined_request>& pipelined,
+                                                              const http_response& response)
 {
-    // The condition is such that after completing the async_read below, m_request_buf will contain at least `size`
-    // bytes.
-    auto condition = transfer_at_least(0);
-
-    auto bufsize = m_request_buf.size();
-    if (size > bufsize)
+    bool closed;
+    bool write;
     {
-        condition = transfer_at_least(size - bufsize);
+        std::lock_guard<std::mutex> lock(m_request_mtx);
+        pipelined->m_response = response;
+        pipelined->m_ready = true;
+
+        // Otherwise the response is written after those of the earlier requests.
+        closed = m_closed;
+        write = !closed && !m_writing && m_pipeline.front() == pipelined;
+        m_writing = m_writing || write;
     }
 
-    if (m_ssl_stream)
+    if (write)
     {
-        boost::asio::async_read(*m_ssl_stream, m_request_buf, condition, handler);
+        return write_response(pipelined);
     }
-    else
+    if (closed)
     {
-        boost::asio::async_read(*m_socket, m_request_buf, condition, handler);
+        fail_unsent_response(response);
     }
+    (will_deref_t) deref();
+    return will_deref_and_erase_t {};
 }
 
-will_deref_and_erase_t asio_server_connection::dispatch_request_to_listener()
+void asio_server_connection::fail_unsent_response(const http_response& response)
 {
-    // locate the listener:
-    http_listener_impl* pListener = nullptr;
-    auto currentRequest = get_request();
-    try
+    auto* context = static_cast<linux_request_context*>(response._get_server_context());
+    if (context != nullptr)
     {
-        pListener = m_p_parent->find_listener(currentRequest.relative_uri());
+        context->m_response_completed.set_exception(http_exception("connection closed before the response was sent"));
     }
-    catch (const std::exception&) // may be web::uri_exception, or std::range_error indicating invalid Unicode
+}
+
+will_deref_and_erase_t asio_server_connection::write_response(const std::shared_ptr<pipelined_request>& pipelined)
+{
+    bool last;
     {
-        currentRequest.reply(status_codes::BadRequest);
-        (will_erase_from_parent_t) do_response();
-        (will_deref_t) deref();
-        return will_deref_and_erase_t {};
+        std::lock_guard<std::mutex> lock(m_request_mtx);
+        last = m_draining && m_pipeline.size() == 1;
     }
-
-    if (pListener == nullptr)
+    if (last)
     {
-        currentRequest.reply(status_codes::NotFound);
-        (will_erase_from_parent_t) do_response();
-        (will_deref_t) deref();
-        return will_deref_and_erase_t {};
+        // Telling the client lets it open a new connection for its next request, instead of finding this one closed.
+        pipelined->m_response.headers()[header_names::connection] = U("close");
     }
 
-    currentRequest._set_listener_path(pListener->uri().path());
-    (will_erase_from_parent_t) do_response();
+    serialize_headers(pipelined->m_request, pipelined->m_response);
+    return async_write_head(pipelined->m_response);
+}
 
-    // Look up the lock for the http_listener.
-    pplx::extensibility::reader_writer_lock_t* pListenerLock;
+will_deref_and_erase_t asio_server_connection::write_next_response()
+{
+    if (m_response_close)
     {
-        pplx::extensibility::reader_writer_lock_t::scoped_lock_read lock(m_p_server->m_listeners_lock);
-
-        // It is possible the listener could have unregistered.
-        if (m_p_server->m_registered_listeners.find(pListener) == m_p_server->m_registered_listeners.end())
         {
-            currentRequest.reply(status_codes::NotFound);
-
-            (will_deref_t) deref();
-            return will_deref_and_erase_t {};
+            std::lock_guard<std::mutex> lock(m_request_mtx);
+            m_pipeline.pop_front();
+            --*m_in_flight;
         }
-        pListenerLock = m_p_server->m_registered_listeners[pListener].get();
+        return finish_request_response();
+    }
 
-        // We need to acquire the listener's lock before releasing the registered listeners lock.
-        // But we don't need to hold the registered listeners lock when calling into the user's code.
-        pListenerLock->lock_read();
+    std::shared_ptr<pipelined_request> next;
+    bool resume_reading = false;
+    bool erase = false;
+    {
+        std::lock_guard<std::mutex> lock(m_request_mtx);
+        m_pipeline.pop_front();
+        --*m_in_flight;
+        if (!m_pipeline.empty() && m_pipeline.front()->m_ready)
+        {
+            next = m_pipeline.front();
+        }
+        else
+        {
+            m_writing = false;
+            if (m_read_paused && m_pipeline.size() < m_pipeline_depth)
+            {
+                m_read_paused = false;
+                resume_reading = true;
+            }
+            erase = !m_erased && m_read_ended && m_pipeline.empty();
+            m_erased = m_erased || erase;
+        }
     }
 
-    try
+    if (next)
     {
-        pListener->handle_request(currentRequest);
-        pListenerLock->unlock();
+        return write_response(next);
     }
-    catch (...)
+    if (resume_reading)
     {
-        pListenerLock->unlock();
-        currentRequest._reply_if_not_already(status_codes::InternalError);
+        return start_request_response();
+    }
+    if (erase)
+    {
+        return erase_from_parent();
     }
-
     (will_deref_t) deref();
     return will_deref_and_erase_t {};
 }
 
-void asio_server_connection::serialize_headers(http_response response)
+void asio_server_connection::serialize_headers(const http_request& request, http_response response)
 {
     m_response_buf.consume(m_response_buf.size()); // clear the buffer
-    std::ostream os(&m_response_buf);
-    os.imbue(std::locale::classic());
+    m_response_head.clear();
 
-    os << "HTTP/1.1 " << response.status_code() << " " << utility::conversions::to_utf8string(response.reason_phrase())
-       << CRLF;
+    apply_byte_range(request, response);
+    if (response.status_code() != m_status_code || response.reason_phrase() != m_reason_phrase)
+    {
+        m_status_code = response.status_code();
+        m_reason_phrase = response.reason_phrase();
+        m_status_line = "HTTP/1.1 " + to_string(m_status_code) + " " +
+                        utility::conversions::to_utf8string(m_reason_phrase) + CRLF;
+    }
+    m_response_head.append(m_status_line);
 
     m_chunked = false;
+    m_response_close = false;
     m_write = m_write_size = 0;
 
+    m_compressor.reset();
+    if (m_compression && response.body())
+    {
+        m_compressor = m_compression->make_compressor(request, response);
+    }
+    if (m_compressor)
+    {
+        // The compressed length is not known until the whole body has been compressed.
+        m_compress_input.clear();
+        m_compress_position = 0;
+        m_compress_eof = false;
+        m_compress_done = false;
+        response.headers().remove(header_names::content_length);
+        response.headers()[header_names::content_encoding] = m_compressor->algorithm();
+        response.headers()[header_names::transfer_encoding] = U("chunked");
+        utility::string_t vary;
+        if (!response.headers().match(header_names::vary, vary) ||
+            !lists_token(vary, header_names::accept_encoding))
+        {
+            response.headers().add(header_names::vary, header_names::accept_encoding);
+        }
+    }
+
     std::string transferencoding;
     if (response.headers().match(header_names::transfer_encoding, transferencoding) && transferencoding == "chunked")
     {
@@ -1092,6 +2664,7 @@ void asio_server_connection::serialize_headers(http_response response)
         response.headers().add(header_names::content_length, 0);
     }
 
+    bool has_date = false;
     for (const auto& header : response.headers())
     {
         // check if the responder has requested we close the connection
@@ -1100,12 +2673,77 @@ void asio_server_connection::serialize_headers(http_response response)
             if (boost::iequals(header.second, U("close")))
             {
                 m_close = true;
+                m_response_close = true;
             }
         }
-        os << utility::conversions::to_utf8string(header.first) << ": "
-           << utility::conversions::to_utf8string(header.second) << CRLF;
+        else if (boost::iequals(header.first, header_names::date))
+        {
+            has_date = true;
+        }
+        m_response_head.append(utility::conversions::to_utf8string(header.first));
+        m_response_head.append(": ");
+        m_response_head.append(utility::conversions::to_utf8string(header.second));
+        m_response_head.append("\r\n");
+    }
+    if (!has_date)
+    {
+        m_response_head.append("Date: ");
+        append_http_date(m_response_head);
+        m_response_head.append("\r\n");
+    }
+    m_response_head.append("\r\n");
+}
+
+void asio_server_connection::apply_byte_range(const http_request& request, http_response& response)
+{
+    // Only bodies read from a file of known length are served in parts.
+    utility::size64_t size = 0;
+    if (response.status_code() != status_codes::OK || !response.body() ||
+        file_buffer_of(response._get_impl()->instream().streambuf()) == nullptr ||
+        !response.headers().match(header_names::content_length, size))
+    {
+        return;
+    }
+
+    auto& headers = response.headers();
+    if (!headers.has(header_names::accept_ranges))
+    {
+        headers.add(header_names::accept_ranges, U("bytes"));
+    }
+
+    // Without validators to check If-Range against, a conditional range request gets the whole body.
+    utility::string_t range;
+    if (request.method() != methods::GET || !request.headers().match(header_names::range, range) ||
+        request.headers().has(header_names::if_range) || headers.has(header_names::content_range))
+    {
+        return;
+    }
+
+    utility::size64_t first = 0;
+    utility::size64_t last = 0;
+    switch (parse_byte_range(range, size, first, last))
+    {
+        case byte_range::ignored: break;
+        case byte_range::unsatisfiable:
+            response.set_status_code(status_codes::RangeNotSatisfiable);
+            response.set_reason_phrase(
+                web::http::details::get_default_reason_phrase(status_codes::RangeNotSatisfiable));
+            headers[header_names::content_range] = U("bytes */") + utility::conversions::details::to_string_t(size);
+            headers[header_names::content_length] = U("0");
+            break;
+        case byte_range::satisfiable:
+        {
+            auto readbuf = response._get_impl()->instream().streambuf();
+            readbuf.seekpos(readbuf.getpos(std::ios_base::in) + static_cast<std::streamoff>(first), std::ios_base::in);
+            response.set_status_code(status_codes::PartialContent);
+            response.set_reason_phrase(web::http::details::get_default_reason_phrase(status_codes::PartialContent));
+            headers[header_names::content_range] = U("bytes ") + utility::conversions::details::to_string_t(first) +
+                                                   U("-") + utility::conversions::details::to_string_t(last) + U("/") +
+                                                   utility::conversions::details::to_string_t(size);
+            headers[header_names::content_length] = utility::conversions::details::to_string_t(last - first + 1);
+            break;
+        }
     }
-    os << CRLF;
 }
 
 will_deref_and_erase_t asio_server_connection::cancel_sending_response_with_error(const http_response& response,
@@ -1157,6 +2795,99 @@ will_deref_and_erase_t asio_server_connection::handle_write_chunked_response(con
     return will_deref_and_erase_t {};
 }
 
+will_deref_and_erase_t asio_server_connection::handle_write_compressed_response(const http_response& response,
+                                                                                const boost::system::error_code& ec)
+{
+    if (ec)
+    {
+        return handle_response_written(response, ec);
+    }
+
+    if (m_compress_done)
+    {
+        // the last chunk
+        auto membuf = m_response_buf.prepare(chunked_encoding::additional_encoding_space);
+        size_t offset = chunked_encoding::add_chunked_delimiters(
+            buffer_cast<uint8_t*>(membuf), chunked_encoding::additional_encoding_space, 0);
+        m_response_buf.commit(chunked_encoding::additional_encoding_space);
+        m_response_buf.consume(offset);
+        return async_write(&asio_server_connection::handle_response_written, response);
+    }
+
+    if (m_compress_position < m_compress_input.size() || m_compress_eof)
+    {
+        return write_compressed_chunk(response);
+    }
+
+    // read the next block of the body
+    auto readbuf = response._get_impl()->instream().streambuf();
+    m_compress_input.resize(ChunkSize);
+    readbuf.getn(m_compress_input.data(), ChunkSize)
+        .then([=](pplx::task<size_t> actualSizeTask) -> will_deref_and_erase_t {
+            size_t actualSize = 0;
+            try
+            {
+                actualSize = actualSizeTask.get();
+            }
+            catch (...)
+            {
+                return cancel_sending_response_with_error(response, std::current_exception());
+            }
+            m_compress_input.resize(actualSize);
+            m_compress_position = 0;
+            m_compress_eof = actualSize == 0;
+            return write_compressed_chunk(response);
+        });
+    return will_deref_and_erase_t {};
+}
+
+will_deref_and_erase_t asio_server_connection::write_compressed_chunk(const http_response& response)
+{
+    auto membuf = m_response_buf.prepare(ChunkSize + chunked_encoding::additional_encoding_space);
+    uint8_t* const data = buffer_cast<uint8_t*>(membuf);
+    const auto hint = m_compress_eof ? web::http::compression::operation_hint::is_last
+                                     : web::http::compression::operation_hint::has_more;
+    size_t processed = 0;
+    size_t produced = 0;
+    try
+    {
+        produced = m_compressor->compress(m_compress_input.data() + m_compress_position,
+                                          m_compress_input.size() - m_compress_position,
+                                          data + chunked_encoding::data_offset,
+                                          ChunkSize,
+                                          hint,
+                                          processed,
+                                          m_compress_done);
+    }
+    catch (...)
+    {
+        return cancel_sending_response_with_error(response, std::current_exception());
+    }
+    m_compress_position += processed;
+
+    if (produced == 0)
+    {
+        if (m_compress_eof && !m_compress_done && processed == 0)
+        {
+            return cancel_sending_response_with_error(
+                response, std::make_exception_ptr(http_exception("Compressor did not finish the response body")));
+        }
+
+        // The compressor holds on to small inputs until it has a block to emit, so more of the body is read. The step
+        // is posted rather than called, so that a long run of such inputs does not grow the stack.
+        crossplat::threadpool::shared_instance().service().post([=] {
+            (will_deref_and_erase_t) this->handle_write_compressed_response(response, boost::system::error_code());
+        });
+        return will_deref_and_erase_t {};
+    }
+
+    size_t offset = chunked_encoding::add_chunked_delimiters(
+        data, ChunkSize + chunked_encoding::additional_encoding_space, produced);
+    m_response_buf.commit(produced + chunked_encoding::additional_encoding_space);
+    m_response_buf.consume(offset);
+    return async_write(&asio_server_connection::handle_write_compressed_response, response);
+}
+
 will_deref_and_erase_t asio_server_connection::handle_write_large_response(const http_response& response,
                                                                            const boost::system::error_code& ec)
 {
@@ -1166,6 +2897,32 @@ will_deref_and_erase_t asio_server_connection::handle_write_large_response(const
     if (readbuf.is_eof())
         return cancel_sending_response_with_error(
             response, std::make_exception_ptr(http_exception("Response stream close early!")));
+
+#if defined(__linux__)
+    // Files go straight from the page cache to the socket.
+    if (!m_ssl_stream)
+    {
+        auto file_buffer = file_buffer_of(readbuf);
+        if (file_buffer != nullptr &&
+            concurrency::streams::details::_file_buffer_access::native_handle(*file_buffer) != -1)
+        {
+            return async_sendfile(response, static_cast<size_t>(readbuf.getpos(std::ios_base::in)));
+        }
+    }
+#endif
+
+    // Blocks the stream buffer exposes directly are written without being copied.
+    uint8_t* block = nullptr;
+    size_t block_size = 0;
+    if (readbuf.acquire(block, block_size) && block != nullptr)
+    {
+        return async_write_gathered(&asio_server_connection::handle_write_large_response,
+                                    response,
+                                    boost::asio::const_buffer(),
+                                    block,
+                                    (std::min)(block_size, m_write_size - m_write));
+    }
+
     size_t readBytes = (std::min)(ChunkSize, m_write_size - m_write);
     readbuf.getn(buffer_cast<uint8_t*>(m_response_buf.prepare(readBytes)), readBytes)
         .then([=](pplx::task<size_t> actualSizeTask) -> will_deref_and_erase_t {
@@ -1185,6 +2942,64 @@ will_deref_and_erase_t asio_server_connection::handle_write_large_response(const
     return will_deref_and_erase_t {};
 }
 
+#if defined(__linux__)
+will_deref_and_erase_t asio_server_connection::async_sendfile(const http_response& response, size_t offset)
+{
+    // offset is the position of the file the body started at; m_write counts the bytes sent since.
+    auto readbuf = response._get_impl()->instream().streambuf();
+    const int file = concurrency::streams::details::_file_buffer_access::native_handle(*file_buffer_of(readbuf));
+
+    // Each step sends at most SendfileChunkSize bytes, then waits for the socket to be writable, so that a large file
+    // does not hold the thread that runs the completion handlers of the other connections.
+    boost::system::error_code ec;
+    m_socket->native_non_blocking(true, ec);
+    size_t step = 0;
+    while (!ec && m_write < m_write_size && step < SendfileChunkSize)
+    {
+        off_t file_offset = static_cast<off_t>(offset + m_write);
+        const size_t count = (std::min)(m_write_size - m_write, SendfileChunkSize - step);
+        const ssize_t sent = ::sendfile(m_socket->native_handle(), file, &file_offset, count);
+        if (sent > 0)
+        {
+            m_write += static_cast<size_t>(sent);
+            step += static_cast<size_t>(sent);
+        }
+        else if (sent == 0)
+        {
+            return cancel_sending_response_with_error(
+                response, std::make_exception_ptr(http_exception("Response stream close early!")));
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        else if (errno != EINTR)
+        {
+            ec = boost::system::error_code(errno, boost::system::system_category());
+        }
+    }
+
+    if (!ec && m_write < m_write_size)
+    {
+        m_socket->async_wait(boost::asio::ip::tcp::socket::wait_write, [=](const boost::system::error_code& ec) {
+            if (ec)
+            {
+                (will_deref_and_erase_t) this->handle_response_written(response, ec);
+            }
+            else
+            {
+                (will_deref_and_erase_t) this->async_sendfile(response, offset);
+            }
+        });
+        return will_deref_and_erase_t {};
+    }
+
+    // sendfile does not move the read position of the stream buffer
+    readbuf.seekpos(static_cast<std::streamoff>(offset + m_write), std::ios_base::in);
+    return handle_response_written(response, ec);
+}
+#endif
+
 will_deref_and_erase_t asio_server_connection::handle_headers_written(const http_response& response,
                                                                       const boost::system::error_code& ec)
 {
@@ -1195,7 +3010,9 @@ will_deref_and_erase_t asio_server_connection::handle_headers_written(const http
     }
     else
     {
-        if (m_chunked)
+        if (m_compressor)
+            return handle_write_compressed_response(response, ec);
+        else if (m_chunked)
             return handle_write_chunked_response(response, ec);
         else
             return handle_write_large_response(response, ec);
@@ -1214,18 +3031,58 @@ will_deref_and_erase_t asio_server_connection::handle_response_written(const htt
     else
     {
         context->m_response_completed.set();
-        if (!m_close)
+        return write_next_response();
+    }
+}
+
+will_deref_and_erase_t asio_server_connection::finish_request_response()
+{
+    // No more responses are written. The responses that were ready fail here and those still to come fail in
+    // response_ready. The connection is erased from its parent once the reads have ended as well, since until then
+    // requests may still be dispatched.
+    std::vector<http_response> unsent;
+    bool erase;
+    {
+        std::lock_guard<std::mutex> lock(m_request_mtx);
+        m_closed = true;
+        m_writing = false;
+        for (const auto& pipelined : m_pipeline)
         {
-            return start_request_response();
+            if (pipelined->m_ready)
+            {
+                unsent.push_back(pipelined->m_response);
+            }
         }
-        else
+        *m_in_flight -= m_pipeline.size();
+        m_pipeline.clear();
+
+        if (m_read_paused)
         {
-            return finish_request_response();
+            m_read_paused = false;
+            m_read_ended = true;
         }
+        erase = !m_erased && m_read_ended;
+        m_erased = m_erased || erase;
+    }
+
+    for (const auto& response : unsent)
+    {
+        fail_unsent_response(response);
     }
+    if (erase)
+    {
+        return erase_from_parent();
+    }
+
+    // The pending read fails once the socket is shut down, and ends the reads.
+    m_close = true;
+    boost::system::error_code ec;
+    m_socket->shutdown(tcp::socket::shutdown_both, ec);
+    (will_deref_t) deref();
+    return will_deref_and_erase_t {};
 }
 
-will_deref_and_erase_t asio_server_connection::finish_request_response()
+will_deref_and_erase_t asio_server_connection::erase_from_parent()
 {
     // kill the connection
     m_p_parent->internal_erase_connection(this);
@@ -1252,6 +3109,65 @@ void hostport_listener::stop()
     m_all_connections_complete.wait();
 }
 
+pplx::task<size_t> hostport_listener::drain(std::chrono::milliseconds timeout)
+{
+    std::shared_ptr<pplx::task_completion_event<size_t>> drained;
+    {
+        std::lock_guard<std::mutex> lock(m_connections_lock);
+        if (!m_drained)
+        {
+            m_drained = std::make_shared<pplx::task_completion_event<size_t>>();
+            m_acceptor.reset();
+            for (auto connection : m_connections)
+            {
+                connection->drain();
+            }
+            if (m_connections.empty())
+            {
+                m_drained->set(m_in_flight->load());
+            }
+        }
+        drained = m_drained;
+    }
+
+    // Whichever of the connections closing and the timer comes first completes the drain; no thread waits for either.
+    // Longer timeouts are capped at a year, so that the expiry time cannot overflow.
+    const auto wait = (std::min)((std::max)(timeout, std::chrono::milliseconds(0)),
+                                 std::chrono::milliseconds(std::chrono::hours(24 * 365)));
+    auto timer = std::make_shared<boost::asio::steady_timer>(crossplat::threadpool::shared_instance().service(), wait);
+    pplx::task_completion_event<size_t> result;
+    auto in_flight = m_in_flight;
+    timer->async_wait([result, in_flight](const boost::system::error_code&) { result.set(in_flight->load()); });
+    pplx::create_task(*drained).then([result, timer](size_t in_flight_requests) {
+        timer->cancel();
+        result.set(in_flight_requests);
+    });
+    return pplx::create_task(result);
+}
+
+// The key of a listener path in the routing table: its segments, with the names of the parameters left out so that
+// paths differing only in those names are rejected as duplicates.
+std::string route_key(const std::string& path, std::vector<std::string>* parameters)
+{
+    std::string key = "/";
+    for (const auto& segment : path_segments(path))
+    {
+        if (is_parameter_segment(segment))
+        {
+            if (parameters != nullptr)
+            {
+                parameters->push_back(segment.substr(1, segment.size() - 2));
+            }
+            key += "{}/";
+        }
+        else
+        {
+            key += segment + "/";
+        }
+    }
+    return key;
+}
+
 void hostport_listener::add_listener(const std::string& path, http_listener_impl* listener)
 {
     pplx::extensibility::scoped_rw_lock_t lock(m_listeners_lock);
@@ -1259,15 +3175,30 @@ void hostport_listener::add_listener(const std::string& path, http_listener_impl
     if (m_is_https != (listener->uri().scheme() == U("https")))
         throw std::invalid_argument(
             "Error: http_listener can not simultaneously listen both http and https paths of one host");
-    else if (!m_listeners.insert(std::map<std::string, http_listener_impl*>::value_type(path, listener)).second)
+
+    std::vector<std::string> parameters;
+    auto key = route_key(path, &parameters);
+    if (m_routes.find(key) != m_routes.end())
         throw std::invalid_argument("Error: http_listener is already registered for this path");
+
+    auto routes = m_routes;
+    routes[key] = std::make_shared<listener_route>(listener, std::move(parameters));
+    std::shared_ptr<const route_node> table = build_route_table(routes);
+    m_routes.swap(routes);
+    std::atomic_store(&m_route_table, table);
 }
 
-void hostport_listener::remove_listener(const std::string& path, http_listener_impl*)
+std::shared_ptr<listener_route> hostport_listener::remove_listener(const std::string& path, http_listener_impl*)
 {
     pplx::extensibility::scoped_rw_lock_t lock(m_listeners_lock);
 
-    if (m_listeners.erase(path) != 1) throw std::invalid_argument("Error: no http_listener found for this path");
+    auto it = m_routes.find(route_key(path, nullptr));
+    if (it == m_routes.end()) throw std::invalid_argument("Error: no http_listener found for this path");
+
+    auto route = it->second;
+    m_routes.erase(it);
+    std::atomic_store(&m_route_table, std::shared_ptr<const route_node>(build_route_table(m_routes)));
+    return route;
 }
 
 pplx::task<void> http_linux_server::start()
@@ -1341,13 +3272,15 @@ pplx::task<void> http_linux_server::register_listener(http_listener_impl* listen
             throw std::invalid_argument("listener already registered");
         }
 
+        bool added_hostport_listener = false;
         try
         {
-            m_registered_listeners[listener] = make_unique<pplx::extensibility::reader_writer_lock_t>();
+            m_registered_listeners.insert(listener);
 
             auto found_hostport_listener = m_listeners.find(hostport);
             if (found_hostport_listener == m_listeners.end())
             {
+                added_hostport_listener = true;
                 found_hostport_listener =
                     m_listeners
                         .insert(std::make_pair(
@@ -1369,7 +3302,10 @@ pplx::task<void> http_linux_server::register_listener(http_listener_impl* listen
             // the hostport_listener::start() method should be made to return a task
             // throwing the exception.
             m_registered_listeners.erase(listener);
-            m_listeners.erase(hostport);
+            if (added_hostport_listener)
+            {
+                m_listeners.erase(hostport);
+            }
             throw;
         }
     }
@@ -1383,6 +3319,7 @@ pplx::task<void> http_linux_server::unregister_listener(http_listener_impl* list
     auto hostport = parts.first;
     auto path = parts.second;
     // First remove the listener from hostport listener
+    std::shared_ptr<listener_route> route;
     {
         pplx::extensibility::scoped_read_lock_t lock(m_listeners_lock);
         auto itr = m_listeners.find(hostport);
@@ -1391,26 +3328,37 @@ pplx::task<void> http_linux_server::unregister_listener(http_listener_impl* list
             throw std::invalid_argument("Error: no listener registered for that host");
         }
 
-        itr->second->remove_listener(path, listener);
+        route = itr->second->remove_listener(path, listener);
     }
 
     // Second remove the listener form listener collection
-    std::unique_ptr<pplx::extensibility::reader_writer_lock_t> pListenerLock = nullptr;
     {
         pplx::extensibility::scoped_rw_lock_t lock(m_listeners_lock);
-        pListenerLock = std::move(m_registered_listeners[listener]);
-        m_registered_listeners[listener] = nullptr;
         m_registered_listeners.erase(listener);
     }
 
-    // Then take the listener write lock to make sure there are no calls into the listener's
-    // request handler.
-    if (pListenerLock != nullptr)
+    // Then wait until there are no calls into the listener's request handler.
+    route->remove();
+
+    return pplx::task_from_result();
+}
+
+pplx::task<size_t> http_linux_server::drain(http_listener_impl* listener, std::chrono::milliseconds timeout)
+{
+    pplx::extensibility::scoped_read_lock_t lock(m_listeners_lock);
+    auto itr = m_listeners.find(canonical_parts(listener->uri()).first);
+    if (itr == m_listeners.end())
     {
-        pplx::extensibility::scoped_rw_lock_t lock(*pListenerLock);
+        return pplx::task_from_result<size_t>(0);
     }
+    return itr->second->drain(timeout);
+}
 
-    return pplx::task_from_result();
+size_t http_linux_server::in_flight_requests(http_listener_impl* listener)
+{
+    pplx::extensibility::scoped_read_lock_t lock(m_listeners_lock);
+    auto itr = m_listeners.find(canonical_parts(listener->uri()).first);
+    return itr == m_listeners.end() ? 0 : itr->second->in_flight()->load();
 }
 
 pplx::task<void> http_linux_server::respond(http_response response)
@@ -31,7 +31,7 @@ utility::istream_t& web::json::operator>>(utility::istream_t& is, json::value& v
 }
 
 web::json::value::value()
-    : m_value(utility::details::make_unique<web::json::details::_Null>())
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_Null>())
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Null)
 #endif
@@ -39,7 +39,7 @@ web::json::value::value()
 }
 
 web::json::value::value(int value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_Number>(value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -47,7 +47,7 @@ web::json::value::value(int value)
 }
 
 web::json::value::value(unsigned value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_Number>(value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -56,7 +56,7 @@ web::json::value::value(unsigned value)
 
 
 web::json::value::value(long value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_Number>(value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -64,7 +64,7 @@ web::json::value::value(long value)
 }
 
 web::json::value::value(unsigned long value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_Number>(value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -72,7 +72,7 @@ web::json::value::value(unsigned long value)
 }
 
 web::json::value::value(long long value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_Number>(value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -80,7 +80,7 @@ web::json::value::value(long long value)
 }
 
 web::json::value::value(unsigned long long value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_Number>(value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -88,7 +88,7 @@ web::json::value::value(unsigned long long value)
 }
 
 web::json::value::value(double value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_Number>(value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -96,7 +96,7 @@ web::json::value::value(double value)
 }
 
 web::json::value::value(bool value)
-    : m_value(utility::details::make_unique<web::json::details::_Boolean>(value))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_Boolean>(value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Boolean)
 #endif
@@ -104,7 +104,7 @@ web::json::value::value(bool value)
 }
 
 web::json::value::value(utility::string_t value)
-    : m_value(utility::details::make_unique<web::json::details::_String>(std::move(value)))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_String>(std::move(value)))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::String)
 #endif
@@ -112,7 +112,7 @@ web::json::value::value(utility::string_t value)
 }
 
 web::json::value::value(utility::string_t value, bool has_escape_chars)
-    : m_value(utility::details::make_unique<web::json::details::_String>(std::move(value), has_escape_chars))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_String>(std::move(value), has_escape_chars))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::String)
 #endif
@@ -120,7 +120,7 @@ web::json::value::value(utility::string_t value, bool has_escape_chars)
 }
 
 web::json::value::value(const utility::char_t* value)
-    : m_value(utility::details::make_unique<web::json::details::_String>(value))
+    : m_value(web::json::details::_Value_ptr::make<web::json::details::_String>(value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::String)
 #endif
@@ -128,7 +128,8 @@ web::json::value::value(const utility::char_t* value)
 }
 
 web::json::value::value(const utility::char_t* value, bool has_escape_chars)
-    : m_value(utility::details::make_unique<web::json::details::_String>(utility::string_t(value), has_escape_chars))
+    : m_value(
+          web::json::details::_Value_ptr::make<web::json::details::_String>(utility::string_t(value), has_escape_chars))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::String)
 #endif
@@ -147,7 +148,7 @@ web::json::value& web::json::value::operator=(const value& other)
 {
     if (this != &other)
     {
-        m_value = std::unique_ptr<details::_Value>(other.m_value->_copy_value());
+        m_value = other.m_value->_copy_value();
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
         m_kind = other.m_kind;
 #endif
@@ -195,7 +196,7 @@ web::json::value web::json::value::boolean(bool value) { return web::json::value
 
 web::json::value web::json::value::string(utility::string_t value)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_String>(std::move(value));
+    details::_Value_ptr ptr = details::_Value_ptr::make<details::_String>(std::move(value));
     return web::json::value(std::move(ptr)
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
                                 ,
@@ -206,8 +207,7 @@ web::json::value web::json::value::string(utility::string_t value)
 
 web::json::value web::json::value::string(utility::string_t value, bool has_escape_chars)
 {
-    std::unique_ptr<details::_Value> ptr =
-        utility::details::make_unique<details::_String>(std::move(value), has_escape_chars);
+    details::_Value_ptr ptr = details::_Value_ptr::make<details::_String>(std::move(value), has_escape_chars);
     return web::json::value(std::move(ptr)
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
                                 ,
@@ -219,8 +219,7 @@ web::json::value web::json::value::string(utility::string_t value, bool has_esca
 #ifdef _WIN32
 web::json::value web::json::value::string(const std::string& value)
 {
-    std::unique_ptr<details::_Value> ptr =
-        utility::details::make_unique<details::_String>(utility::conversions::to_utf16string(value));
+    details::_Value_ptr ptr = details::_Value_ptr::make<details::_String>(utility::conversions::to_utf16string(value));
     return web::json::value(std::move(ptr)
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
                                 ,
@@ -232,7 +231,7 @@ web::json::value web::json::value::string(const std::string& value)
 
 web::json::value web::json::value::object(bool keep_order)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_Object>(keep_order);
+    details::_Value_ptr ptr = details::_Value_ptr::make<details::_Object>(keep_order);
     return web::json::value(std::move(ptr)
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
                                 ,
@@ -243,8 +242,7 @@ web::json::value web::json::value::object(bool keep_order)
 
 web::json::value web::json::value::object(std::vector<std::pair<::utility::string_t, value>> fields, bool keep_order)
 {
-    std::unique_ptr<details::_Value> ptr =
-        utility::details::make_unique<details::_Object>(std::move(fields), keep_order);
+    details::_Value_ptr ptr = details::_Value_ptr::make<details::_Object>(std::move(fields), keep_order);
     return web::json::value(std::move(ptr)
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
                                 ,
@@ -255,7 +253,7 @@ web::json::value web::json::value::object(std::vector<std::pair<::utility::strin
 
 web::json::value web::json::value::array()
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_Array>();
+    details::_Value_ptr ptr = details::_Value_ptr::make<details::_Array>();
     return web::json::value(std::move(ptr)
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
                                 ,
@@ -266,7 +264,7 @@ web::json::value web::json::value::array()
 
 web::json::value web::json::value::array(size_t size)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_Array>(size);
+    details::_Value_ptr ptr = details::_Value_ptr::make<details::_Array>(size);
     return web::json::value(std::move(ptr)
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
                                 ,
@@ -277,7 +275,7 @@ web::json::value web::json::value::array(size_t size)
 
 web::json::value web::json::value::array(std::vector<value> elements)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_Array>(std::move(elements));
+    details::_Value_ptr ptr = details::_Value_ptr::make<details::_Array>(std::move(elements));
     return web::json::value(std::move(ptr)
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
                                 ,
@@ -337,9 +335,9 @@ bool web::json::number::is_int64() const
     }
 }
 
-bool web::json::details::_String::has_escape_chars(const _String& str)
+bool web::json::details::_String::has_escape_chars(const utility::string_t& str)
 {
-    return std::any_of(std::begin(str.m_string), std::end(str.m_string), [](utility::string_t::value_type const x) {
+    return std::any_of(std::begin(str), std::end(str), [](utility::string_t::value_type const x) {
         if (x <= 31)
         {
             return true;
@@ -464,7 +462,7 @@ web::json::value& web::json::value::operator[](const utility::string_t& key)
 {
     if (this->is_null())
     {
-        m_value.reset(new web::json::details::_Object(details::g_keep_json_object_unsorted));
+        m_value = details::_Value_ptr::make<details::_Object>(details::g_keep_json_object_unsorted);
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
         m_kind = value::Object;
 #endif
@@ -476,7 +474,7 @@ web::json::value& web::json::value::operator[](size_t index)
 {
     if (this->is_null())
     {
-        m_value.reset(new web::json::details::_Array());
+        m_value = details::_Value_ptr::make<details::_Array>();
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
         m_kind = value::Array;
 #endif
@@ -484,6 +482,228 @@ web::json::value& web::json::value::operator[](size_t index)
     return m_value->index(index);
 }
 
+namespace
+{
+// Blocks grow with the document, so that small documents stay small and large ones need few blocks.
+const size_t min_arena_block_size = 4096;
+const size_t max_arena_block_size = 1024 * 1024;
+
+const size_t arena_alignment = std::alignment_of<web::json::details::_Document_node>::value;
+
+const web::json::details::_Document_node null_document_node = {web::json::value::Null, 0, false, 0, {false}};
+
+bool document_field_less(const web::json::details::_Document_field& field, const utility::string_t& key)
+{
+    return web::json::details::_Document_field::name_less(field.m_name, field.m_name_size, key.c_str(), key.size());
+}
+} // namespace
+
+void* web::json::details::_Document_arena::allocate(size_t size)
+{
+    size = (size + arena_alignment - 1) & ~(arena_alignment - 1);
+    if (size > m_remaining)
+    {
+        size_t blockSize = (std::min)((m_blocks.size() + 1) * min_arena_block_size, max_arena_block_size);
+        if (blockSize < size)
+        {
+            blockSize = size;
+        }
+
+        m_blocks.emplace_back(new char[blockSize]);
+        m_next = m_blocks.back().get();
+        m_remaining = blockSize;
+    }
+
+    void* result = m_next;
+    m_next += size;
+    m_remaining -= size;
+    return result;
+}
+
+web::json::number web::json::document_value::as_number() const
+{
+    if (!is_number())
+    {
+        throw json_exception("not a number");
+    }
+
+    switch (m_node->m_number_kind)
+    {
+        case details::_Document_node::signed_number: return json::number(static_cast<long long>(m_node->m_signed));
+        case details::_Document_node::unsigned_number:
+            return json::number(static_cast<unsigned long long>(m_node->m_unsigned));
+        default: return json::number(m_node->m_double);
+    }
+}
+
+double web::json::document_value::as_double() const { return as_number().to_double(); }
+
+int web::json::document_value::as_integer() const { return as_number().to_int32(); }
+
+bool web::json::document_value::as_bool() const
+{
+    if (!is_boolean())
+    {
+        throw json_exception("not a boolean");
+    }
+    return m_node->m_boolean;
+}
+
+utility::string_t web::json::document_value::as_string() const
+{
+    if (!is_string())
+    {
+        throw json_exception("not a string");
+    }
+    return utility::string_t(m_node->m_string, m_node->m_size);
+}
+
+bool web::json::document_value::has_field(const utility::string_t& key) const
+{
+    if (!is_object())
+    {
+        return false;
+    }
+
+    const details::_Document_field* first = m_node->m_fields;
+    const details::_Document_field* last = first + m_node->m_size;
+    if (m_node->m_sorted)
+    {
+        first = std::lower_bound(first, last, key, document_field_less);
+        return first != last && key.compare(0, key.size(), first->m_name, first->m_name_size) == 0;
+    }
+
+    return std::any_of(first, last, [&key](const details::_Document_field& field) {
+        return key.compare(0, key.size(), field.m_name, field.m_name_size) == 0;
+    });
+}
+
+web::json::document_value web::json::document_value::at(const utility::string_t& key) const
+{
+    if (!is_object())
+    {
+        throw json_exception("not an object");
+    }
+
+    const details::_Document_field* first = m_node->m_fields;
+    const details::_Document_field* last = first + m_node->m_size;
+    const details::_Document_field* found;
+    if (m_node->m_sorted)
+    {
+        found = std::lower_bound(first, last, key, document_field_less);
+    }
+    else
+    {
+        found = std::find_if(first, last, [&key](const details::_Document_field& field) {
+            return key.compare(0, key.size(), field.m_name, field.m_name_size) == 0;
+        });
+    }
+
+    if (found == last || key.compare(0, key.size(), found->m_name, found->m_name_size) != 0)
+    {
+        throw json_exception("Key not found");
+    }
+    return document_value(&found->m_value);
+}
+
+web::json::document_value web::json::document_value::at(size_t index) const
+{
+    if (!is_array())
+    {
+        throw json_exception("not an array");
+    }
+    if (index >= m_node->m_size)
+    {
+        throw json_exception("index out of bounds");
+    }
+    return document_value(m_node->m_elements + index);
+}
+
+const web::json::details::_Document_field& web::json::document_value::field(size_t index) const
+{
+    if (!is_object())
+    {
+        throw json_exception("not an object");
+    }
+    if (index >= m_node->m_size)
+    {
+        throw json_exception("index out of bounds");
+    }
+    return m_node->m_fields[index];
+}
+
+utility::string_t web::json::document_value::field_name(size_t index) const
+{
+    const details::_Document_field& f = field(index);
+    return utility::string_t(f.m_name, f.m_name_size);
+}
+
+web::json::document_value web::json::document_value::field_value(size_t index) const
+{
+    return document_value(&field(index).m_value);
+}
+
+web::json::value web::json::document_value::to_value() const
+{
+    switch (type())
+    {
+        case json::value::Number:
+            switch (m_node->m_number_kind)
+            {
+                case details::_Document_node::signed_number: return json::value::number(m_node->m_signed);
+                case details::_Document_node::unsigned_number: return json::value::number(m_node->m_unsigned);
+                default: return json::value::number(m_node->m_double);
+            }
+        case json::value::Boolean: return json::value::boolean(m_node->m_boolean);
+        case json::value::String: return json::value::string(as_string());
+        case json::value::Array:
+        {
+            std::vector<json::value> elements;
+            elements.reserve(m_node->m_size);
+            for (size_t i = 0; i < m_node->m_size; ++i)
+            {
+                elements.push_back(document_value(m_node->m_elements + i).to_value());
+            }
+            return json::value::array(std::move(elements));
+        }
+        case json::value::Object:
+        {
+            std::vector<std::pair<utility::string_t, json::value>> fields;
+            fields.reserve(m_node->m_size);
+            for (size_t i = 0; i < m_node->m_size; ++i)
+            {
+                const details::_Document_field& f = m_node->m_fields[i];
+                fields.emplace_back(utility::string_t(f.m_name, f.m_name_size), document_value(&f.m_value).to_value());
+            }
+            return json::value::object(std::move(fields), !m_node->m_sorted);
+        }
+        default: return json::value::null();
+    }
+}
+
+web::json::document::document() : m_root(&null_document_node) {}
+
+web::json::document::document(document&& other) CPPREST_NOEXCEPT : m_arena(std::move(other.m_arena)),
+                                                                   m_root(other.m_root)
+{
+    other.m_root = &null_document_node;
+}
+
+web::json::document& web::json::document::operator=(document&& other) CPPREST_NOEXCEPT
+{
+    if (this != &other)
+    {
+        m_arena = std::move(other.m_arena);
+        m_root = other.m_root;
+        other.m_root = &null_document_node;
+    }
+    return *this;
+}
+
+web::json::document::~document() {}
+
+web::json::document_value web::json::document::root() const { return document_value(m_root); }
+
 // Remove once VS 2013 is no longer supported.
 #if defined(_WIN32) && _MSC_VER < 1900
 static web::json::details::json_error_category_impl instance;
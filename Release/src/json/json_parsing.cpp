@@ -13,8 +13,15 @@
 
 #include "stdafx.h"
 
+#include "cpprest/json_reader.h"
+#include <cfloat>
 #include <cstdlib>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPPREST_JSON_SSE2
+#endif
+
 #if defined(_MSC_VER)
 #pragma warning(disable : 4127) // allow expressions like while(true) pass
 #endif
@@ -132,6 +139,9 @@ public:
 #endif
     }
 
+    web::json::document ParseDocument();
+    web::json::document ParseDocument(std::error_code& error);
+
 protected:
     typedef typename std::char_traits<CharType>::int_type int_type;
     virtual int_type NextCharacter() = 0;
@@ -139,6 +149,7 @@ protected:
 
     virtual bool CompleteComment(Token& token);
     virtual bool CompleteStringLiteral(Token& token);
+    virtual int_type EatWhitespace();
     int convert_unicode_to_code_point();
     bool handle_unescape_char(Token& token);
 
@@ -148,14 +159,16 @@ private:
     bool CompleteKeywordTrue(Token& token);
     bool CompleteKeywordFalse(Token& token);
     bool CompleteKeywordNull(Token& token);
-    std::unique_ptr<web::json::details::_Value> _ParseValue(typename JSON_Parser<CharType>::Token& first);
-    std::unique_ptr<web::json::details::_Value> _ParseObject(typename JSON_Parser<CharType>::Token& tkn);
-    std::unique_ptr<web::json::details::_Value> _ParseArray(typename JSON_Parser<CharType>::Token& tkn);
+    web::json::details::_Value_ptr _ParseValue(typename JSON_Parser<CharType>::Token& first);
+    web::json::details::_Value_ptr _ParseObject(typename JSON_Parser<CharType>::Token& tkn);
+    web::json::details::_Value_ptr _ParseArray(typename JSON_Parser<CharType>::Token& tkn);
+    const _Document_node* _ParseDocumentRoot(Token& tkn, _Document_arena& arena);
+    void _ParseDocumentValue(Token& tkn, _Document_arena& arena, _Document_node& node);
+    void _ParseDocumentObject(Token& tkn, _Document_arena& arena, _Document_node& node);
+    void _ParseDocumentArray(Token& tkn, _Document_arena& arena, _Document_node& node);
 
     JSON_Parser& operator=(const JSON_Parser&);
 
-    int_type EatWhitespace();
-
     void CreateToken(typename JSON_Parser<CharType>::Token& tk, typename Token::Kind kind, Location& start)
     {
         tk.kind = kind;
@@ -171,6 +184,11 @@ private:
         tk.string_val.clear();
     }
 
+    // Scratch stacks holding the children of the containers being parsed into a document. A container's children are
+    // copied into the arena in one piece once it is closed, so the arena never holds partially built containers.
+    std::vector<_Document_node> m_documentElements;
+    std::vector<_Document_field> m_documentFields;
+
 protected:
     size_t m_currentLine;
     size_t m_currentColumn;
@@ -223,6 +241,7 @@ protected:
 
     virtual bool CompleteComment(typename JSON_Parser<CharType>::Token& token);
     virtual bool CompleteStringLiteral(typename JSON_Parser<CharType>::Token& token);
+    virtual typename JSON_Parser<CharType>::int_type EatWhitespace();
 
 private:
     bool finish_parsing_string_with_unescape_char(typename JSON_Parser<CharType>::Token& token);
@@ -284,6 +303,91 @@ typename JSON_Parser<CharType>::int_type JSON_StringParser<CharType>::PeekCharac
     return *m_position;
 }
 
+namespace
+{
+#if defined(CPPREST_JSON_SSE2)
+inline int first_set_bit(int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, static_cast<unsigned long>(mask));
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(static_cast<unsigned int>(mask));
+#endif
+}
+#endif
+
+// Returns the first character in [first, last) that ends the plain run of a string literal: a quote, a backslash or a
+// control character. Returns last if there is none.
+template<typename CharType>
+const CharType* find_string_special(const CharType* first, const CharType* last)
+{
+    for (; first != last; ++first)
+    {
+        const CharType ch = *first;
+        if (ch == '"' || ch == '\\' || (ch >= CharType(0x0) && ch < CharType(0x20)))
+        {
+            break;
+        }
+    }
+    return first;
+}
+
+inline const char* find_string_special(const char* first, const char* last)
+{
+#if defined(CPPREST_JSON_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i maxControl = _mm_set1_epi8(0x1F);
+    while (last - first >= 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        // A byte is a control character when its unsigned minimum with 0x1F is the byte itself.
+        const __m128i delimiter = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+        const __m128i special = _mm_or_si128(delimiter, _mm_cmpeq_epi8(_mm_min_epu8(chunk, maxControl), chunk));
+        const int mask = _mm_movemask_epi8(special);
+        if (mask != 0)
+        {
+            return first + first_set_bit(mask);
+        }
+        first += 16;
+    }
+#endif
+    return find_string_special<char>(first, last);
+}
+
+// Returns the first character in [first, last) that is not a space. Indentation is mostly made of long runs of
+// spaces, so those are skipped a block at a time; the caller deals with any other character.
+template<typename CharType>
+const CharType* skip_spaces(const CharType* first, const CharType* last)
+{
+    while (first != last && *first == ' ')
+    {
+        ++first;
+    }
+    return first;
+}
+
+inline const char* skip_spaces(const char* first, const char* last)
+{
+#if defined(CPPREST_JSON_SSE2)
+    const __m128i space = _mm_set1_epi8(' ');
+    while (last - first >= 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, space)) & 0xFFFF;
+        if (mask != 0)
+        {
+            return first + first_set_bit(mask);
+        }
+        first += 16;
+    }
+#endif
+    return skip_spaces<char>(first, last);
+}
+} // namespace
+
 //
 // Consume whitespace characters and return the first non-space character or EOF
 //
@@ -300,6 +404,24 @@ typename JSON_Parser<CharType>::int_type JSON_Parser<CharType>::EatWhitespace()
     return ch;
 }
 
+template<typename CharType>
+typename JSON_Parser<CharType>::int_type JSON_StringParser<CharType>::EatWhitespace()
+{
+    // Same as the generic version, but runs of spaces don't go through NextCharacter() one at a time.
+    while (true)
+    {
+        auto spacesEnd = skip_spaces(m_position, m_endpos);
+        this->m_currentColumn += spacesEnd - m_position;
+        m_position = spacesEnd;
+
+        auto ch = JSON_StringParser<CharType>::NextCharacter();
+        if (ch == eof<CharType>() || !iswspace(static_cast<wint_t>(ch)))
+        {
+            return ch;
+        }
+    }
+}
+
 template<typename CharType>
 bool JSON_Parser<CharType>::CompleteKeywordTrue(Token& token)
 {
@@ -386,6 +508,115 @@ static int __attribute__((__unused__)) print_llu(char* ptr, size_t n, unsigned l
 static double __attribute__((__unused__)) anystod(const char* str) { return strtod(str, nullptr); }
 static double __attribute__((__unused__)) anystod(const wchar_t* str) { return wcstod(str, nullptr); }
 #endif
+
+// Collects the characters of a number literal that has to go through anystod(). Literals practically always fit in
+// the local buffer, so no allocation is made.
+template<typename CharType>
+class number_literal_buffer
+{
+public:
+    number_literal_buffer() : m_size(0) {}
+
+    void push_back(CharType ch)
+    {
+        if (m_size < m_local.size())
+        {
+            m_local[m_size] = ch;
+        }
+        else
+        {
+            if (m_size == m_local.size())
+            {
+                m_long.assign(m_local.data(), m_size);
+            }
+            m_long.push_back(ch);
+        }
+        ++m_size;
+    }
+
+    void append(const char* str)
+    {
+        for (; *str != '\0'; ++str)
+        {
+            push_back(static_cast<CharType>(*str));
+        }
+    }
+
+    const CharType* c_str()
+    {
+        push_back(CharType());
+        return m_size <= m_local.size() ? m_local.data() : m_long.c_str();
+    }
+
+private:
+    std::array<CharType, 64> m_local;
+    std::basic_string<CharType> m_long;
+    size_t m_size;
+};
+
+// A decimal significand and exponent accumulated while a number literal is read. When both are small enough, the
+// literal is converted exactly with a single multiplication or division (Clinger's fast path), without anystod().
+class fast_double
+{
+public:
+    explicit fast_double(uint64_t integer, bool exact)
+        : m_significand(integer), m_exponent(0), m_exponent_digits(0), m_exact(exact && integer <= max_significand)
+    {
+    }
+
+    void add_fraction_digit(int digit)
+    {
+        if (m_exact && m_significand <= (max_significand - digit) / 10)
+        {
+            m_significand = m_significand * 10 + digit;
+            --m_exponent;
+        }
+        else
+        {
+            m_exact = false;
+        }
+    }
+
+    void set_inexact() { m_exact = false; }
+
+    void add_exponent_digit(int digit)
+    {
+        // Anything past a few digits is far outside the fast path.
+        if (m_exponent_digits < 1000)
+        {
+            m_exponent_digits = m_exponent_digits * 10 + digit;
+        }
+    }
+
+    bool try_get(bool negative_exponent, double& result) const
+    {
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+        // Extended precision intermediates would round twice.
+        return false;
+#else
+        static const double powers_of_ten[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                               1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        const int exponent = m_exponent + (negative_exponent ? -m_exponent_digits : m_exponent_digits);
+        if (!m_exact || exponent < -22 || exponent > 22)
+        {
+            return false;
+        }
+
+        // Both operands are exact doubles, so the result is correctly rounded.
+        const double significand = static_cast<double>(m_significand);
+        result = exponent < 0 ? significand / powers_of_ten[-exponent] : significand * powers_of_ten[exponent];
+        return true;
+#endif
+    }
+
+private:
+    static const uint64_t max_significand = static_cast<uint64_t>(1) << 53;
+
+    uint64_t m_significand;
+    int m_exponent;
+    int m_exponent_digits;
+    bool m_exact;
+};
 } // namespace
 
 template<typename CharType>
@@ -444,21 +675,33 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token& token)
         return true;
     }
 
-    // Magic number 5 leaves room for decimal point, null terminator, etc (in most cases)
-    ::std::vector<CharType> buf(::std::numeric_limits<uint64_t>::digits10 + 5);
-    int count = print_llu(buf.data(), buf.size(), val64);
-    _ASSERTE(count >= 0);
-    _ASSERTE((size_t)count < buf.size());
-    // Resize to cut off the null terminator
-    buf.resize(count);
+    number_literal_buffer<CharType> buf;
+    {
+        char digits[std::numeric_limits<uint64_t>::digits10 + 2];
+        const int count = print_llu(digits, sizeof(digits), val64);
+        _ASSERTE(count > 0 && static_cast<size_t>(count) < sizeof(digits));
+        (void)count;
+        buf.append(digits);
+    }
 
+    fast_double fast(val64, complete);
     bool decimal = false;
+    bool negative_exponent = false;
 
     while (ch != eof<CharType>())
     {
         // Digit encountered?
         if (ch >= '0' && ch <= '9')
         {
+            // Only reachable for fraction digits, or for the digits of an integer part that overflowed.
+            if (decimal)
+            {
+                fast.add_fraction_digit(static_cast<int>(ch - '0'));
+            }
+            else
+            {
+                fast.set_inexact();
+            }
             buf.push_back(static_cast<CharType>(ch));
             NextCharacter();
             ch = PeekCharacter();
@@ -478,6 +721,7 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token& token)
             // Check that the following char is a digit
             if (ch < '0' || ch > '9') return false;
 
+            fast.add_fraction_digit(static_cast<int>(ch - '0'));
             buf.push_back(static_cast<CharType>(ch));
             NextCharacter();
             ch = PeekCharacter();
@@ -499,6 +743,7 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token& token)
             }
             else if (ch == '-')
             {
+                negative_exponent = true;
                 buf.push_back(static_cast<CharType>(ch));
                 NextCharacter();
                 ch = PeekCharacter();
@@ -507,6 +752,7 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token& token)
             // First number of the exponent
             if (ch >= '0' && ch <= '9')
             {
+                fast.add_exponent_digit(static_cast<int>(ch - '0'));
                 buf.push_back(static_cast<CharType>(ch));
                 NextCharacter();
                 ch = PeekCharacter();
@@ -517,6 +763,7 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token& token)
             // The rest of the exponent
             while (ch >= '0' && ch <= '9')
             {
+                fast.add_exponent_digit(static_cast<int>(ch - '0'));
                 buf.push_back(static_cast<CharType>(ch));
                 NextCharacter();
                 ch = PeekCharacter();
@@ -532,8 +779,10 @@ bool JSON_Parser<CharType>::CompleteNumberLiteral(CharType first, Token& token)
         }
     };
 
-    buf.push_back('\0');
-    token.double_val = anystod(buf.data());
+    if (!fast.try_get(negative_exponent, token.double_val))
+    {
+        token.double_val = anystod(buf.c_str());
+    }
     if (minus_sign)
     {
         token.double_val = -token.double_val;
@@ -804,10 +1053,15 @@ bool JSON_StringParser<CharType>::CompleteStringLiteral(typename JSON_Parser<Cha
     auto start = m_position;
     token.has_unescape_symbol = false;
 
-    auto ch = JSON_StringParser<CharType>::NextCharacter();
-
-    while (ch != '"')
+    while (true)
     {
+        // Plain characters can't be newlines, so skipping them only moves the column.
+        auto special = find_string_special(m_position, m_endpos);
+        this->m_currentColumn += special - m_position;
+        m_position = special;
+
+        auto ch = JSON_StringParser<CharType>::NextCharacter();
+        if (ch == '"') break;
         if (ch == eof<CharType>()) return false;
 
         if (ch == '\\')
@@ -825,12 +1079,11 @@ bool JSON_StringParser<CharType>::CompleteStringLiteral(typename JSON_Parser<Cha
             // Reset start position and continue.
             start = m_position;
         }
-        else if (ch >= CharType(0x0) && ch < CharType(0x20))
+        else
         {
+            // A control character.
             return false;
         }
-
-        ch = JSON_StringParser<CharType>::NextCharacter();
     }
 
     const size_t numChars = m_position - start - 1;
@@ -940,7 +1193,7 @@ try_again:
 }
 
 template<typename CharType>
-std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(
+web::json::details::_Value_ptr JSON_Parser<CharType>::_ParseObject(
     typename JSON_Parser<CharType>::Token& tkn)
 {
     auto obj = utility::details::make_unique<web::json::details::_Object>(g_keep_json_object_unsorted);
@@ -996,29 +1249,30 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(
 
 done:
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return web::json::details::_Value_ptr::make<web::json::details::_Null>();
 
     if (!g_keep_json_object_unsorted)
     {
         ::std::sort(elems.begin(), elems.end(), json::object::compare_pairs);
     }
+    obj->m_object.rebuild_index();
 
-    return std::unique_ptr<web::json::details::_Value>(obj.release());
+    return web::json::details::_Value_ptr(std::move(obj));
 
 error:
     if (!tkn.m_error)
     {
         SetErrorCode(tkn, json_error::malformed_object_literal);
     }
-    return utility::details::make_unique<web::json::details::_Null>();
+    return web::json::details::_Value_ptr::make<web::json::details::_Null>();
 }
 
 template<typename CharType>
-std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseArray(
+web::json::details::_Value_ptr JSON_Parser<CharType>::_ParseArray(
     typename JSON_Parser<CharType>::Token& tkn)
 {
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return web::json::details::_Value_ptr::make<web::json::details::_Null>();
 
     auto result = utility::details::make_unique<web::json::details::_Array>();
 
@@ -1028,37 +1282,37 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseArray(
         {
             // State 1: Looking for an expression.
             result->m_array.m_elements.emplace_back(ParseValue(tkn));
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+            if (tkn.m_error) return web::json::details::_Value_ptr::make<web::json::details::_Null>();
 
             // State 4: Looking for a comma or a closing bracket
             switch (tkn.kind)
             {
                 case JSON_Parser<CharType>::Token::TKN_Comma:
                     GetNextToken(tkn);
-                    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+                    if (tkn.m_error) return web::json::details::_Value_ptr::make<web::json::details::_Null>();
                     break;
                 case JSON_Parser<CharType>::Token::TKN_CloseBracket:
                     GetNextToken(tkn);
-                    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-                    return std::unique_ptr<web::json::details::_Value>(result.release());
+                    if (tkn.m_error) return web::json::details::_Value_ptr::make<web::json::details::_Null>();
+                    return web::json::details::_Value_ptr(std::move(result));
                 default:
                     SetErrorCode(tkn, json_error::malformed_array_literal);
-                    return utility::details::make_unique<web::json::details::_Null>();
+                    return web::json::details::_Value_ptr::make<web::json::details::_Null>();
             }
         }
     }
 
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return web::json::details::_Value_ptr::make<web::json::details::_Null>();
 
-    return std::unique_ptr<web::json::details::_Value>(result.release());
+    return web::json::details::_Value_ptr(std::move(result));
 }
 
 template<typename CharType>
-std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseValue(
+web::json::details::_Value_ptr JSON_Parser<CharType>::_ParseValue(
     typename JSON_Parser<CharType>::Token& tkn)
 {
-    typedef std::unique_ptr<web::json::details::_Value> Vptr;
+    typedef web::json::details::_Value_ptr Vptr;
     switch (tkn.kind)
     {
         case JSON_Parser<CharType>::Token::TKN_OpenBrace:
@@ -1071,52 +1325,331 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseValue(
         }
         case JSON_Parser<CharType>::Token::TKN_StringLiteral:
         {
-            Vptr value = utility::details::make_unique<web::json::details::_String>(std::move(tkn.string_val),
-                                                                                    tkn.has_unescape_symbol);
+            Vptr value = Vptr::make<web::json::details::_String>(std::move(tkn.string_val), tkn.has_unescape_symbol);
             GetNextToken(tkn);
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+            if (tkn.m_error) return web::json::details::_Value_ptr::make<web::json::details::_Null>();
             return value;
         }
         case JSON_Parser<CharType>::Token::TKN_IntegerLiteral:
         {
             Vptr value;
             if (tkn.signed_number)
-                value = utility::details::make_unique<web::json::details::_Number>(tkn.int64_val);
+                value = Vptr::make<web::json::details::_Number>(tkn.int64_val);
             else
-                value = utility::details::make_unique<web::json::details::_Number>(tkn.uint64_val);
+                value = Vptr::make<web::json::details::_Number>(tkn.uint64_val);
 
             GetNextToken(tkn);
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+            if (tkn.m_error) return web::json::details::_Value_ptr::make<web::json::details::_Null>();
             return value;
         }
         case JSON_Parser<CharType>::Token::TKN_NumberLiteral:
         {
-            Vptr value = utility::details::make_unique<web::json::details::_Number>(tkn.double_val);
+            Vptr value = Vptr::make<web::json::details::_Number>(tkn.double_val);
             GetNextToken(tkn);
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+            if (tkn.m_error) return web::json::details::_Value_ptr::make<web::json::details::_Null>();
             return value;
         }
         case JSON_Parser<CharType>::Token::TKN_BooleanLiteral:
         {
-            Vptr value = utility::details::make_unique<web::json::details::_Boolean>(tkn.boolean_val);
+            Vptr value = Vptr::make<web::json::details::_Boolean>(tkn.boolean_val);
             GetNextToken(tkn);
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+            if (tkn.m_error) return web::json::details::_Value_ptr::make<web::json::details::_Null>();
             return value;
         }
         case JSON_Parser<CharType>::Token::TKN_NullLiteral:
         {
             GetNextToken(tkn);
             // Returning a null value whether or not an error occurred.
-            return utility::details::make_unique<web::json::details::_Null>();
+            return web::json::details::_Value_ptr::make<web::json::details::_Null>();
         }
         default:
         {
             SetErrorCode(tkn, json_error::malformed_token);
-            return utility::details::make_unique<web::json::details::_Null>();
+            return web::json::details::_Value_ptr::make<web::json::details::_Null>();
         }
     }
 }
 
+namespace
+{
+void set_null(_Document_node& node)
+{
+    node.m_type = json::value::Null;
+    node.m_number_kind = 0;
+    node.m_sorted = false;
+    node.m_size = 0;
+    node.m_string = nullptr;
+}
+
+const utility::string_t& document_string(const utility::string_t& str) { return str; }
+
+template<typename String>
+utility::string_t document_string(const String& str)
+{
+    return utility::conversions::to_string_t(str);
+}
+
+const utility::char_t* copy_document_string(_Document_arena& arena, const utility::string_t& str)
+{
+    auto result = static_cast<utility::char_t*>(arena.allocate((str.size() + 1) * sizeof(utility::char_t)));
+    std::copy(str.begin(), str.end(), result);
+    result[str.size()] = utility::char_t();
+    return result;
+}
+
+template<typename T>
+const T* copy_document_children(_Document_arena& arena, std::vector<T>& stack, size_t first)
+{
+    const size_t count = stack.size() - first;
+    if (count == 0)
+    {
+        return nullptr;
+    }
+
+    auto result = static_cast<T*>(arena.allocate(count * sizeof(T)));
+    std::uninitialized_copy(stack.begin() + first, stack.end(), result);
+    stack.resize(first);
+    return result;
+}
+} // namespace
+
+template<typename CharType>
+void JSON_Parser<CharType>::_ParseDocumentObject(Token& tkn, _Document_arena& arena, _Document_node& node)
+{
+    const size_t first = m_documentFields.size();
+
+    GetNextToken(tkn);
+    if (tkn.m_error) goto error;
+
+    if (tkn.kind != Token::TKN_CloseBrace)
+    {
+        while (true)
+        {
+            // State 1: New field or end of object, looking for field name or closing brace
+            if (tkn.kind != Token::TKN_StringLiteral) goto error;
+
+            _Document_field field;
+            {
+                const utility::string_t& name = document_string(tkn.string_val);
+                field.m_name = copy_document_string(arena, name);
+                field.m_name_size = name.size();
+            }
+
+            GetNextToken(tkn);
+            if (tkn.m_error) goto error;
+
+            // State 2: Looking for a colon.
+            if (tkn.kind != Token::TKN_Colon) goto error;
+
+            GetNextToken(tkn);
+            if (tkn.m_error) goto error;
+
+            // State 3: Looking for an expression.
+            _ParseDocumentValue(tkn, arena, field.m_value);
+            if (tkn.m_error) goto error;
+            m_documentFields.push_back(field);
+
+            // State 4: Looking for a comma or a closing brace
+            switch (tkn.kind)
+            {
+                case Token::TKN_Comma:
+                    GetNextToken(tkn);
+                    if (tkn.m_error) goto error;
+                    break;
+                case Token::TKN_CloseBrace: goto done;
+                default: goto error;
+            }
+        }
+    }
+
+done:
+    GetNextToken(tkn);
+    if (tkn.m_error) goto error;
+
+    if (!g_keep_json_object_unsorted)
+    {
+        std::sort(m_documentFields.begin() + first,
+                  m_documentFields.end(),
+                  [](const _Document_field& left, const _Document_field& right) {
+                      return _Document_field::name_less(
+                          left.m_name, left.m_name_size, right.m_name, right.m_name_size);
+                  });
+    }
+
+    node.m_type = json::value::Object;
+    node.m_sorted = !g_keep_json_object_unsorted;
+    node.m_size = m_documentFields.size() - first;
+    node.m_fields = copy_document_children(arena, m_documentFields, first);
+    return;
+
+error:
+    if (!tkn.m_error)
+    {
+        SetErrorCode(tkn, json_error::malformed_object_literal);
+    }
+    m_documentFields.resize(first);
+}
+
+template<typename CharType>
+void JSON_Parser<CharType>::_ParseDocumentArray(Token& tkn, _Document_arena& arena, _Document_node& node)
+{
+    const size_t first = m_documentElements.size();
+
+    GetNextToken(tkn);
+    if (tkn.m_error) goto error;
+
+    if (tkn.kind != Token::TKN_CloseBracket)
+    {
+        while (true)
+        {
+            // State 1: Looking for an expression.
+            _Document_node element;
+            _ParseDocumentValue(tkn, arena, element);
+            if (tkn.m_error) goto error;
+            m_documentElements.push_back(element);
+
+            // State 4: Looking for a comma or a closing bracket
+            switch (tkn.kind)
+            {
+                case Token::TKN_Comma:
+                    GetNextToken(tkn);
+                    if (tkn.m_error) goto error;
+                    break;
+                case Token::TKN_CloseBracket: goto done;
+                default: SetErrorCode(tkn, json_error::malformed_array_literal); goto error;
+            }
+        }
+    }
+
+done:
+    GetNextToken(tkn);
+    if (tkn.m_error) goto error;
+
+    node.m_type = json::value::Array;
+    node.m_size = m_documentElements.size() - first;
+    node.m_elements = copy_document_children(arena, m_documentElements, first);
+    return;
+
+error:
+    m_documentElements.resize(first);
+}
+
+template<typename CharType>
+void JSON_Parser<CharType>::_ParseDocumentValue(Token& tkn, _Document_arena& arena, _Document_node& node)
+{
+    set_null(node);
+    switch (tkn.kind)
+    {
+        case Token::TKN_OpenBrace: _ParseDocumentObject(tkn, arena, node); break;
+        case Token::TKN_OpenBracket: _ParseDocumentArray(tkn, arena, node); break;
+        case Token::TKN_StringLiteral:
+        {
+            const utility::string_t& str = document_string(tkn.string_val);
+            node.m_type = json::value::String;
+            node.m_size = str.size();
+            node.m_string = copy_document_string(arena, str);
+            GetNextToken(tkn);
+            break;
+        }
+        case Token::TKN_IntegerLiteral:
+            node.m_type = json::value::Number;
+            if (tkn.signed_number)
+            {
+                node.m_number_kind = _Document_node::signed_number;
+                node.m_signed = tkn.int64_val;
+            }
+            else
+            {
+                node.m_number_kind = _Document_node::unsigned_number;
+                node.m_unsigned = tkn.uint64_val;
+            }
+            GetNextToken(tkn);
+            break;
+        case Token::TKN_NumberLiteral:
+            node.m_type = json::value::Number;
+            node.m_number_kind = _Document_node::double_number;
+            node.m_double = tkn.double_val;
+            GetNextToken(tkn);
+            break;
+        case Token::TKN_BooleanLiteral:
+            node.m_type = json::value::Boolean;
+            node.m_boolean = tkn.boolean_val;
+            GetNextToken(tkn);
+            break;
+        case Token::TKN_NullLiteral: GetNextToken(tkn); break;
+        default: SetErrorCode(tkn, json_error::malformed_token); break;
+    }
+
+    if (tkn.m_error)
+    {
+        set_null(node);
+    }
+}
+
+// Parses a whole document into `arena`. On failure, returns null with the error left in `tkn`.
+template<typename CharType>
+const _Document_node* JSON_Parser<CharType>::_ParseDocumentRoot(Token& tkn, _Document_arena& arena)
+{
+#ifndef _WIN32
+    utility::details::scoped_c_thread_locale locale;
+#endif
+
+    GetNextToken(tkn);
+    if (tkn.m_error)
+    {
+        return nullptr;
+    }
+
+    auto root = static_cast<_Document_node*>(arena.allocate(sizeof(_Document_node)));
+    _ParseDocumentValue(tkn, arena, *root);
+    if (!tkn.m_error && tkn.kind != Token::TKN_EOF)
+    {
+        SetErrorCode(tkn, json_error::left_over_character_in_stream);
+    }
+    return tkn.m_error ? nullptr : root;
+}
+
+template<typename CharType>
+web::json::document JSON_Parser<CharType>::ParseDocument()
+{
+    web::json::document result;
+    result.m_arena = utility::details::make_unique<_Document_arena>();
+
+    Token tkn;
+    auto root = _ParseDocumentRoot(tkn, *result.m_arena);
+    if (root == nullptr)
+    {
+        if (tkn.m_error.value() == json_error::left_over_character_in_stream)
+        {
+            CreateException(tkn, _XPLATSTR("Left-over characters in stream after parsing a JSON value"));
+        }
+        CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
+    }
+
+    result.m_root = root;
+    return result;
+}
+
+template<typename CharType>
+web::json::document JSON_Parser<CharType>::ParseDocument(std::error_code& error)
+{
+    web::json::document result;
+    result.m_arena = utility::details::make_unique<_Document_arena>();
+
+    Token tkn;
+    auto root = _ParseDocumentRoot(tkn, *result.m_arena);
+    error = std::move(tkn.m_error);
+    if (root == nullptr)
+    {
+        // Leave the null root and drop whatever was allocated before the error.
+        result.m_arena.reset();
+        return result;
+    }
+
+    result.m_root = root;
+    return result;
+}
+
 } // namespace details
 } // namespace json
 } // namespace web
@@ -1247,3 +1780,361 @@ web::json::value web::json::value::parse(std::istream& stream, std::error_code&
     return _parse_stream(stream, error);
 }
 #endif
+
+web::json::document web::json::document::parse(const utility::string_t& str)
+{
+    return web::json::details::JSON_StringParser<utility::char_t>(str).ParseDocument();
+}
+
+web::json::document web::json::document::parse(const utility::string_t& str, std::error_code& error)
+{
+    return web::json::details::JSON_StringParser<utility::char_t>(str).ParseDocument(error);
+}
+
+web::json::document web::json::document::parse(utility::istream_t& stream)
+{
+    return web::json::details::JSON_StreamParser<utility::char_t>(stream).ParseDocument();
+}
+
+web::json::document web::json::document::parse(utility::istream_t& stream, std::error_code& error)
+{
+    return web::json::details::JSON_StreamParser<utility::char_t>(stream).ParseDocument(error);
+}
+
+#ifdef _WIN32
+web::json::document web::json::document::parse(const std::string& str)
+{
+    return web::json::details::JSON_StringParser<char>(str).ParseDocument();
+}
+
+web::json::document web::json::document::parse(const std::string& str, std::error_code& error)
+{
+    return web::json::details::JSON_StringParser<char>(str).ParseDocument(error);
+}
+#endif
+
+namespace web
+{
+namespace json
+{
+namespace details
+{
+// Tokenizes input that arrives a chunk at a time with the regular JSON_Parser tokenizer. A token that runs into the end
+// of the buffered input is rolled back and read again once more input has arrived, so every token is produced from
+// complete input and carries its position in the whole stream.
+class JSON_ChunkParser : public JSON_Parser<char>
+{
+public:
+    JSON_ChunkParser() : m_position(0), m_starved(false), m_finished(false) {}
+
+    void Append(const char* first, const char* last)
+    {
+        m_input.erase(0, m_position);
+        m_position = 0;
+        m_input.append(first, last);
+    }
+
+    // Called at the end of the input, after which running out of input yields TKN_EOF.
+    void Finish() { m_finished = true; }
+
+    // Reads the next token, returning false if the buffered input ends before the token does.
+    bool TryGetNextToken(Token& token)
+    {
+        const size_t position = m_position;
+        const size_t line = m_currentLine;
+        const size_t column = m_currentColumn;
+        const size_t depth = m_currentParsingDepth;
+
+        m_starved = false;
+        token.m_error.clear();
+        GetNextToken(token);
+        if (!m_starved)
+        {
+            return true;
+        }
+
+        m_position = position;
+        m_currentLine = line;
+        m_currentColumn = column;
+        m_currentParsingDepth = depth;
+        return false;
+    }
+
+protected:
+    virtual int_type NextCharacter()
+    {
+        if (m_position == m_input.size())
+        {
+            m_starved = !m_finished;
+            return eof<char>();
+        }
+
+        const int_type ch = std::char_traits<char>::to_int_type(m_input[m_position++]);
+        if (ch == '\n')
+        {
+            m_currentLine += 1;
+            m_currentColumn = 0;
+        }
+        else
+        {
+            m_currentColumn += 1;
+        }
+
+        return ch;
+    }
+
+    virtual int_type PeekCharacter()
+    {
+        if (m_position == m_input.size())
+        {
+            m_starved = !m_finished;
+            return eof<char>();
+        }
+
+        return std::char_traits<char>::to_int_type(m_input[m_position]);
+    }
+
+private:
+    std::string m_input;
+    size_t m_position;
+    bool m_starved;
+    bool m_finished;
+};
+
+// Parses one JSON value pushed to it a chunk at a time, reporting each event as soon as the tokens it is made of are
+// complete. Containers are tracked on an explicit stack, so that parsing can stop at the end of any chunk and resume
+// with the next one.
+class JSON_EventParser
+{
+public:
+    typedef JSON_Parser<char>::Token Token;
+
+    JSON_EventParser(reader_handler& handler) : m_handler(handler), m_state(expect_value) {}
+
+    void Push(const char* first, const char* last)
+    {
+        m_tokenizer.Append(first, last);
+        Run();
+    }
+
+    // Called at the end of the input.
+    void Finish()
+    {
+        m_tokenizer.Finish();
+        Run();
+    }
+
+private:
+    enum state
+    {
+        expect_value,
+        expect_value_or_end,
+        expect_key,
+        expect_key_or_end,
+        expect_colon,
+        expect_comma_or_end,
+        done
+    };
+
+    void Run()
+    {
+#ifndef _WIN32
+        utility::details::scoped_c_thread_locale locale;
+#endif
+        while (m_tokenizer.TryGetNextToken(m_token))
+        {
+            if (m_token.m_error)
+            {
+                CreateException(m_token, utility::conversions::to_string_t(m_token.m_error.message()));
+            }
+            if (m_token.kind == Token::TKN_EOF)
+            {
+                if (m_state != done)
+                {
+                    Fail(m_stack.empty() ? json_error::unexpected_token : json_error::mismatched_brances);
+                }
+                return;
+            }
+            Consume();
+        }
+    }
+
+    void Consume()
+    {
+        switch (m_token.kind)
+        {
+            case Token::TKN_OpenBrace:
+                StartValue();
+                m_handler.start_object();
+                m_stack.push_back(true);
+                m_state = expect_key_or_end;
+                break;
+            case Token::TKN_OpenBracket:
+                StartValue();
+                m_handler.start_array();
+                m_stack.push_back(false);
+                m_state = expect_value_or_end;
+                break;
+            case Token::TKN_CloseBrace:
+                if (m_stack.empty() || !m_stack.back() ||
+                    (m_state != expect_key_or_end && m_state != expect_comma_or_end))
+                {
+                    Fail(json_error::malformed_object_literal);
+                }
+                m_stack.pop_back();
+                m_handler.end_object();
+                CompleteValue();
+                break;
+            case Token::TKN_CloseBracket:
+                if (m_stack.empty() || m_stack.back() ||
+                    (m_state != expect_value_or_end && m_state != expect_comma_or_end))
+                {
+                    Fail(json_error::malformed_array_literal);
+                }
+                m_stack.pop_back();
+                m_handler.end_array();
+                CompleteValue();
+                break;
+            case Token::TKN_Colon:
+                if (m_state != expect_colon)
+                {
+                    Fail(json_error::malformed_object_literal);
+                }
+                m_state = expect_value;
+                break;
+            case Token::TKN_Comma:
+                if (m_state != expect_comma_or_end)
+                {
+                    Fail(m_state == done ? json_error::left_over_character_in_stream : json_error::unexpected_token);
+                }
+                m_state = m_stack.back() ? expect_key : expect_value;
+                break;
+            case Token::TKN_StringLiteral:
+                if (m_state == expect_key || m_state == expect_key_or_end)
+                {
+                    m_handler.key(utility::conversions::to_string_t(std::move(m_token.string_val)));
+                    m_state = expect_colon;
+                    break;
+                }
+                Value(json::value(utility::conversions::to_string_t(std::move(m_token.string_val)),
+                                  m_token.has_unescape_symbol));
+                break;
+            case Token::TKN_IntegerLiteral:
+                Value(m_token.signed_number ? json::value::number(m_token.int64_val)
+                                            : json::value::number(m_token.uint64_val));
+                break;
+            case Token::TKN_NumberLiteral: Value(json::value::number(m_token.double_val)); break;
+            case Token::TKN_BooleanLiteral: Value(json::value::boolean(m_token.boolean_val)); break;
+            case Token::TKN_NullLiteral: Value(json::value::null()); break;
+            default: Fail(json_error::malformed_token); break;
+        }
+    }
+
+    void Value(const json::value& value)
+    {
+        StartValue();
+        m_handler.value(value);
+        CompleteValue();
+    }
+
+    // Checks that a value may start at the current token.
+    void StartValue()
+    {
+        if (m_state != expect_value && m_state != expect_value_or_end)
+        {
+            Fail(m_state == done ? json_error::left_over_character_in_stream
+                                 : (m_state == expect_key || m_state == expect_key_or_end
+                                        ? json_error::malformed_object_literal
+                                        : json_error::unexpected_token));
+        }
+    }
+
+    void CompleteValue() { m_state = m_stack.empty() ? done : expect_comma_or_end; }
+
+    void Fail(json_error error)
+    {
+        SetErrorCode(m_token, error);
+        CreateException(m_token, utility::conversions::to_string_t(m_token.m_error.message()));
+    }
+
+    reader_handler& m_handler;
+    state m_state;
+
+    // Whether each open container is an object rather than an array, innermost last.
+    std::vector<bool> m_stack;
+
+    JSON_ChunkParser m_tokenizer;
+    Token m_token;
+};
+
+// Reads a stream through chained continuations, pushing each chunk to a JSON_EventParser, so that no thread is held
+// while waiting for input.
+class JSON_AsyncEventReader : public std::enable_shared_from_this<JSON_AsyncEventReader>
+{
+public:
+    JSON_AsyncEventReader(const concurrency::streams::streambuf<uint8_t>& streambuf,
+                          const std::shared_ptr<reader_handler>& handler)
+        : m_streambuf(streambuf), m_handler(handler), m_parser(*handler)
+    {
+    }
+
+    pplx::task<void> Start()
+    {
+        ReadNext();
+        return pplx::create_task(m_done);
+    }
+
+private:
+    void ReadNext()
+    {
+        auto self = shared_from_this();
+        try
+        {
+            m_streambuf.getn(m_chunk.data(), m_chunk.size()).then([self](pplx::task<size_t> read) {
+                try
+                {
+                    const size_t size = read.get();
+                    if (size == 0)
+                    {
+                        self->m_parser.Finish();
+                        self->m_done.set();
+                        return;
+                    }
+
+                    const char* first = reinterpret_cast<const char*>(self->m_chunk.data());
+                    self->m_parser.Push(first, first + size);
+                }
+                catch (...)
+                {
+                    self->m_done.set_exception(std::current_exception());
+                    return;
+                }
+                self->ReadNext();
+            });
+        }
+        catch (...)
+        {
+            m_done.set_exception(std::current_exception());
+        }
+    }
+
+    concurrency::streams::streambuf<uint8_t> m_streambuf;
+    std::shared_ptr<reader_handler> m_handler;
+    JSON_EventParser m_parser;
+    std::array<uint8_t, 4096> m_chunk;
+    pplx::task_completion_event<void> m_done;
+};
+} // namespace details
+} // namespace json
+} // namespace web
+
+pplx::task<void> web::json::parse_events(concurrency::streams::istream input,
+                                         std::shared_ptr<web::json::reader_handler> handler)
+{
+    if (!input.is_valid() || !handler)
+    {
+        throw std::invalid_argument("parse_events requires a valid stream and handler");
+    }
+
+    return std::make_shared<web::json::details::JSON_AsyncEventReader>(input.streambuf(), handler)->Start();
+}
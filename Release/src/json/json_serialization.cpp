@@ -13,6 +13,9 @@
 
 #include "stdafx.h"
 
+#include "cpprest/json_writer.h"
+#include <cmath>
+#include <cstring>
 #include <stdio.h>
 
 #ifndef _WIN32
@@ -134,18 +137,343 @@ void web::json::details::_String::format(std::basic_string<char>& str) const
 {
     str.push_back('"');
 
+    // Short strings are formatted from their inline characters unless as_string() has already materialized them.
+    utility::string_t short_value;
+    const utility::string_t* value = m_long.load(std::memory_order_acquire);
+    if (value == nullptr)
+    {
+        short_value.assign(m_short, m_short_size);
+        value = &short_value;
+    }
+
     if (m_has_escape_char)
     {
-        append_escape_string(str, utility::conversions::to_utf8string(m_string));
+        append_escape_string(str, utility::conversions::to_utf8string(*value));
     }
     else
     {
-        str.append(utility::conversions::to_utf8string(m_string));
+        str.append(utility::conversions::to_utf8string(*value));
     }
 
     str.push_back('"');
 }
 
+// Shortest round-trip formatting of doubles, using the Grisu2 algorithm (Florian Loitsch, "Printing Floating-Point
+// Numbers Quickly and Accurately with Integers"). The output always reads back as the same double, and is the
+// shortest such representation for all but a tiny fraction of inputs.
+namespace
+{
+struct diy_fp
+{
+    diy_fp(uint64_t significand, int exponent) : f(significand), e(exponent) {}
+
+    explicit diy_fp(double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        const int biasedExponent = static_cast<int>((bits >> 52) & 0x7FF);
+        const uint64_t significand = bits & ((static_cast<uint64_t>(1) << 52) - 1);
+        if (biasedExponent != 0)
+        {
+            f = significand + hidden_bit;
+            e = biasedExponent - 1075;
+        }
+        else
+        {
+            f = significand;
+            e = -1074;
+        }
+    }
+
+    diy_fp operator-(const diy_fp& rhs) const { return diy_fp(f - rhs.f, e); }
+
+    // The upper 64 bits of the 128 bit product, rounded.
+    diy_fp operator*(const diy_fp& rhs) const
+    {
+        const uint64_t mask32 = 0xFFFFFFFF;
+        const uint64_t a = f >> 32, b = f & mask32, c = rhs.f >> 32, d = rhs.f & mask32;
+        const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+        uint64_t middle = (bd >> 32) + (ad & mask32) + (bc & mask32);
+        middle += static_cast<uint64_t>(1) << 31;
+        return diy_fp(ac + (ad >> 32) + (bc >> 32) + (middle >> 32), e + rhs.e + 64);
+    }
+
+    diy_fp normalize() const
+    {
+        diy_fp result = *this;
+        while ((result.f & hidden_bit) == 0)
+        {
+            result.f <<= 1;
+            result.e--;
+        }
+        result.f <<= 11;
+        result.e -= 11;
+        return result;
+    }
+
+    // The boundaries halfway to the neighbouring doubles, normalized to a common exponent.
+    void normalized_boundaries(diy_fp& minus, diy_fp& plus) const
+    {
+        diy_fp upper((f << 1) + 1, e - 1);
+        while ((upper.f & (hidden_bit << 1)) == 0)
+        {
+            upper.f <<= 1;
+            upper.e--;
+        }
+        upper.f <<= 10;
+        upper.e -= 10;
+
+        diy_fp lower = (f == hidden_bit) ? diy_fp((f << 2) - 1, e - 2) : diy_fp((f << 1) - 1, e - 1);
+        lower.f <<= lower.e - upper.e;
+        lower.e = upper.e;
+
+        minus = lower;
+        plus = upper;
+    }
+
+    static const uint64_t hidden_bit = static_cast<uint64_t>(1) << 52;
+
+    uint64_t f;
+    int e;
+};
+
+// Normalized powers of ten 10^k for k = -348, -340, ..., 340, as significand and binary exponent.
+const uint64_t cached_powers_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL,
+    0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL,
+    0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL, 0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL, 0xdbac6c247d62a584ULL,
+    0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL,
+    0x8a08f0f8bf0f156bULL, 0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL, 0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL,
+    0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL,
+    0xc45d1df942711d9aULL, 0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL,
+    0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL,
+    0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL, 0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL, 0x9e19db92b4e31ba9ULL,
+    0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL};
+
+const int16_t cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927, -901, -874, -847, -821, -794,
+    -768, -741, -715, -688, -661, -635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30, 56, 83, 109, 136, 162, 189, 216, 242, 269, 295,
+    322, 348, 375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853, 880, 907,
+    933, 960, 986, 1013, 1039, 1066};
+
+const uint64_t powers_of_ten[] = {1ULL,
+                                  10ULL,
+                                  100ULL,
+                                  1000ULL,
+                                  10000ULL,
+                                  100000ULL,
+                                  1000000ULL,
+                                  10000000ULL,
+                                  100000000ULL,
+                                  1000000000ULL,
+                                  10000000000ULL,
+                                  100000000000ULL,
+                                  1000000000000ULL,
+                                  10000000000000ULL,
+                                  100000000000000ULL,
+                                  1000000000000000ULL,
+                                  10000000000000000ULL,
+                                  100000000000000000ULL,
+                                  1000000000000000000ULL,
+                                  10000000000000000000ULL};
+
+// Picks a cached power c_mk such that the binary exponent of a number with exponent e times c_mk lands in [-60, -32].
+diy_fp cached_power(int e, int& k)
+{
+    const double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = static_cast<int>(dk);
+    if (dk - ik > 0.0)
+    {
+        ik++;
+    }
+
+    const size_t index = static_cast<size_t>((ik >> 3) + 1);
+    k = -(-348 + static_cast<int>(index << 3));
+    return diy_fp(cached_powers_f[index], cached_powers_e[index]);
+}
+
+int count_decimal_digits(uint32_t n)
+{
+    int digits = 1;
+    while (n >= 10)
+    {
+        n /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+void grisu_round(char* buffer, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t distance)
+{
+    while (rest < distance && delta - rest >= tenKappa &&
+           (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance))
+    {
+        buffer[length - 1]--;
+        rest += tenKappa;
+    }
+}
+
+void digit_gen(const diy_fp& w, const diy_fp& upper, uint64_t delta, char* buffer, int& length, int& k)
+{
+    const diy_fp one(static_cast<uint64_t>(1) << -upper.e, upper.e);
+    const diy_fp distance = upper - w;
+    uint32_t integral = static_cast<uint32_t>(upper.f >> -one.e);
+    uint64_t fractional = upper.f & (one.f - 1);
+    int kappa = count_decimal_digits(integral);
+    length = 0;
+
+    while (kappa > 0)
+    {
+        const uint32_t divisor = static_cast<uint32_t>(powers_of_ten[kappa - 1]);
+        const uint32_t digit = integral / divisor;
+        integral %= divisor;
+        if (digit != 0 || length != 0)
+        {
+            buffer[length++] = static_cast<char>('0' + digit);
+        }
+        kappa--;
+
+        const uint64_t rest = (static_cast<uint64_t>(integral) << -one.e) + fractional;
+        if (rest <= delta)
+        {
+            k += kappa;
+            grisu_round(buffer, length, delta, rest, powers_of_ten[kappa] << -one.e, distance.f);
+            return;
+        }
+    }
+
+    while (true)
+    {
+        fractional *= 10;
+        delta *= 10;
+        const char digit = static_cast<char>(fractional >> -one.e);
+        if (digit != 0 || length != 0)
+        {
+            buffer[length++] = static_cast<char>('0' + digit);
+        }
+        fractional &= one.f - 1;
+        kappa--;
+        if (fractional < delta)
+        {
+            k += kappa;
+            const int index = -kappa;
+            grisu_round(buffer, length, delta, fractional, one.f, index < 20 ? distance.f * powers_of_ten[index] : 0);
+            return;
+        }
+    }
+}
+
+// Writes the digits of a positive, finite double into buffer; the value is digits * 10^k.
+void grisu2(double value, char* buffer, int& length, int& k)
+{
+    const diy_fp v(value);
+    diy_fp minus(0, 0), plus(0, 0);
+    v.normalized_boundaries(minus, plus);
+
+    const diy_fp cached = cached_power(plus.e, k);
+    const diy_fp w = v.normalize() * cached;
+    diy_fp upper = plus * cached;
+    diy_fp lower = minus * cached;
+    lower.f++;
+    upper.f--;
+    digit_gen(w, upper, upper.f - lower.f, buffer, length, k);
+}
+
+// Formats a double the way "%.17g" lays it out, but with the shortest digits that round-trip. The buffer must hold at
+// least 32 characters; returns the number of characters written, without a null terminator.
+int format_double(double value, char* buffer)
+{
+    if (!(value == value) || value - value != 0.0)
+    {
+        // NaN and infinities are not valid JSON; keep printing them as the C library does.
+        return snprintf(buffer, 32, "%g", value);
+    }
+
+    char* out = buffer;
+    if (std::signbit(value))
+    {
+        *out++ = '-';
+        value = -value;
+    }
+
+    if (value == 0.0)
+    {
+        *out++ = '0';
+        return static_cast<int>(out - buffer);
+    }
+
+    char digits[20];
+    int length;
+    int k;
+    grisu2(value, digits, length, k);
+    while (length > 1 && digits[length - 1] == '0')
+    {
+        length--;
+        k++;
+    }
+
+    // Decimal exponent of the first digit.
+    const int exponent = length + k - 1;
+    if (exponent >= -4 && exponent < std::numeric_limits<double>::digits10 + 2)
+    {
+        if (k >= 0)
+        {
+            memcpy(out, digits, length);
+            out += length;
+            memset(out, '0', k);
+            out += k;
+        }
+        else if (exponent >= 0)
+        {
+            memcpy(out, digits, exponent + 1);
+            out += exponent + 1;
+            *out++ = '.';
+            memcpy(out, digits + exponent + 1, length - exponent - 1);
+            out += length - exponent - 1;
+        }
+        else
+        {
+            *out++ = '0';
+            *out++ = '.';
+            memset(out, '0', -exponent - 1);
+            out += -exponent - 1;
+            memcpy(out, digits, length);
+            out += length;
+        }
+    }
+    else
+    {
+        *out++ = digits[0];
+        if (length > 1)
+        {
+            *out++ = '.';
+            memcpy(out, digits + 1, length - 1);
+            out += length - 1;
+        }
+        *out++ = 'e';
+        *out++ = exponent < 0 ? '-' : '+';
+        const int absExponent = exponent < 0 ? -exponent : exponent;
+        if (absExponent >= 100)
+        {
+            *out++ = static_cast<char>('0' + absExponent / 100);
+        }
+        *out++ = static_cast<char>('0' + absExponent / 10 % 10);
+        *out++ = static_cast<char>('0' + absExponent % 10);
+    }
+
+    return static_cast<int>(out - buffer);
+}
+} // namespace
+
 void web::json::details::_Number::format(std::basic_string<char>& stream) const
 {
     if (m_number.m_type != number::type::double_type)
@@ -173,22 +501,8 @@ void web::json::details::_Number::format(std::basic_string<char>& stream) const
     }
     else
     {
-        // #digits + 2 to avoid loss + 1 for the sign + 1 for decimal point + 5 for exponent (e+xxx) + 1 for null
-        // terminator
-        const size_t tempSize = std::numeric_limits<double>::digits10 + 10;
-        char tempBuffer[tempSize];
-#ifdef _WIN32
-        const auto numChars = _sprintf_s_l(tempBuffer,
-                                           tempSize,
-                                           "%.*g",
-                                           utility::details::scoped_c_thread_locale::c_locale(),
-                                           std::numeric_limits<double>::digits10 + 2,
-                                           m_number.m_value);
-#else
-        const auto numChars =
-            snprintf(tempBuffer, tempSize, "%.*g", std::numeric_limits<double>::digits10 + 2, m_number.m_value);
-#endif
-        stream.append(tempBuffer, numChars);
+        char tempBuffer[32];
+        stream.append(tempBuffer, format_double(m_number.m_value, tempBuffer));
     }
 }
 
@@ -198,13 +512,21 @@ void web::json::details::_String::format(std::basic_string<wchar_t>& str) const
 {
     str.push_back(L'"');
 
+    utility::string_t short_value;
+    const utility::string_t* value = m_long.load(std::memory_order_acquire);
+    if (value == nullptr)
+    {
+        short_value.assign(m_short, m_short_size);
+        value = &short_value;
+    }
+
     if (m_has_escape_char)
     {
-        append_escape_string(str, m_string);
+        append_escape_string(str, *value);
     }
     else
     {
-        str.append(m_string);
+        str.append(*value);
     }
 
     str.push_back(L'"');
@@ -227,23 +549,29 @@ void web::json::details::_Number::format(std::basic_string<wchar_t>& stream) con
     }
     else
     {
-        // #digits + 2 to avoid loss + 1 for the sign + 1 for decimal point + 5 for exponent (e+xxx) + 1 for null
-        // terminator
-        const size_t tempSize = std::numeric_limits<double>::digits10 + 10;
-        wchar_t tempBuffer[tempSize];
-        const int numChars = _swprintf_s_l(tempBuffer,
-                                           tempSize,
-                                           L"%.*g",
-                                           utility::details::scoped_c_thread_locale::c_locale(),
-                                           std::numeric_limits<double>::digits10 + 2,
-                                           m_number.m_value);
-        stream.append(tempBuffer, numChars);
+        char tempBuffer[32];
+        const int numChars = format_double(m_number.m_value, tempBuffer);
+        stream.append(tempBuffer, tempBuffer + numChars);
     }
 }
 
 #endif
 
-const utility::string_t& web::json::details::_String::as_string() const { return m_string; }
+const utility::string_t& web::json::details::_String::as_string() const
+{
+    utility::string_t* value = m_long.load(std::memory_order_acquire);
+    if (value == nullptr)
+    {
+        // The first as_string() on a short string copies it to the heap; concurrent callers agree on one copy.
+        std::unique_ptr<utility::string_t> created(new utility::string_t(m_short, m_short_size));
+        if (m_long.compare_exchange_strong(value, created.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            value = created.release();
+        }
+    }
+
+    return *value;
+}
 
 const utility::string_t& web::json::value::as_string() const { return m_value->as_string(); }
 
@@ -254,3 +582,227 @@ utility::string_t json::value::serialize() const
 #endif
     return m_value->to_string();
 }
+
+web::json::writer::writer(concurrency::streams::streambuf<uint8_t> buffer, size_t chunk_size)
+    : m_buffer(std::move(buffer))
+    , m_chunk_size(chunk_size == 0 ? 1 : chunk_size)
+    , m_complete(false)
+    , m_pending(pplx::task_from_result())
+{
+    if (!m_buffer || !m_buffer.can_write())
+    {
+        throw std::invalid_argument("json::writer requires a writable stream buffer");
+    }
+    m_chunk.reserve(m_chunk_size);
+}
+
+web::json::writer::~writer() {}
+
+void web::json::writer::start_value()
+{
+    if (m_containers.empty())
+    {
+        if (m_complete)
+        {
+            throw json_exception("json::writer can only write a single top-level value");
+        }
+        return;
+    }
+
+    switch (m_containers.back())
+    {
+        case object_first:
+        case object_next: throw json_exception("json::writer expected a key");
+        case object_value: m_containers.back() = object_next; break;
+        case array_first: m_containers.back() = array_next; break;
+        case array_next: m_chunk.push_back(','); break;
+    }
+}
+
+void web::json::writer::end_value()
+{
+    if (m_containers.empty())
+    {
+        m_complete = true;
+    }
+    spill();
+}
+
+void web::json::writer::begin_object()
+{
+    start_value();
+    m_chunk.push_back('{');
+    m_containers.push_back(object_first);
+}
+
+void web::json::writer::end_object()
+{
+    if (m_containers.empty() || (m_containers.back() != object_first && m_containers.back() != object_next))
+    {
+        throw json_exception("json::writer has no object to end");
+    }
+    m_containers.pop_back();
+    m_chunk.push_back('}');
+    end_value();
+}
+
+void web::json::writer::begin_array()
+{
+    start_value();
+    m_chunk.push_back('[');
+    m_containers.push_back(array_first);
+}
+
+void web::json::writer::end_array()
+{
+    if (m_containers.empty() || (m_containers.back() != array_first && m_containers.back() != array_next))
+    {
+        throw json_exception("json::writer has no array to end");
+    }
+    m_containers.pop_back();
+    m_chunk.push_back(']');
+    end_value();
+}
+
+void web::json::writer::key(const utility::string_t& name)
+{
+    if (m_containers.empty() || (m_containers.back() != object_first && m_containers.back() != object_next))
+    {
+        throw json_exception("json::writer can only write a key where an object expects one");
+    }
+
+    if (m_containers.back() == object_next)
+    {
+        m_chunk.push_back(',');
+    }
+    details::format_string(name, m_chunk);
+    m_chunk.push_back(':');
+    m_containers.back() = object_value;
+    spill();
+}
+
+void web::json::writer::value(const json::value& value)
+{
+#ifndef _WIN32
+    utility::details::scoped_c_thread_locale locale;
+#endif
+
+    start_value();
+    write_value(value);
+    end_value();
+}
+
+void web::json::writer::write_value(const json::value& value)
+{
+    switch (value.type())
+    {
+        case json::value::Object:
+        {
+            m_chunk.push_back('{');
+            bool first = true;
+            for (const auto& field : value.as_object())
+            {
+                if (!first)
+                {
+                    m_chunk.push_back(',');
+                }
+                first = false;
+                details::format_string(field.first, m_chunk);
+                m_chunk.push_back(':');
+                write_value(field.second);
+            }
+            m_chunk.push_back('}');
+            break;
+        }
+        case json::value::Array:
+        {
+            m_chunk.push_back('[');
+            bool first = true;
+            for (const auto& element : value.as_array())
+            {
+                if (!first)
+                {
+                    m_chunk.push_back(',');
+                }
+                first = false;
+                write_value(element);
+            }
+            m_chunk.push_back(']');
+            break;
+        }
+        default: value.format(m_chunk); break;
+    }
+    spill();
+}
+
+namespace
+{
+// Writes size bytes of chunk, starting at offset; the chunk is kept alive until the stream buffer is done with them.
+pplx::task<void> write_chunk(const pplx::task<void>& previous,
+                             const concurrency::streams::streambuf<uint8_t>& buffer,
+                             const std::shared_ptr<std::string>& chunk,
+                             size_t offset,
+                             size_t size)
+{
+    auto write = [buffer, chunk, offset, size]() {
+        auto target = buffer;
+        return target.putn_nocopy(reinterpret_cast<const uint8_t*>(chunk->data() + offset), size)
+            .then(
+                [chunk, size](size_t written) {
+                    if (written != size)
+                    {
+                        throw std::runtime_error("json::writer could not write to the stream buffer");
+                    }
+                },
+                pplx::task_continuation_context::use_synchronous_execution());
+    };
+
+    // Usually the previous write is done by now, so the chunk goes straight to the stream buffer. Otherwise it waits
+    // its turn, since a stream buffer accepts only one write at a time.
+    if (previous.is_done())
+    {
+        try
+        {
+            previous.wait();
+        }
+        catch (...)
+        {
+            return previous;
+        }
+        return write();
+    }
+    return previous.then(write);
+}
+} // namespace
+
+void web::json::writer::spill()
+{
+    if (m_chunk.size() < m_chunk_size)
+    {
+        return;
+    }
+
+    // The full chunks are written as slices of the buffer, however long a single value made it; only the tail that
+    // does not fill a chunk is copied back.
+    auto chunk = std::make_shared<std::string>();
+    chunk->swap(m_chunk);
+    const size_t full = chunk->size() - chunk->size() % m_chunk_size;
+    for (size_t offset = 0; offset < full; offset += m_chunk_size)
+    {
+        m_pending = write_chunk(m_pending, m_buffer, chunk, offset, m_chunk_size);
+    }
+    m_chunk.reserve(m_chunk_size);
+    m_chunk.assign(*chunk, full, std::string::npos);
+}
+
+pplx::task<void> web::json::writer::flush()
+{
+    if (!m_chunk.empty())
+    {
+        auto chunk = std::make_shared<std::string>();
+        chunk->reserve(m_chunk_size);
+        chunk->swap(m_chunk);
+        m_pending = write_chunk(m_pending, m_buffer, chunk, 0, chunk->size());
+    }
+    return m_pending;
+}
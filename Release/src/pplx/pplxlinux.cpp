@@ -16,7 +16,9 @@
 #include "pplx/pplx.h"
 #include "pplx/threadpool.h"
 #include "sys/syscall.h"
+#include <deque>
 #include <thread>
+#include <vector>
 
 #ifdef _WIN32
 #error "ERROR: This file should only be included in non-windows Build"
@@ -38,6 +40,276 @@ _PPLXIMP void linux_scheduler::schedule(TaskProc_t proc, void* param)
     crossplat::threadpool::shared_instance().service().post(boost::bind(proc, param));
 }
 
+// The work stealing scheduler keeps one queue per worker thread. A worker runs the task it scheduled most recently
+// from its LIFO slot (so a continuation runs while its antecedent's data is still hot), then its own queue in FIFO
+// order, then tasks scheduled from outside the pool, and finally steals half of another worker's queue. Each queue
+// has its own lock, so workers only contend with each other while stealing.
+class work_stealing_scheduler::impl : public std::enable_shared_from_this<work_stealing_scheduler::impl>
+{
+public:
+    explicit impl(size_t num_threads)
+        : m_workers(num_threads), m_pending(0), m_sleeping(0), m_stopping(false)
+    {
+    }
+
+    void start()
+    {
+        auto self = shared_from_this();
+        m_threads.reserve(m_workers.size());
+        for (size_t index = 0; index < m_workers.size(); ++index)
+        {
+            m_threads.emplace_back([self, index] { self->run(index); });
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stopping = true;
+        }
+        m_wakeup.notify_all();
+
+        for (auto& thread : m_threads)
+        {
+            // the last reference to the scheduler may be released by one of its own tasks
+            if (thread.get_id() == std::this_thread::get_id())
+            {
+                thread.detach();
+            }
+            else
+            {
+                thread.join();
+            }
+        }
+    }
+
+    void schedule(TaskProc_t proc, void* param)
+    {
+        const work_item item {proc, param};
+        m_pending.fetch_add(1);
+
+        worker* current = current_worker();
+        if (current != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(current->m_lock);
+            if (current->m_lifo_slot.m_proc != nullptr)
+            {
+                current->m_queue.push_back(current->m_lifo_slot);
+            }
+            current->m_lifo_slot = item;
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_injected.push_back(item);
+        }
+
+        if (m_sleeping.load() != 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+            }
+            m_wakeup.notify_one();
+        }
+    }
+
+    size_t thread_count() const { return m_workers.size(); }
+
+private:
+    struct work_item
+    {
+        TaskProc_t m_proc;
+        void* m_param;
+    };
+
+    struct worker
+    {
+        worker() : m_owner(nullptr), m_lifo_slot {nullptr, nullptr}, m_lifo_runs(0) {}
+
+        impl* m_owner;
+        std::mutex m_lock;
+        work_item m_lifo_slot;
+        std::deque<work_item> m_queue;
+        // consecutive tasks taken from the LIFO slot; bounded so that a chain of continuations cannot starve the
+        // rest of the queue
+        size_t m_lifo_runs;
+    };
+
+    static const size_t max_lifo_runs = 16;
+
+    static worker*& tls_worker()
+    {
+        static thread_local worker* current = nullptr;
+        return current;
+    }
+
+    worker* current_worker() const
+    {
+        worker* current = tls_worker();
+        return (current != nullptr && current->m_owner == this) ? current : nullptr;
+    }
+
+    bool try_take_local(worker& self, work_item& item)
+    {
+        std::lock_guard<std::mutex> lock(self.m_lock);
+        if (self.m_lifo_slot.m_proc != nullptr && (self.m_lifo_runs < max_lifo_runs || self.m_queue.empty()))
+        {
+            item = self.m_lifo_slot;
+            self.m_lifo_slot.m_proc = nullptr;
+            ++self.m_lifo_runs;
+            return true;
+        }
+
+        self.m_lifo_runs = 0;
+        if (self.m_lifo_slot.m_proc != nullptr)
+        {
+            self.m_queue.push_back(self.m_lifo_slot);
+            self.m_lifo_slot.m_proc = nullptr;
+        }
+
+        if (self.m_queue.empty())
+        {
+            return false;
+        }
+
+        item = self.m_queue.front();
+        self.m_queue.pop_front();
+        return true;
+    }
+
+    bool try_take_injected(work_item& item)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_injected.empty())
+        {
+            return false;
+        }
+
+        item = m_injected.front();
+        m_injected.pop_front();
+        return true;
+    }
+
+    bool try_steal(size_t thief, work_item& item)
+    {
+        const size_t count = m_workers.size();
+        for (size_t offset = 1; offset < count; ++offset)
+        {
+            worker& victim = m_workers[(thief + offset) % count];
+            std::vector<work_item> stolen;
+            {
+                std::lock_guard<std::mutex> lock(victim.m_lock);
+                const size_t available = victim.m_queue.size();
+                if (available != 0)
+                {
+                    // take the older half of the victim's queue; the newer half is more likely to be hot in its cache
+                    const size_t take = (available + 1) / 2;
+                    stolen.assign(victim.m_queue.begin(), victim.m_queue.begin() + take);
+                    victim.m_queue.erase(victim.m_queue.begin(), victim.m_queue.begin() + take);
+                }
+                else if (victim.m_lifo_slot.m_proc != nullptr)
+                {
+                    // the victim may be blocked inside a task, so its LIFO slot must not be left stranded
+                    stolen.push_back(victim.m_lifo_slot);
+                    victim.m_lifo_slot.m_proc = nullptr;
+                }
+            }
+
+            if (!stolen.empty())
+            {
+                item = stolen.front();
+                if (stolen.size() > 1)
+                {
+                    worker& self = m_workers[thief];
+                    std::lock_guard<std::mutex> lock(self.m_lock);
+                    self.m_queue.insert(self.m_queue.end(), stolen.begin() + 1, stolen.end());
+                }
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool try_take(size_t index, work_item& item)
+    {
+        return try_take_local(m_workers[index], item) || try_take_injected(item) || try_steal(index, item);
+    }
+
+    void run(size_t index)
+    {
+        worker& self = m_workers[index];
+        self.m_owner = this;
+        tls_worker() = &self;
+
+        for (;;)
+        {
+            work_item item;
+            if (try_take(index, item))
+            {
+                m_pending.fetch_sub(1);
+                item.m_proc(item.m_param);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_lock);
+            if (m_pending.load() != 0)
+            {
+                // a task is in flight between schedule() and its queue, or another worker is about to steal it
+                lock.unlock();
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (m_stopping)
+            {
+                break;
+            }
+
+            m_sleeping.fetch_add(1);
+            m_wakeup.wait(lock, [this] { return m_pending.load() != 0 || m_stopping; });
+            m_sleeping.fetch_sub(1);
+        }
+
+        tls_worker() = nullptr;
+    }
+
+    std::vector<worker> m_workers;
+    std::vector<std::thread> m_threads;
+
+    // guards m_injected and m_stopping, and is the mutex m_wakeup waits on
+    std::mutex m_lock;
+    std::condition_variable m_wakeup;
+    std::deque<work_item> m_injected;
+
+    // number of scheduled tasks that have not yet been taken by a worker
+    std::atomic<size_t> m_pending;
+    std::atomic<size_t> m_sleeping;
+    bool m_stopping;
+};
+
+_PPLXIMP work_stealing_scheduler::work_stealing_scheduler(size_t num_threads)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::thread::hardware_concurrency();
+        if (num_threads == 0)
+        {
+            num_threads = 1;
+        }
+    }
+
+    m_impl = std::make_shared<impl>(num_threads);
+    m_impl->start();
+}
+
+_PPLXIMP work_stealing_scheduler::~work_stealing_scheduler() { m_impl->stop(); }
+
+_PPLXIMP void work_stealing_scheduler::schedule(TaskProc_t proc, void* param) { m_impl->schedule(proc, param); }
+
+_PPLXIMP size_t work_stealing_scheduler::thread_count() const { return m_impl->thread_count(); }
+
 } // namespace details
 
 } // namespace pplx
@@ -575,6 +575,14 @@ size_t _seekrdtoend_fsb(Concurrency::streams::details::_file_info* info, int64_t
     return fInfo->m_rdpos;
 }
 
+// Not part of the public interface: the asio listener declares it to send files with sendfile.
+int _get_fsb_handle(_In_ concurrency::streams::details::_file_info* info)
+{
+    if (info == nullptr) return -1;
+
+    return static_cast<_file_info_impl*>(info)->m_handle;
+}
+
 utility::size64_t _get_size(_In_ concurrency::streams::details::_file_info* info, size_t char_size)
 {
     if (info == nullptr) return static_cast<size_t>(-1);
@@ -1,10 +1,24 @@
 #include "stdafx.h"
 
 #include "../../../src/http/common/connection_pool_helpers.h"
+
+#if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
+#include <boost/asio.hpp>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <thread>
 
+using namespace web::http;
+using namespace web::http::client;
 using namespace web::http::client::details;
 
+using namespace tests::functional::http::client;
+using namespace tests::functional::http::utilities;
+
 SUITE(connection_pooling)
 {
     TEST(empty_returns_nullptr)
@@ -47,4 +61,232 @@ SUITE(connection_pooling)
         VERIFY_ARE_EQUAL(0, noisyCount);
         VERIFY_IS_FALSE(connectionStack.free_stale_connections());
     }
+
+    TEST(stale_connections_handed_back)
+    {
+        connection_pool_stack<int> connectionStack;
+        connectionStack.release(std::make_shared<int>(1));
+        connectionStack.release(std::make_shared<int>(2));
+        VERIFY_ARE_EQUAL(2u, connectionStack.size());
+
+        std::vector<std::shared_ptr<int>> freed;
+        VERIFY_IS_TRUE(connectionStack.free_stale_connections(freed));
+        VERIFY_ARE_EQUAL(0u, freed.size());
+        VERIFY_IS_FALSE(connectionStack.free_stale_connections(freed));
+        VERIFY_ARE_EQUAL(2u, freed.size());
+        VERIFY_ARE_EQUAL(0u, connectionStack.size());
+    }
+
+    TEST(usable_stale_connections_kept)
+    {
+        connection_pool_stack<int> connectionStack;
+        for (int i = 1; i <= 4; ++i)
+        {
+            connectionStack.release(std::make_shared<int>(i));
+        }
+        const auto usable = [](int connection) { return connection != 4; };
+
+        // Up to two are kept, the most recently released usable ones, and they stay stale.
+        std::vector<std::shared_ptr<int>> freed;
+        VERIFY_IS_TRUE(connectionStack.free_stale_connections(freed, 2, usable));
+        VERIFY_ARE_EQUAL(0u, freed.size());
+        VERIFY_IS_TRUE(connectionStack.free_stale_connections(freed, 2, usable));
+        VERIFY_ARE_EQUAL(2u, freed.size());
+        VERIFY_IS_TRUE(connectionStack.free_stale_connections(freed, 2, usable));
+        VERIFY_ARE_EQUAL(2u, freed.size());
+        VERIFY_ARE_EQUAL(3, *connectionStack.try_acquire());
+        VERIFY_ARE_EQUAL(2, *connectionStack.try_acquire());
+    }
+
+#if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
+
+    TEST_FIXTURE(uri_address, requests_share_limited_connection)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        http_client_config config;
+        config.set_max_connections_per_host(1);
+        http_client client(m_uri, config);
+
+        const size_t num_requests = 4;
+        auto requests = scoped.server()->next_requests(num_requests);
+        std::vector<pplx::task<http_response>> responses;
+        for (size_t i = 0; i < num_requests; ++i)
+        {
+            responses.push_back(client.request(methods::GET));
+        }
+
+        // With a single connection the server sees the requests one after the other.
+        for (auto& request : requests)
+        {
+            VERIFY_ARE_EQUAL(0u, request.get()->reply(status_codes::OK));
+        }
+
+        for (auto& response : responses)
+        {
+            VERIFY_ARE_EQUAL(status_codes::OK, response.get().status_code());
+        }
+
+        const auto stats = client.pool_stats();
+        VERIFY_ARE_EQUAL(1u, stats.created);
+        VERIFY_ARE_EQUAL(num_requests - 1, stats.reused);
+        VERIFY_ARE_EQUAL(0u, stats.waiting);
+        VERIFY_ARE_EQUAL(0u, stats.wait_timeouts);
+    }
+
+    TEST_FIXTURE(uri_address, pool_wait_timeout)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        http_client_config config;
+        config.set_max_connections_per_host(1);
+        config.set_connection_pool_wait_timeout(std::chrono::milliseconds(100));
+        http_client client(m_uri, config);
+
+        auto pending = scoped.server()->next_request();
+        auto first = client.request(methods::GET);
+        auto request = pending.get();
+
+        VERIFY_THROWS_HTTP_ERROR_CODE(client.request(methods::GET).get(), std::errc::timed_out);
+        VERIFY_ARE_EQUAL(1u, client.pool_stats().wait_timeouts);
+        VERIFY_ARE_EQUAL(1u, client.pool_stats().active);
+
+        VERIFY_ARE_EQUAL(0u, request->reply(status_codes::OK));
+        VERIFY_ARE_EQUAL(status_codes::OK, first.get().status_code());
+    }
+
+    TEST_FIXTURE(uri_address, pool_wait_canceled)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        http_client_config config;
+        config.set_max_connections_per_host(1);
+        http_client client(m_uri, config);
+
+        auto pending = scoped.server()->next_request();
+        auto first = client.request(methods::GET);
+        auto request = pending.get();
+
+        pplx::cancellation_token_source source;
+        auto queued = client.request(methods::GET, source.get_token());
+        source.cancel();
+        VERIFY_THROWS_HTTP_ERROR_CODE(queued.get(), std::errc::operation_canceled);
+
+        VERIFY_ARE_EQUAL(0u, request->reply(status_codes::OK));
+        VERIFY_ARE_EQUAL(status_codes::OK, first.get().status_code());
+    }
+
+    TEST_FIXTURE(uri_address, prewarm_opens_idle_connections)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        http_client client(m_uri);
+
+        VERIFY_ARE_EQUAL(2u, client.prewarm(2).get());
+        VERIFY_ARE_EQUAL(2u, client.pool_stats().idle);
+        VERIFY_ARE_EQUAL(0u, client.prewarm(2).get());
+
+        auto request = scoped.server()->next_request();
+        auto response = client.request(methods::GET);
+        VERIFY_ARE_EQUAL(0u, request.get()->reply(status_codes::OK));
+        VERIFY_ARE_EQUAL(status_codes::OK, response.get().status_code());
+
+        const auto stats = client.pool_stats();
+        VERIFY_ARE_EQUAL(2u, stats.created);
+        VERIFY_ARE_EQUAL(1u, stats.reused);
+    }
+
+    TEST_FIXTURE(uri_address, prewarm_unreachable_host)
+    {
+        http_client client(m_uri);
+        VERIFY_ARE_EQUAL(0u, client.prewarm(1).get());
+        VERIFY_ARE_EQUAL(0u, client.pool_stats().idle);
+        VERIFY_ARE_EQUAL(0u, client.pool_stats().active);
+    }
+
+    TEST_FIXTURE(uri_address, min_idle_connections_replaced)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        http_client_config config;
+        config.set_min_idle_connections_per_host(1);
+        config.set_connection_pool_eviction_interval(std::chrono::milliseconds(50));
+        http_client client(m_uri, config);
+
+        // The server closes the connection of the request, which leaves the host with no idle connection.
+        auto request = scoped.server()->next_request();
+        auto response = client.request(methods::GET);
+        VERIFY_ARE_EQUAL(0u, request.get()->reply(status_codes::OK, U(""), {{header_names::connection, U("close")}}));
+        VERIFY_ARE_EQUAL(status_codes::OK, response.get().status_code());
+
+        connection_pool_stats stats;
+        for (int i = 0; i < 100 && (stats = client.pool_stats()).idle == 0; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        VERIFY_ARE_EQUAL(1u, stats.idle);
+        VERIFY_IS_TRUE(stats.created >= 2u);
+    }
+
+    TEST(zero_eviction_interval_rejected)
+    {
+        http_client_config config;
+        VERIFY_THROWS(config.set_connection_pool_eviction_interval(std::chrono::seconds(0)), std::invalid_argument);
+        VERIFY_THROWS(config.set_connection_pool_eviction_interval(std::chrono::nanoseconds(10)),
+                      std::invalid_argument);
+        VERIFY_ARE_EQUAL(30, config.connection_pool_eviction_interval<std::chrono::seconds>().count());
+    }
+
+    TEST_FIXTURE(uri_address, idle_connections_closed_by_server_replaced)
+    {
+        // The server closes the first connection as soon as it has accepted it, and keeps the second open.
+        boost::asio::io_service service;
+        boost::asio::ip::tcp::acceptor acceptor(
+            service,
+            boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(),
+                                           static_cast<unsigned short>(m_uri.port())));
+        boost::asio::ip::tcp::socket closed(service);
+        boost::asio::ip::tcp::socket kept(service);
+        std::atomic<int> accepted(0);
+        pplx::extensibility::event_t replaced;
+        std::function<void()> accept_next = [&] {
+            auto& socket = accepted == 0 ? closed : kept;
+            acceptor.async_accept(socket, [&](const boost::system::error_code& ec) {
+                if (ec)
+                {
+                    return;
+                }
+                if (++accepted == 1)
+                {
+                    boost::system::error_code ignored;
+                    closed.close(ignored);
+                    accept_next();
+                }
+                else
+                {
+                    replaced.set();
+                }
+            });
+        };
+        accept_next();
+        std::thread server([&service] { service.run(); });
+
+        http_client_config config;
+        config.set_min_idle_connections_per_host(1);
+        config.set_connection_pool_eviction_interval(std::chrono::milliseconds(20));
+        http_client client(U("http://127.0.0.1:") + utility::conversions::details::to_string_t(m_uri.port()), config);
+        VERIFY_ARE_EQUAL(1u, client.prewarm(1).get());
+
+        // The closed connection is replaced by the next cleanup that finds it stale.
+        VERIFY_ARE_EQUAL(0u, replaced.wait(10000));
+
+        // The open one survives the cleanups that follow, and serves the next request.
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        VERIFY_ARE_EQUAL(2u, client.pool_stats().created);
+        auto response = client.request(methods::GET);
+        boost::asio::streambuf request;
+        boost::asio::read_until(kept, request, "\r\n\r\n");
+        boost::asio::write(kept, boost::asio::buffer(std::string("HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n")));
+        VERIFY_ARE_EQUAL(status_codes::OK, response.get().status_code());
+
+        service.post([&acceptor] { acceptor.close(); });
+        server.join();
+    }
+
+#endif
 };
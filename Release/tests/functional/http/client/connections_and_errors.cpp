@@ -16,6 +16,11 @@
 #include "cpprest/http_listener.h"
 #endif
 
+#if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
+#include <boost/asio.hpp>
+#endif
+
+#include <atomic>
 #include <chrono>
 #include <thread>
 
@@ -440,6 +445,131 @@ SUITE(connections_and_errors)
         VERIFY_THROWS_HTTP_ERROR_CODE(t.get(), std::errc::operation_canceled);
     }
 
+#if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
+    // Resolves localhost, which the test server listens on, for the stub resolvers below.
+    static std::vector<boost::asio::ip::tcp::endpoint> localhost_endpoints(const std::string& port)
+    {
+        boost::asio::io_service service;
+        boost::asio::ip::tcp::resolver resolver(service);
+        boost::asio::ip::tcp::resolver::iterator endpoints =
+            resolver.resolve(boost::asio::ip::tcp::resolver::query("localhost", port));
+        return std::vector<boost::asio::ip::tcp::endpoint>(endpoints, boost::asio::ip::tcp::resolver::iterator());
+    }
+
+    TEST_FIXTURE(uri_address, dns_cache)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        std::atomic<int> lookups(0);
+        http_client_config config;
+        config.set_dns_cache_ttl(std::chrono::minutes(1));
+        config.set_dns_negative_cache_ttl(std::chrono::minutes(1));
+        config.set_dns_resolver([&lookups](const std::string& host, const std::string& port) {
+            ++lookups;
+            if (host != "localhost")
+            {
+                return pplx::task_from_exception<std::vector<boost::asio::ip::tcp::endpoint>>(
+                    std::runtime_error("unknown host"));
+            }
+            return pplx::task_from_result(localhost_endpoints(port));
+        });
+
+        // The server closes every connection, so each request resolves the host of its new connection.
+        http_client client(m_uri, config);
+        const std::map<utility::string_t, utility::string_t> close_headers {{header_names::connection, U("close")}};
+        for (int i = 0; i < 2; ++i)
+        {
+            auto request = scoped.server()->next_request();
+            auto response = client.request(methods::GET);
+            VERIFY_ARE_EQUAL(0u, request.get()->reply(status_codes::OK, U(""), close_headers));
+            VERIFY_ARE_EQUAL(status_codes::OK, response.get().status_code());
+        }
+        VERIFY_ARE_EQUAL(2u, client.pool_stats().created);
+        VERIFY_ARE_EQUAL(1, lookups.load());
+
+        http_client unknown(U("http://unknown.invalid:34568/"), config);
+        VERIFY_THROWS(unknown.request(methods::GET).get(), http_exception);
+        VERIFY_THROWS(unknown.request(methods::GET).get(), http_exception);
+        VERIFY_ARE_EQUAL(2, lookups.load());
+    }
+
+    TEST_FIXTURE(uri_address, connection_attempts_race)
+    {
+        // A listener whose backlog is full drops connection attempts, which then neither succeed nor fail.
+        boost::asio::io_service service;
+        boost::asio::ip::tcp::acceptor stalled(service);
+        stalled.open(boost::asio::ip::tcp::v4());
+        stalled.bind(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        stalled.listen(0);
+        boost::asio::ip::tcp::socket backlog(service);
+        backlog.connect(stalled.local_endpoint());
+
+        test_http_server::scoped_server scoped(m_uri);
+        http_client_config config;
+        config.set_timeout(std::chrono::seconds(10));
+        config.set_connection_attempt_delay(std::chrono::milliseconds(50));
+        const auto stalled_endpoint = stalled.local_endpoint();
+        config.set_dns_resolver([stalled_endpoint](const std::string&, const std::string& port) {
+            auto endpoints = localhost_endpoints(port);
+            endpoints.insert(endpoints.begin(), stalled_endpoint);
+            return pplx::task_from_result(endpoints);
+        });
+
+        // Trying the endpoints one after the other would wait for the stalled one until the request times out.
+        http_client client(m_uri, config);
+        auto request = scoped.server()->next_request();
+        auto response = client.request(methods::GET);
+        VERIFY_ARE_EQUAL(0u, request.get()->reply(status_codes::OK));
+        VERIFY_ARE_EQUAL(status_codes::OK, response.get().status_code());
+    }
+
+    TEST_FIXTURE(uri_address, requests_sent_from_calling_thread)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        std::atomic<size_t> started(0);
+        std::atomic<bool> other_thread(false);
+        const auto caller = std::this_thread::get_id();
+        http_client_config config;
+        config.set_nativehandle_options([&](native_handle) {
+            ++started;
+            if (std::this_thread::get_id() != caller)
+            {
+                other_thread = true;
+            }
+        });
+
+        // Each request is started before request() returns, without waiting for a scheduled task.
+        http_client client(m_uri, config);
+        const size_t num_requests = 50;
+        std::vector<pplx::task<test_request*>> requests;
+        std::vector<pplx::task<http_response>> responses;
+        for (size_t i = 0; i < num_requests; ++i)
+        {
+            requests.push_back(scoped.server()->next_request());
+            http_request msg(methods::PUT);
+            msg.headers().add(U("X-Request"), i);
+            msg.set_body(U("request body"));
+            responses.push_back(client.request(msg));
+            VERIFY_ARE_EQUAL(i + 1, started.load());
+        }
+        VERIFY_IS_FALSE(other_thread.load());
+
+        for (auto&& request : requests)
+        {
+            auto p_request = request.get();
+            http_asserts::assert_test_request_equals(
+                p_request, methods::PUT, U("/"), U("text/plain"), U("request body"));
+            size_t index = num_requests;
+            VERIFY_IS_TRUE(p_request->match_header(U("X-Request"), index));
+            VERIFY_IS_TRUE(index < num_requests);
+            VERIFY_ARE_EQUAL(0u, p_request->reply(status_codes::OK));
+        }
+        for (auto&& response : responses)
+        {
+            VERIFY_ARE_EQUAL(status_codes::OK, response.get().status_code());
+        }
+    }
+#endif
+
 } // SUITE(connections_and_errors)
 
 } // namespace client
@@ -145,6 +145,93 @@ SUITE(multiple_requests)
         }
     }
 
+    // Tests that requests sharing an ordering key are sent one at a time, while different keys run in parallel.
+    TEST_FIXTURE(uri_address, requests_with_ordering_keys)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        http_client client(m_uri);
+
+        const size_t num_keys = 4;
+        const size_t requests_per_key = 3;
+        auto requests = scoped.server()->next_requests(num_keys * requests_per_key + 1);
+        std::vector<pplx::task<http_response>> responses;
+        for (size_t key = 0; key < num_keys; ++key)
+        {
+            for (size_t i = 0; i < requests_per_key; ++i)
+            {
+                http_request msg(methods::GET);
+                msg.set_ordering_key(U("stream") + to_string_t(std::to_string(key)));
+                msg.headers().add(U("X-Key"), key);
+                msg.headers().add(U("X-Index"), i);
+                responses.push_back(client.request(msg));
+            }
+        }
+
+        // A request without a key is not held back by the ordered ones.
+        auto unordered = client.request(methods::GET);
+
+        // Each round has one request in flight per key, the next one of each key in turn.
+        size_t received = 0;
+        for (size_t round = 0; round < requests_per_key; ++round)
+        {
+            const size_t in_flight = round == 0 ? num_keys + 1 : num_keys;
+            std::vector<bool> seen(num_keys, false);
+            for (size_t i = received; i < received + in_flight; ++i)
+            {
+                auto p_request = requests[i].get();
+                size_t key = num_keys;
+                size_t index = requests_per_key;
+                if (p_request->match_header(U("X-Key"), key))
+                {
+                    VERIFY_IS_TRUE(p_request->match_header(U("X-Index"), index));
+                    VERIFY_IS_TRUE(key < num_keys);
+                    VERIFY_ARE_EQUAL(round, index);
+                    VERIFY_IS_FALSE(seen[key]);
+                    seen[key] = true;
+                }
+                else
+                {
+                    VERIFY_ARE_EQUAL(0u, round);
+                }
+            }
+
+            for (size_t i = received; i < received + in_flight; ++i)
+            {
+                VERIFY_ARE_EQUAL(0u, requests[i].get()->reply(status_codes::OK));
+            }
+            received += in_flight;
+        }
+
+        for (auto&& response : responses)
+        {
+            VERIFY_ARE_EQUAL(status_codes::OK, response.get().status_code());
+        }
+        VERIFY_ARE_EQUAL(status_codes::OK, unordered.get().status_code());
+    }
+
+    // Tests that changing the ordering key of a sent request does not stall the requests queued behind it.
+    TEST_FIXTURE(uri_address, ordering_key_changed_after_send)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        http_client client(m_uri);
+
+        auto requests = scoped.server()->next_requests(2);
+        http_request first(methods::GET);
+        first.set_ordering_key(U("stream"));
+        auto first_response = client.request(first);
+        http_request second(methods::GET);
+        second.set_ordering_key(U("stream"));
+        auto second_response = client.request(second);
+
+        // The key the first request was sent with releases the second one.
+        auto p_first = requests[0].get();
+        first.set_ordering_key(U("other"));
+        VERIFY_ARE_EQUAL(0u, p_first->reply(status_codes::OK));
+        VERIFY_ARE_EQUAL(status_codes::OK, first_response.get().status_code());
+        VERIFY_ARE_EQUAL(0u, requests[1].get()->reply(status_codes::OK));
+        VERIFY_ARE_EQUAL(status_codes::OK, second_response.get().status_code());
+    }
+
 } // SUITE(multiple_requests)
 
 } // namespace client
@@ -15,6 +15,10 @@
 
 #include "stdafx.h"
 
+#if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
+#include <boost/asio.hpp>
+#endif
+
 using namespace web;
 using namespace utility;
 using namespace web::http;
@@ -146,6 +150,171 @@ SUITE(building_response_tests)
 
         listener.close().wait();
     }
+
+#if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
+    // Upper-cases the body, standing in for a real compression algorithm.
+    class upper_case_compressor : public compression::compress_provider
+    {
+    public:
+        upper_case_compressor() : m_algorithm(U("upper")) {}
+
+        virtual const utility::string_t& algorithm() const { return m_algorithm; }
+
+        virtual size_t compress(const uint8_t* input,
+                                size_t input_size,
+                                uint8_t* output,
+                                size_t output_size,
+                                compression::operation_hint hint,
+                                size_t& input_bytes_processed,
+                                bool& done)
+        {
+            input_bytes_processed = (std::min)(input_size, output_size);
+            std::transform(input, input + input_bytes_processed, output, [](uint8_t c) {
+                return static_cast<uint8_t>(std::toupper(c));
+            });
+            done = hint == compression::operation_hint::is_last && input_bytes_processed == input_size;
+            return input_bytes_processed;
+        }
+
+        virtual pplx::task<compression::operation_result> compress(const uint8_t* input,
+                                                                   size_t input_size,
+                                                                   uint8_t* output,
+                                                                   size_t output_size,
+                                                                   compression::operation_hint hint)
+        {
+            compression::operation_result r;
+            r.output_bytes_produced =
+                compress(input, input_size, output, output_size, hint, r.input_bytes_processed, r.done);
+            return pplx::task_from_result(r);
+        }
+
+        virtual void reset() {}
+
+    private:
+        utility::string_t m_algorithm;
+    };
+
+    TEST_FIXTURE(uri_address, compressed_responses)
+    {
+        http_listener_config config;
+        config.set_compress_responses(true);
+        config.set_compression_min_size(100);
+        config.set_compress_factories({compression::make_compress_factory(
+            U("upper"), [] { return utility::details::make_unique<upper_case_compressor>(); })});
+        http_listener listener(m_uri, config);
+        listener.support([](http_request request) {
+            const auto path = request.relative_uri().path();
+            if (path == U("/short"))
+            {
+                request.reply(status_codes::OK, "short");
+            }
+            else if (path == U("/binary"))
+            {
+                http_response response(status_codes::OK);
+                response.set_body(std::vector<unsigned char>(1000, 'b'));
+                request.reply(response);
+            }
+            else
+            {
+                request.reply(status_codes::OK, std::string(10000, 'a'));
+            }
+        });
+        listener.open().wait();
+        test_http_client::scoped_client client(m_uri);
+        test_http_client* p_client = client.client();
+        const std::map<utility::string_t, utility::string_t> accept = {{header_names::accept_encoding, U("upper")}};
+
+        // A long text body is compressed, over several chunks.
+        VERIFY_ARE_EQUAL(0u, p_client->request(methods::GET, U("/long"), accept));
+        p_client->next_response()
+            .then([](test_response* p_response) {
+                VERIFY_ARE_EQUAL(U("upper"), p_response->m_headers[header_names::content_encoding]);
+                VERIFY_ARE_EQUAL(std::string(10000, 'A'),
+                                 std::string(p_response->m_data.begin(), p_response->m_data.end()));
+            })
+            .wait();
+
+        // The body is sent as it is to clients that do not accept the encoding, when it is short, or when its content
+        // type is not compressible.
+        const std::pair<utility::string_t, bool> uncompressed[] = {
+            {U("/long"), false}, {U("/short"), true}, {U("/binary"), true}};
+        for (const auto& request : uncompressed)
+        {
+            VERIFY_ARE_EQUAL(0u,
+                             request.second ? p_client->request(methods::GET, request.first, accept)
+                                            : p_client->request(methods::GET, request.first));
+            p_client->next_response()
+                .then([](test_response* p_response) {
+                    VERIFY_ARE_EQUAL(0u, p_response->m_headers.count(header_names::content_encoding));
+                    VERIFY_IS_TRUE(p_response->m_data.size() > 0 && std::islower(p_response->m_data[0]));
+                })
+                .wait();
+        }
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, responses_without_chunked_bodies_not_compressed)
+    {
+        http_listener_config config;
+        config.set_compress_responses(true);
+        config.set_compress_factories({compression::make_compress_factory(
+            U("upper"), [] { return utility::details::make_unique<upper_case_compressor>(); })});
+        http_listener listener(m_uri, config);
+        listener.support([](http_request request) {
+            http_response response(status_codes::OK);
+            response.set_body(std::string(10000, 'a'));
+            if (request.relative_uri().path() == U("/vary"))
+            {
+                response.headers().add(header_names::vary, U("Origin, accept-encoding"));
+            }
+            request.reply(response);
+        });
+        listener.open().wait();
+
+        // A response whose Vary header already lists Accept-Encoding does not list it twice.
+        {
+            test_http_client::scoped_client client(m_uri);
+            test_http_client* p_client = client.client();
+            const std::map<utility::string_t, utility::string_t> accept = {{header_names::accept_encoding, U("upper")}};
+            VERIFY_ARE_EQUAL(0u, p_client->request(methods::GET, U("/vary"), accept));
+            p_client->next_response()
+                .then([](test_response* p_response) {
+                    VERIFY_ARE_EQUAL(U("upper"), p_response->m_headers[header_names::content_encoding]);
+                    VERIFY_ARE_EQUAL(U("Origin, accept-encoding"), p_response->m_headers[header_names::vary]);
+                })
+                .wait();
+        }
+
+        // A response to HEAD has no body to compress.
+        {
+            client::http_client client(m_uri);
+            http_request request(methods::HEAD);
+            request.headers().add(header_names::accept_encoding, U("upper"));
+            const auto response = client.request(request).get();
+            VERIFY_ARE_EQUAL(status_codes::OK, response.status_code());
+            VERIFY_IS_FALSE(response.headers().has(header_names::content_encoding));
+        }
+
+        // An HTTP/1.0 client cannot read the chunks a compressed body is sent in.
+        {
+            boost::asio::io_service service;
+            boost::asio::ip::tcp::socket socket(service);
+            boost::asio::ip::tcp::resolver resolver(service);
+            boost::asio::connect(socket, resolver.resolve("localhost", std::to_string(m_uri.port())));
+            boost::asio::write(
+                socket, boost::asio::buffer(std::string("GET / HTTP/1.0\r\nAccept-Encoding: upper\r\n\r\n")));
+            boost::asio::streambuf received;
+            boost::asio::read_until(socket, received, "\r\n\r\n");
+            const std::string head(boost::asio::buffers_begin(received.data()),
+                                   boost::asio::buffers_end(received.data()));
+            VERIFY_ARE_EQUAL(std::string::npos, head.find("Content-Encoding"));
+            VERIFY_ARE_NOT_EQUAL(std::string::npos, head.find("Content-Length: 10000"));
+        }
+
+        listener.close().wait();
+    }
+#endif
 }
 
 } // namespace listener
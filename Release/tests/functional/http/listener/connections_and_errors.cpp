@@ -22,6 +22,14 @@
 #include <concrt.h>
 #endif
 
+#if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#endif
+
 using namespace utility;
 using namespace web;
 using namespace web::http;
@@ -412,6 +420,347 @@ SUITE(connections_and_errors)
 
         listener.close().wait();
     }
+
+#if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
+    // Reads from a raw connection until the text arrives, the listener closes the connection or ten seconds pass.
+    std::string read_until(boost::asio::ip::tcp::socket& socket, const std::string& text, bool& closed)
+    {
+        std::string received;
+        closed = false;
+        socket.non_blocking(true);
+        for (int i = 0; i < 1000 && received.find(text) == std::string::npos; ++i)
+        {
+            char buffer[1024];
+            boost::system::error_code ec;
+            const size_t size = socket.read_some(boost::asio::buffer(buffer), ec);
+            if (ec == boost::asio::error::would_block)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            else if (ec)
+            {
+                closed = true;
+                break;
+            }
+            received.append(buffer, size);
+        }
+        return received;
+    }
+
+    TEST_FIXTURE(uri_address, pipelined_requests)
+    {
+        http_listener_config config;
+        config.set_pipeline_depth(16);
+        http_listener listener(m_uri, config);
+        std::mutex requests_lock;
+        std::vector<http_request> requests;
+        pplx::extensibility::event_t all_received;
+        listener.support([&](http_request request) {
+            std::lock_guard<std::mutex> lock(requests_lock);
+            requests.push_back(request);
+            if (requests.size() == 3)
+            {
+                all_received.set();
+            }
+        });
+        listener.open().wait();
+
+        // The requests are sent at once, and the listener has all of them before any is answered.
+        boost::asio::io_service service;
+        boost::asio::ip::tcp::socket socket(service);
+        boost::asio::ip::tcp::resolver resolver(service);
+        boost::asio::connect(socket, resolver.resolve("localhost", std::to_string(m_uri.port())));
+        const std::string pipelined = "GET /1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                                      "POST /2 HTTP/1.1\r\nHost: localhost\r\nContent-Length: 4\r\n\r\nbody"
+                                      "GET /3 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        boost::asio::write(socket, boost::asio::buffer(pipelined));
+        VERIFY_ARE_EQUAL(0u, all_received.wait(10000));
+
+        // The handlers may run in any order.
+        std::sort(requests.begin(), requests.end(), [](const http_request& left, const http_request& right) {
+            return left.relative_uri().path() < right.relative_uri().path();
+        });
+        VERIFY_ARE_EQUAL("body", requests[1].extract_utf8string(true).get());
+
+        // Answered last to first, the responses still arrive in the order of the requests.
+        for (auto it = requests.rbegin(); it != requests.rend(); ++it)
+        {
+            it->reply(status_codes::OK, it->relative_uri().path());
+        }
+
+        bool closed;
+        const std::string received = read_until(socket, "\r\n\r\n/3", closed);
+
+        const auto first = received.find("\r\n\r\n/1");
+        const auto second = received.find("\r\n\r\n/2");
+        const auto third = received.find("\r\n\r\n/3");
+        VERIFY_ARE_NOT_EQUAL(std::string::npos, third);
+        VERIFY_IS_TRUE(first < second && second < third);
+
+        socket.close();
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, slow_connections_time_out)
+    {
+        http_listener_config config;
+        config.set_timeout(utility::seconds(1));
+        http_listener listener(m_uri, config);
+        listener.support([](http_request request) {
+            if (request.relative_uri().path() == U("/slow"))
+            {
+                pplx::create_task([request] {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+                    request.reply(status_codes::OK);
+                });
+            }
+            else
+            {
+                request.reply(status_codes::OK);
+            }
+        });
+        listener.open().wait();
+
+        // One client never sends a request, one never finishes its headers and one waits for a slow handler.
+        boost::asio::io_service service;
+        boost::asio::ip::tcp::resolver resolver(service);
+        const auto endpoints = resolver.resolve("localhost", std::to_string(m_uri.port()));
+        boost::asio::ip::tcp::socket idle(service);
+        boost::asio::ip::tcp::socket partial(service);
+        boost::asio::ip::tcp::socket waiting(service);
+        boost::asio::connect(idle, endpoints);
+        boost::asio::connect(partial, endpoints);
+        boost::asio::connect(waiting, endpoints);
+        boost::asio::write(partial, boost::asio::buffer(std::string("GET / HTTP/1.1\r\nHost: localhost\r\n")));
+        boost::asio::write(waiting, boost::asio::buffer(std::string("GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+
+        // The first two are closed without a response once the timeout has passed.
+        bool closed;
+        VERIFY_ARE_EQUAL("", read_until(idle, "\r\n", closed));
+        VERIFY_IS_TRUE(closed);
+        VERIFY_ARE_EQUAL("", read_until(partial, "\r\n", closed));
+        VERIFY_IS_TRUE(closed);
+
+        // A connection with a request in progress is not idle, so the response arrives.
+        const std::string received = read_until(waiting, "\r\n\r\n", closed);
+        VERIFY_ARE_EQUAL(0u, received.find("HTTP/1.1 200 OK\r\n"));
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, max_connections)
+    {
+        http_listener_config config;
+        config.set_max_connections(1);
+        http_listener listener(m_uri, config);
+        listener.support([](http_request request) { request.reply(status_codes::OK); });
+        listener.open().wait();
+
+        boost::asio::io_service service;
+        boost::asio::ip::tcp::resolver resolver(service);
+        const auto endpoints = resolver.resolve("localhost", std::to_string(m_uri.port()));
+        const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        boost::asio::ip::tcp::socket first(service);
+        boost::asio::connect(first, endpoints);
+        boost::asio::write(first, boost::asio::buffer(request));
+        bool closed;
+        VERIFY_ARE_EQUAL(0u, read_until(first, "\r\n\r\n", closed).find("HTTP/1.1 200 OK\r\n"));
+
+        // The second connection waits in the backlog while the first is open.
+        boost::asio::ip::tcp::socket second(service);
+        boost::asio::connect(second, endpoints);
+        boost::asio::write(second, boost::asio::buffer(request));
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        char buffer[1];
+        boost::system::error_code ec;
+        second.non_blocking(true);
+        second.read_some(boost::asio::buffer(buffer), ec);
+        VERIFY_IS_TRUE(ec == boost::asio::error::would_block);
+
+        first.close();
+        VERIFY_ARE_EQUAL(0u, read_until(second, "\r\n\r\n", closed).find("HTTP/1.1 200 OK\r\n"));
+
+        second.close();
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, request_body_too_large)
+    {
+        http_listener_config config;
+        config.set_max_request_body_size(1000);
+        http_listener listener(m_uri, config);
+        std::atomic<int> length_requests(0);
+        listener.support([&](http_request request) {
+            if (request.relative_uri().path() == U("/length"))
+            {
+                ++length_requests;
+            }
+            request.content_ready().then([request](pplx::task<http_request> body) {
+                try
+                {
+                    body.get();
+                    request.reply(status_codes::OK);
+                }
+                catch (const http_exception&)
+                {
+                    // The listener has answered already.
+                }
+            });
+        });
+        listener.open().wait();
+
+        boost::asio::io_service service;
+        boost::asio::ip::tcp::resolver resolver(service);
+        const auto endpoints = resolver.resolve("localhost", std::to_string(m_uri.port()));
+        bool closed;
+
+        // A body whose Content-Length is too large is refused before the handler sees the request.
+        boost::asio::ip::tcp::socket length(service);
+        boost::asio::connect(length, endpoints);
+        const std::string too_long = "POST /length HTTP/1.1\r\nHost: localhost\r\nContent-Length: 2000\r\n\r\n";
+        boost::asio::write(length, boost::asio::buffer(too_long));
+        VERIFY_ARE_EQUAL(0u, read_until(length, "\r\n\r\n", closed).find("HTTP/1.1 413 "));
+        read_until(length, "\r\n\r\n", closed);
+        VERIFY_IS_TRUE(closed);
+        VERIFY_ARE_EQUAL(0, length_requests.load());
+
+        // A chunked body is refused once it grows too large.
+        boost::asio::ip::tcp::socket chunked(service);
+        boost::asio::connect(chunked, endpoints);
+        const std::string chunk = "320\r\n" + std::string(800, 'a') + "\r\n";
+        const std::string too_many_chunks =
+            "POST /chunked HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n" + chunk + chunk;
+        boost::asio::write(chunked, boost::asio::buffer(too_many_chunks));
+        VERIFY_ARE_EQUAL(0u, read_until(chunked, "\r\n\r\n", closed).find("HTTP/1.1 413 "));
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, request_body_back_pressure)
+    {
+        http_listener_config config;
+        config.set_request_body_buffer_size(4096);
+        http_listener listener(m_uri, config);
+        const size_t body_size = 1024 * 1024;
+        std::atomic<size_t> buffered(0);
+        listener.support([&](http_request request) {
+            pplx::create_task([&buffered, request] {
+                // While the handler is busy, the listener stops reading the body soon after the limit is reached.
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                buffered = request.body().streambuf().in_avail();
+
+                concurrency::streams::container_buffer<std::string> body;
+                request.body().read_to_end(body).get();
+                request.reply(status_codes::OK, utility::conversions::details::to_string_t(body.collection().size()));
+            });
+        });
+        listener.open().wait();
+
+        ::web::http::client::http_client client(m_uri);
+        http_response response = client.request(methods::POST, U(""), std::string(body_size, 'a')).get();
+        VERIFY_ARE_EQUAL(status_codes::OK, response.status_code());
+        VERIFY_ARE_EQUAL(utility::conversions::details::to_string_t(body_size), response.extract_string(true).get());
+
+        // Each read from the socket adds at most a socket buffer's worth past the limit.
+        VERIFY_IS_TRUE(buffered.load() < 4096 + 128 * 1024);
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, request_body_extract_past_buffer_size)
+    {
+        http_listener_config config;
+        config.set_request_body_buffer_size(4096);
+        config.set_timeout(utility::seconds(1));
+        http_listener listener(m_uri, config);
+        std::atomic<bool> extract_failed(false);
+        listener.support([&](http_request request) {
+            // The body never fits the buffer, so the extract fails once the paused read times out.
+            try
+            {
+                request.extract_string().get();
+            }
+            catch (const http_exception&)
+            {
+                extract_failed = true;
+            }
+            request.reply(status_codes::BadRequest);
+        });
+        listener.open().wait();
+
+        ::web::http::client::http_client client(m_uri);
+        auto response = client.request(methods::POST, U(""), std::string(1024 * 1024, 'a'));
+        for (int i = 0; i < 1000 && !extract_failed; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        VERIFY_IS_TRUE(extract_failed.load());
+        try
+        {
+            response.wait();
+        }
+        catch (const ::web::http::http_exception&)
+        {
+        }
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, drain_connections)
+    {
+        http_listener listener(m_uri);
+        pplx::task_completion_event<void> release;
+        listener.support([&](http_request request) {
+            if (request.relative_uri().path() == U("/slow"))
+            {
+                pplx::create_task(release).then([request] { request.reply(status_codes::OK); });
+            }
+            else
+            {
+                request.reply(status_codes::OK);
+            }
+        });
+        listener.open().wait();
+
+        // One connection is idle after its first response, and the other waits for a slow handler.
+        boost::asio::io_service service;
+        boost::asio::ip::tcp::resolver resolver(service);
+        const auto endpoints = resolver.resolve("localhost", std::to_string(m_uri.port()));
+        boost::asio::ip::tcp::socket idle(service);
+        boost::asio::ip::tcp::socket busy(service);
+        boost::asio::connect(idle, endpoints);
+        boost::asio::connect(busy, endpoints);
+        bool closed;
+        boost::asio::write(idle, boost::asio::buffer(std::string("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+        VERIFY_ARE_EQUAL(0u, read_until(idle, "\r\n\r\n", closed).find("HTTP/1.1 200 OK\r\n"));
+        boost::asio::write(busy, boost::asio::buffer(std::string("GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+        for (int i = 0; i < 1000 && listener.in_flight_requests() == 0; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        VERIFY_ARE_EQUAL(1u, listener.in_flight_requests());
+
+        // The idle connection is closed and no new ones are accepted. The drain gives up on the slow request.
+        VERIFY_ARE_EQUAL(1u, listener.drain(std::chrono::milliseconds(200)).get());
+        VERIFY_ARE_EQUAL("", read_until(idle, "\r\n", closed));
+        VERIFY_IS_TRUE(closed);
+        boost::asio::ip::tcp::socket refused(service);
+        boost::system::error_code ec;
+        boost::asio::connect(refused, endpoints, ec);
+        VERIFY_IS_TRUE(!!ec);
+
+        // Its response is still sent, and tells the client that the connection closes.
+        auto drained = listener.drain(std::chrono::seconds(10));
+        release.set();
+        const std::string received = read_until(busy, "\r\n\r\n", closed);
+        VERIFY_ARE_EQUAL(0u, received.find("HTTP/1.1 200 OK\r\n"));
+        VERIFY_ARE_NOT_EQUAL(std::string::npos, received.find("Connection: close\r\n"));
+        VERIFY_ARE_EQUAL(0u, drained.get());
+        VERIFY_ARE_EQUAL(0u, listener.in_flight_requests());
+
+        listener.close().wait();
+    }
+#endif
 }
 
 } // namespace listener
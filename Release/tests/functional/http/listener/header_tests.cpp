@@ -137,6 +137,86 @@ SUITE(header_tests)
         listener.close().wait();
     }
 
+    TEST_FIXTURE(uri_address, request_methods_and_header_whitespace)
+    {
+        http_listener listener(m_uri);
+        listener.open().wait();
+        test_http_client::scoped_client client(m_uri);
+        test_http_client* p_client = client.client();
+
+        // Well known methods are matched ignoring case, other methods are kept as sent.
+        const utility::string_t sent[] = {U("get"), U("Post"), U("options"), U("PATCH"), U("Get2")};
+        const utility::string_t expected[] = {methods::GET, methods::POST, methods::OPTIONS, U("PATCH"), U("Get2")};
+        for (size_t i = 0; i < sizeof(sent) / sizeof(sent[0]); ++i)
+        {
+            listener.support([&](http_request request) {
+                VERIFY_ARE_EQUAL(expected[i], request.method());
+                VERIFY_ARE_EQUAL(U("/path/x"), request.relative_uri().path());
+                request.reply(status_codes::OK).wait();
+            });
+            VERIFY_ARE_EQUAL(0, p_client->request(sent[i], U("path/x")));
+            p_client->next_response()
+                .then([](test_response* p_response) {
+                    http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+                })
+                .wait();
+        }
+
+        // Whitespace around header values is trimmed.
+        std::map<utility::string_t, utility::string_t> headers;
+        headers[U("Padded")] = U(" \t value with spaces \t ");
+        listener.support([&](http_request request) {
+            VERIFY_ARE_EQUAL(U("value with spaces"), request.headers()[U("padded")]);
+            request.reply(status_codes::OK).wait();
+        });
+        VERIFY_ARE_EQUAL(0, p_client->request(methods::GET, U(""), headers));
+        p_client->next_response()
+            .then([](test_response* p_response) {
+                http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+            })
+            .wait();
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, response_date_header)
+    {
+        http_listener listener(m_uri);
+        listener.open().wait();
+        test_http_client::scoped_client client(m_uri);
+        test_http_client* p_client = client.client();
+
+        // Responses get a Date header, unless they already have one.
+        const utility::string_t fixed_date = U("Mon, 29 Jul 2019 12:32:57 GMT");
+        for (int i = 0; i < 2; ++i)
+        {
+            listener.support([&](http_request request) {
+                http_response response(status_codes::OK);
+                if (i == 1)
+                {
+                    response.headers()[header_names::date] = fixed_date;
+                }
+                request.reply(response).wait();
+            });
+            VERIFY_ARE_EQUAL(0, p_client->request(methods::GET, U("")));
+            p_client->next_response()
+                .then([&](test_response* p_response) {
+                    http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+                    utility::string_t date;
+                    VERIFY_IS_TRUE(p_response->match_header(header_names::date, date));
+                    if (i == 0)
+                    {
+                        VERIFY_IS_TRUE(utility::datetime::from_string(date).is_initialized());
+                    }
+                    else
+                    {
+                        VERIFY_ARE_EQUAL(fixed_date, date);
+                    }
+                })
+                .wait();
+        }
+        listener.close().wait();
+    }
+
     TEST_FIXTURE(uri_address, response_headers)
     {
         http_listener listener(m_uri);
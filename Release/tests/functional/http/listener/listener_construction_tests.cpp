@@ -14,6 +14,10 @@
  ****/
 
 #include "stdafx.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
 
 using namespace web::http;
 using namespace web::http::experimental::listener;
@@ -427,6 +431,146 @@ SUITE(listener_construction_tests)
 
 #if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
 
+    TEST_FIXTURE(uri_address, reactor_threads)
+    {
+        http_listener_config config;
+        config.set_reactor_threads(3);
+        VERIFY_ARE_EQUAL(3u, http_listener_config(config).reactor_threads());
+        VERIFY_IS_FALSE(config.offload_handlers());
+
+        // Handlers count the requests of each client.
+        std::mutex requests_lock;
+        std::map<utility::string_t, int> requests;
+        http_listener listener(m_uri, config);
+        listener.support([&](http_request request) {
+            {
+                std::lock_guard<std::mutex> lock(requests_lock);
+                ++requests[request.relative_uri().path()];
+            }
+            request.reply(status_codes::OK, U("reply"));
+        });
+        listener.open().wait();
+
+        // Each client keeps a single connection alive.
+        const size_t client_count = 6;
+        client::http_client_config client_config;
+        client_config.set_max_connections_per_host(1);
+        std::vector<std::unique_ptr<client::http_client>> clients;
+        for (size_t i = 0; i < client_count; ++i)
+        {
+            clients.push_back(utility::details::make_unique<client::http_client>(m_uri, client_config));
+        }
+        for (int round = 0; round < 5; ++round)
+        {
+            std::vector<pplx::task<utility::string_t>> replies;
+            for (size_t i = 0; i < client_count; ++i)
+            {
+                replies.push_back(clients[i]
+                                      ->request(methods::GET, U("/") + utility::conversions::details::to_string_t(i))
+                                      .then([](web::http::http_response response) {
+                                          VERIFY_ARE_EQUAL(status_codes::OK, response.status_code());
+                                          return response.extract_string();
+                                      }));
+            }
+            for (auto& reply : replies)
+            {
+                VERIFY_ARE_EQUAL(U("reply"), reply.get());
+            }
+        }
+        listener.close().wait();
+
+        VERIFY_ARE_EQUAL(client_count, requests.size());
+        for (const auto& client_requests : requests)
+        {
+            VERIFY_ARE_EQUAL(5, client_requests.second);
+        }
+    }
+
+    TEST_FIXTURE(uri_address, reactor_handlers_may_block)
+    {
+        // A single reactor reads the bodies that all the handlers wait for.
+        http_listener_config config;
+        config.set_reactor_threads(1);
+        config.set_offload_handlers(true);
+        VERIFY_IS_TRUE(http_listener_config(config).offload_handlers());
+        http_listener listener(m_uri, config);
+        listener.support([](http_request request) {
+            const auto body = request.extract_string().get();
+            request.reply(status_codes::OK, body);
+        });
+        listener.open().wait();
+
+        const size_t client_count = 4;
+        std::vector<std::unique_ptr<client::http_client>> clients;
+        std::vector<pplx::task<utility::string_t>> replies;
+        for (size_t i = 0; i < client_count; ++i)
+        {
+            clients.push_back(utility::details::make_unique<client::http_client>(m_uri));
+            const auto body = utility::string_t(64 * 1024, U('a') + static_cast<utility::char_t>(i));
+            replies.push_back(
+                clients[i]->request(methods::POST, U(""), body).then([](web::http::http_response response) {
+                    VERIFY_ARE_EQUAL(status_codes::OK, response.status_code());
+                    return response.extract_string();
+                }));
+        }
+        for (size_t i = 0; i < client_count; ++i)
+        {
+            VERIFY_ARE_EQUAL(utility::string_t(64 * 1024, U('a') + static_cast<utility::char_t>(i)), replies[i].get());
+        }
+        listener.close().wait();
+    }
+
+    // Compares the throughput of the shared thread pool, of reactors running the handlers and of reactors offloading
+    // them; run with /noignore.
+    TEST_FIXTURE(uri_address, reactor_throughput, "Ignore", "benchmark")
+    {
+        struct mode
+        {
+            const char* name;
+            size_t reactors;
+            bool offload;
+        };
+        const mode modes[] = {{"shared pool", 0, false}, {"reactors", 2, false}, {"reactors, offloaded", 2, true}};
+        for (const auto& mode : modes)
+        {
+            http_listener_config config;
+            config.set_reactor_threads(mode.reactors);
+            config.set_offload_handlers(mode.offload);
+            http_listener listener(m_uri, config);
+            listener.support([](http_request request) { request.reply(status_codes::OK, U("reply")); });
+            listener.open().wait();
+
+            const size_t client_count = 8;
+            const size_t request_count = 2000;
+            client::http_client_config client_config;
+            client_config.set_max_connections_per_host(1);
+            std::vector<std::unique_ptr<client::http_client>> clients;
+            for (size_t i = 0; i < client_count; ++i)
+            {
+                clients.push_back(utility::details::make_unique<client::http_client>(m_uri, client_config));
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t round = 0; round < request_count / client_count; ++round)
+            {
+                std::vector<pplx::task<utility::string_t>> replies;
+                for (auto& client : clients)
+                {
+                    replies.push_back(client->request(methods::GET).then(
+                        [](web::http::http_response response) { return response.extract_string(); }));
+                }
+                for (auto& reply : replies)
+                {
+                    VERIFY_ARE_EQUAL(U("reply"), reply.get());
+                }
+            }
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << mode.name << ": " << static_cast<size_t>(request_count / elapsed.count()) << " requests/s"
+                      << std::endl;
+            listener.close().wait();
+        }
+    }
+
     TEST_FIXTURE(uri_address, create_https_listener_get, "Ignore", "github 209")
     {
         const char* self_signed_cert = R"(
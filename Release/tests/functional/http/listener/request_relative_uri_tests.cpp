@@ -136,6 +136,57 @@ SUITE(request_relative_uri_tests)
 
         listener.close().wait();
     }
+
+#if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
+    TEST_FIXTURE(uri_address, path_parameters)
+    {
+        // listen on /users/{id}/items and /users/me/items, the braces percent-encoded in the listener uri
+        http_listener items(web::http::uri_builder(m_uri).append_path(U("/users/{id}/items"), true).to_uri());
+        http_listener mine(web::http::uri_builder(m_uri).append_path(U("/users/me/items")).to_uri());
+        utility::string_t id, relative;
+        items.support([&](http_request request) {
+            VERIFY_ARE_EQUAL(1u, request.path_parameters().size());
+            id = request.path_parameters().at(U("id"));
+            relative = request.relative_uri().to_string();
+            request.reply(status_codes::OK).wait();
+        });
+        mine.support([](http_request request) {
+            VERIFY_IS_TRUE(request.path_parameters().empty());
+            request.reply(status_codes::Accepted).wait();
+        });
+        items.open().wait();
+        mine.open().wait();
+
+        // A second pattern differing only in the parameter name is a duplicate.
+        http_listener duplicate(web::http::uri_builder(m_uri).append_path(U("/users/{uid}/items"), true).to_uri());
+        VERIFY_THROWS(duplicate.open().wait(), std::invalid_argument);
+
+        test_http_client::scoped_client client(m_uri);
+        test_http_client* p_client = client.client();
+        auto request = [&](const utility::string_t& path, status_code expected) {
+            VERIFY_ARE_EQUAL(0, p_client->request(methods::GET, path));
+            p_client->next_response()
+                .then([=](test_response* p_response) {
+                    http_asserts::assert_test_response_equals(p_response, expected);
+                })
+                .wait();
+        };
+
+        request(U("/users/4%202/items/x"), status_codes::OK);
+        VERIFY_ARE_EQUAL(U("4 2"), id);
+        VERIFY_ARE_EQUAL(U("/x"), relative);
+        request(U("/users/me/items/x"), status_codes::Accepted);
+        request(U("/users/42"), status_codes::NotFound);
+
+        // Once a listener is closed, its requests go to the next longest listener path.
+        mine.close().wait();
+        request(U("/users/me/items"), status_codes::OK);
+        VERIFY_ARE_EQUAL(U("me"), id);
+        VERIFY_ARE_EQUAL(U("/"), relative);
+
+        items.close().wait();
+    }
+#endif
 }
 
 } // namespace listener
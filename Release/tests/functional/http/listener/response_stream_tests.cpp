@@ -119,6 +119,100 @@ SUITE(response_stream_tests)
         stream.close().get();
     }
 
+    TEST_FIXTURE(uri_address, set_body_filestream_ranges)
+    {
+        utility::string_t fname = U("set_response_stream_ranges.txt");
+        const size_t repetitions = 100000;
+        fill_file(fname, repetitions);
+        const size_t size = repetitions * 26;
+
+        http_listener listener(m_uri);
+        listener.open().wait();
+        test_http_client::scoped_client client(m_uri);
+        test_http_client* p_client = client.client();
+
+        listener.support([&](http_request request) {
+            auto stream = streams::file_stream<uint8_t>::open_istream(fname).get();
+            request.reply(status_codes::OK, stream, size, U("text/plain")).wait();
+            stream.close().wait();
+        });
+
+        // Returns the body, checking that each byte matches the file contents at its offset.
+        auto verify_body = [](test_response* p_response, size_t first) {
+            for (size_t i = 0; i < p_response->m_data.size(); ++i)
+            {
+                if (p_response->m_data[i] != static_cast<unsigned char>('a' + (first + i) % 26))
+                {
+                    VERIFY_IS_TRUE(false);
+                    break;
+                }
+            }
+        };
+
+        // Whole file
+        VERIFY_ARE_EQUAL(0u, p_client->request(methods::GET, U("")));
+        p_client->next_response()
+            .then([&](test_response* p_response) {
+                http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+                VERIFY_ARE_EQUAL(size, p_response->m_data.size());
+                VERIFY_ARE_EQUAL(U("bytes"), p_response->m_headers[header_names::accept_ranges]);
+                verify_body(p_response, 0);
+            })
+            .wait();
+
+        struct range_case
+        {
+            utility::string_t header;
+            status_code status;
+            size_t first;
+            size_t length;
+            utility::string_t content_range;
+        };
+        const range_case cases[] = {
+            {U("bytes=0-9"), status_codes::PartialContent, 0, 10, U("bytes 0-9/2600000")},
+            {U("bytes=1000000-"),
+             status_codes::PartialContent,
+             1000000,
+             size - 1000000,
+             U("bytes 1000000-2599999/2600000")},
+            {U("bytes=-26"), status_codes::PartialContent, size - 26, 26, U("bytes 2599974-2599999/2600000")},
+            {U("bytes=5-99999999"), status_codes::PartialContent, 5, size - 5, U("bytes 5-2599999/2600000")},
+            {U("bytes=2600000-"), status_codes::RangeNotSatisfiable, 0, 0, U("bytes */2600000")},
+            {U("bytes=0-9,20-29"), status_codes::OK, 0, size, U("")},
+            {U("items=0-9"), status_codes::OK, 0, size, U("")},
+            {U("bytes=9-0"), status_codes::OK, 0, size, U("")},
+        };
+        for (const auto& range : cases)
+        {
+            std::map<utility::string_t, utility::string_t> headers;
+            headers[header_names::range] = range.header;
+            VERIFY_ARE_EQUAL(0u, p_client->request(methods::GET, U(""), headers));
+            p_client->next_response()
+                .then([&](test_response* p_response) {
+                    http_asserts::assert_test_response_equals(p_response, range.status);
+                    VERIFY_ARE_EQUAL(range.length, p_response->m_data.size());
+                    utility::string_t content_range;
+                    p_response->match_header(header_names::content_range, content_range);
+                    VERIFY_ARE_EQUAL(range.content_range, content_range);
+                    verify_body(p_response, range.first);
+                })
+                .wait();
+        }
+
+        // A conditional range request gets the whole file.
+        std::map<utility::string_t, utility::string_t> headers;
+        headers[header_names::range] = U("bytes=0-9");
+        headers[header_names::if_range] = U("\"etag\"");
+        VERIFY_ARE_EQUAL(0u, p_client->request(methods::GET, U(""), headers));
+        p_client->next_response()
+            .then([&](test_response* p_response) {
+                http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+                VERIFY_ARE_EQUAL(size, p_response->m_data.size());
+            })
+            .wait();
+        listener.close().wait();
+    }
+
     TEST_FIXTURE(uri_address, set_body_stream_partial)
     {
         utility::string_t fname = U("set_response_stream_partial.txt");
@@ -242,6 +336,54 @@ SUITE(response_stream_tests)
             .wait();
     }
 
+    TEST_FIXTURE(uri_address, set_body_memorystream_with_length)
+    {
+        http_listener listener(m_uri);
+        listener.open().wait();
+        test_http_client::scoped_client client(m_uri);
+        test_http_client* p_client = client.client();
+
+        // A body of known length arriving in several blocks, some after the headers were sent.
+        const std::string text = "This is a test";
+        listener.support([&](http_request request) {
+            streams::producer_consumer_buffer<uint8_t> rwbuf;
+            http_response response(status_codes::OK);
+            response.set_body(rwbuf.create_istream(), text.size() * 3);
+
+            auto data = reinterpret_cast<const uint8_t*>(text.data());
+            rwbuf.putn_nocopy(data, text.size()).wait();
+            auto rep = request.reply(response);
+            os_utilities::sleep(100);
+            rwbuf.putn_nocopy(data, text.size()).wait();
+            rwbuf.putn_nocopy(data, text.size()).wait();
+            rwbuf.close(std::ios_base::out).wait();
+            rep.wait();
+        });
+        VERIFY_ARE_EQUAL(0u, p_client->request(methods::POST, U("")));
+        p_client->next_response()
+            .then([&](test_response* p_response) {
+                http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+                VERIFY_ARE_EQUAL(text + text + text, std::string(p_response->m_data.begin(), p_response->m_data.end()));
+            })
+            .wait();
+
+        // A large body held in memory.
+        std::string large(300 * 1024, 'x');
+        for (size_t i = 0; i < large.size(); i += 7)
+        {
+            large[i] = static_cast<char>('a' + i % 26);
+        }
+        listener.support([&](http_request request) { request.reply(status_codes::OK, large).wait(); });
+        VERIFY_ARE_EQUAL(0u, p_client->request(methods::GET, U("")));
+        p_client->next_response()
+            .then([&](test_response* p_response) {
+                http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+                VERIFY_IS_TRUE(large == std::string(p_response->m_data.begin(), p_response->m_data.end()));
+            })
+            .wait();
+        listener.close().wait();
+    }
+
     TEST_FIXTURE(uri_address, reply_transfer_encoding_4k)
     {
         web::http::experimental::listener::http_listener listener(m_uri);
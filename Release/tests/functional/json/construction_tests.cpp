@@ -549,6 +549,334 @@ SUITE(construction_tests)
         ::web::json::value::parse(_XPLATSTR(R"([ { "k1" : "v" }, { "k2" : "v" }, { "k3" : "v" }, { "k4" : "v" } ])"));
     }
 
+    TEST(in_place_values_move_and_swap)
+    {
+        const utility::string_t longString(100, U('x'));
+        std::vector<json::value> values;
+        values.push_back(json::value::null());
+        values.push_back(json::value::boolean(true));
+        values.push_back(json::value::number(42));
+        values.push_back(json::value::number(2.5));
+        values.push_back(json::value::string(U("short")));
+        values.push_back(json::value::string(longString));
+        values.push_back(json::value::parse(U("{\"a\":[1,\"b\"]}")));
+
+        // growing the vector moves every element into new storage
+        for (int i = 0; i < 100; ++i)
+        {
+            values.push_back(json::value::number(i));
+        }
+
+        VERIFY_IS_TRUE(values[0].is_null());
+        VERIFY_IS_TRUE(values[1].as_bool());
+        VERIFY_ARE_EQUAL(42, values[2].as_integer());
+        VERIFY_ARE_EQUAL(2.5, values[3].as_double());
+        VERIFY_ARE_EQUAL(U("short"), values[4].as_string());
+        VERIFY_ARE_EQUAL(longString, values[5].as_string());
+        VERIFY_ARE_EQUAL(U("b"), values[6].at(U("a")).at(1).as_string());
+
+        json::value copy = values[5];
+        VERIFY_ARE_EQUAL(values[5], copy);
+
+        json::value moved = std::move(copy);
+        VERIFY_ARE_EQUAL(longString, moved.as_string());
+
+        moved = values[6];
+        VERIFY_ARE_EQUAL(values[6], moved);
+
+        json::value other = json::value::string(U("other"));
+        other = std::move(moved);
+        VERIFY_ARE_EQUAL(values[6], other);
+        VERIFY_ARE_EQUAL(U("other"), moved.as_string());
+
+        std::swap(values[2], values[4]);
+        VERIFY_ARE_EQUAL(U("short"), values[2].as_string());
+        VERIFY_ARE_EQUAL(42, values[4].as_integer());
+    }
+
+    TEST(object_reference_survives_move)
+    {
+        json::value v = json::value::object();
+        json::object& obj = v.as_object();
+        json::value moved = std::move(v);
+
+        obj[U("key")] = json::value::number(1);
+        VERIFY_ARE_EQUAL(1, moved.at(U("key")).as_integer());
+    }
+
+    TEST(string_reference_survives_move)
+    {
+        std::vector<json::value> values;
+        values.push_back(json::value::string(U("short")));
+        const utility::string_t& str = values[0].as_string();
+
+        // growing the vector moves the value into new storage
+        for (int i = 0; i < 100; ++i)
+        {
+            values.push_back(json::value::number(i));
+        }
+
+        VERIFY_ARE_EQUAL(&str, &values[0].as_string());
+        VERIFY_ARE_EQUAL(U("short"), str);
+    }
+
+    TEST(strings_around_inline_capacity)
+    {
+        for (size_t length = 0; length < 40; ++length)
+        {
+            const utility::string_t str(length, U('a'));
+            const utility::string_t escaped = str + U("\"");
+            json::value v = json::value::string(str);
+            json::value e = json::value::string(escaped);
+
+            json::value copy = v;
+            json::value moved = std::move(copy);
+            VERIFY_ARE_EQUAL(str, moved.as_string());
+            VERIFY_ARE_EQUAL(U("\"") + str + U("\""), moved.serialize());
+            VERIFY_ARE_EQUAL(U("\"") + str + U("\\\"\""), e.serialize());
+
+            // copies of a string whose as_string() was already taken are independent of it
+            const utility::string_t& ref = e.as_string();
+            json::value copied = e;
+            VERIFY_ARE_EQUAL(escaped, copied.as_string());
+            VERIFY_ARE_NOT_EQUAL(&ref, &copied.as_string());
+            VERIFY_ARE_EQUAL(U("\"") + str + U("\\\"\""), copied.serialize());
+        }
+    }
+
+    // Checks every key of a large object, both through the index and by iterating.
+    void verify_large_object(const json::value& v, int count, bool keep_order)
+    {
+        const auto& obj = v.as_object();
+        VERIFY_ARE_EQUAL(static_cast<size_t>(count), obj.size());
+        for (int i = 0; i < count; ++i)
+        {
+            const auto key = U("id") + utility::conversions::details::to_string_t(i * 7919 % count);
+            VERIFY_IS_TRUE(v.has_field(key));
+            VERIFY_ARE_EQUAL(i * 7919 % count, obj.at(key).as_integer());
+            VERIFY_ARE_EQUAL(key, obj.find(key)->first);
+        }
+        VERIFY_IS_FALSE(v.has_field(U("missing")));
+        VERIFY_IS_TRUE(obj.find(U("missing")) == obj.end());
+
+        auto previous = obj.begin();
+        for (auto iter = std::next(obj.begin()); iter != obj.end(); previous = iter++)
+        {
+            if (keep_order)
+            {
+                VERIFY_IS_TRUE(iter->second.as_integer() > previous->second.as_integer());
+            }
+            else
+            {
+                VERIFY_IS_TRUE(previous->first < iter->first);
+            }
+        }
+    }
+
+    void build_large_object(bool keep_order)
+    {
+        json::value v = json::value::object(keep_order);
+        const int count = 2000;
+        for (int i = 0; i < count; ++i)
+        {
+            v[U("id") + utility::conversions::details::to_string_t(i)] = i;
+        }
+        verify_large_object(v, count, keep_order);
+
+        // Assigning to existing keys must not add elements.
+        v[U("id5")] = 5;
+        VERIFY_ARE_EQUAL(static_cast<size_t>(count), v.size());
+
+        // Erase all the odd keys, and check that the remaining ones are still found.
+        for (int i = 1; i < count; i += 2)
+        {
+            v.erase(U("id") + utility::conversions::details::to_string_t(i));
+        }
+        VERIFY_ARE_EQUAL(static_cast<size_t>(count / 2), v.size());
+        for (int i = 0; i < count; ++i)
+        {
+            VERIFY_ARE_EQUAL(i % 2 == 0, v.has_field(U("id") + utility::conversions::details::to_string_t(i)));
+        }
+
+        // Erase down past the index threshold, then grow again.
+        auto& obj = v.as_object();
+        while (obj.size() > 3)
+        {
+            obj.erase(obj.begin());
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            v[U("id") + utility::conversions::details::to_string_t(i)] = i;
+        }
+        VERIFY_ARE_EQUAL(static_cast<size_t>(count), v.size());
+        for (int i = 0; i < count; ++i)
+        {
+            VERIFY_ARE_EQUAL(i, v.at(U("id") + utility::conversions::details::to_string_t(i)).as_integer());
+        }
+    }
+
+    TEST(large_object_sorted) { build_large_object(false); }
+
+    TEST(large_object_keep_order) { build_large_object(true); }
+
+    TEST(large_object_from_fields)
+    {
+        const int count = 500;
+        std::vector<std::pair<string_t, json::value>> fields;
+        for (int i = 0; i < count; ++i)
+        {
+            fields.push_back(std::make_pair(U("id") + utility::conversions::details::to_string_t(i), json::value(i)));
+        }
+        verify_large_object(json::value::object(fields, true), count, true);
+        verify_large_object(json::value::object(fields, false), count, false);
+
+        // Copies keep a working index.
+        json::value copy = json::value::object(fields, true);
+        json::value other = copy;
+        other[U("extra")] = 1;
+        VERIFY_IS_FALSE(copy.has_field(U("extra")));
+        verify_large_object(copy, count, true);
+    }
+
+    TEST(large_object_parsed)
+    {
+        const int count = 300;
+        utility::string_t text = U("{");
+        for (int i = 0; i < count; ++i)
+        {
+            text += (i == 0 ? U("") : U(","));
+            text += U("\"id") + utility::conversions::details::to_string_t(i) + U("\":") +
+                    utility::conversions::details::to_string_t(i);
+        }
+        text += U("}");
+        verify_large_object(json::value::parse(text), count, false);
+    }
+
+    TEST(small_object_indexed)
+    {
+        json::value v = json::value::object(true);
+        v[U("b")] = 1;
+        v[U("a")] = 2;
+        auto& obj = v.as_object();
+        obj.set_indexed(true);
+        v[U("c")] = 3;
+        VERIFY_ARE_EQUAL(2, v.at(U("a")).as_integer());
+        VERIFY_ARE_EQUAL(3, v.at(U("c")).as_integer());
+        v.erase(U("b"));
+        VERIFY_IS_FALSE(v.has_field(U("b")));
+        VERIFY_ARE_EQUAL(U("a"), obj.begin()->first);
+        obj.set_indexed(false);
+        VERIFY_ARE_EQUAL(3, v.at(U("c")).as_integer());
+    }
+
+    TEST(large_object_built_key_by_key)
+    {
+        // Each insertion is followed by lookups, which must not rebuild or renumber the whole index every time.
+        const int count = 100000;
+        json::value v = json::value::object(true);
+        for (int i = 0; i < count; ++i)
+        {
+            v[U("id") + utility::conversions::details::to_string_t(i)] = i;
+            VERIFY_ARE_EQUAL(i / 2, v.at(U("id") + utility::conversions::details::to_string_t(i / 2)).as_integer());
+        }
+        verify_large_object(v, count, true);
+
+        // Sorted objects appended to in key order.
+        json::value sorted = json::value::object(false);
+        for (int i = 0; i < count; ++i)
+        {
+            utility::string_t key = utility::conversions::details::to_string_t(i);
+            key.insert(0, 8 - key.size(), U('0'));
+            sorted[key] = i;
+            VERIFY_IS_TRUE(sorted.has_field(key));
+        }
+        VERIFY_ARE_EQUAL(static_cast<size_t>(count), sorted.size());
+        VERIFY_ARE_EQUAL(count - 1, sorted.at(U("00099999")).as_integer());
+    }
+
+    TEST(indexed_object_iterated_mutably)
+    {
+        const int count = 1000;
+        for (int keep_order = 0; keep_order < 2; ++keep_order)
+        {
+            json::value v = json::value::object(keep_order != 0);
+            for (int i = 0; i < count; ++i)
+            {
+                v[U("id") + utility::conversions::details::to_string_t(i)] = i;
+            }
+
+            // Updating values through mutable iterators keeps every key reachable.
+            auto& obj = v.as_object();
+            for (auto& field : obj)
+            {
+                field.second = field.second.as_integer() + 1;
+            }
+            for (int i = 0; i < count; ++i)
+            {
+                const auto key = U("id") + utility::conversions::details::to_string_t(i);
+                VERIFY_ARE_EQUAL(i + 1, static_cast<const json::object&>(obj).at(key).as_integer());
+                VERIFY_ARE_EQUAL(i + 1, obj.at(key).as_integer());
+            }
+            VERIFY_IS_TRUE(obj.find(U("missing")) == obj.end());
+
+            // Erasing from the front moves every element.
+            for (int i = 0; i < count / 2; ++i)
+            {
+                obj.erase(obj.begin());
+            }
+            VERIFY_ARE_EQUAL(static_cast<size_t>(count / 2), obj.size());
+            for (auto iter = obj.cbegin(); iter != obj.cend(); ++iter)
+            {
+                VERIFY_ARE_EQUAL(iter->second.as_integer(), obj.at(iter->first).as_integer());
+            }
+        }
+    }
+
+    TEST(small_indexed_object_renamed_through_iterators)
+    {
+        json::value v = json::value::object(true);
+        auto& obj = v.as_object();
+        obj.set_indexed(true);
+        v[U("a")] = 1;
+        for (auto& field : obj)
+        {
+            field.second = 2;
+        }
+        v[U("b")] = 3;
+
+        // A renamed key is found after a mutable iteration; the old name is gone.
+        obj.begin()->first = U("c");
+        VERIFY_ARE_EQUAL(2, v.at(U("c")).as_integer());
+        VERIFY_IS_FALSE(v.has_field(U("a")));
+        VERIFY_ARE_EQUAL(3, v.at(U("b")).as_integer());
+    }
+
+    TEST(indexed_object_reordered_through_iterators)
+    {
+        const int count = 100;
+        json::value v = json::value::object(true);
+        for (int i = 0; i < count; ++i)
+        {
+            v[U("id") + utility::conversions::details::to_string_t(i)] = i;
+        }
+
+        auto& obj = v.as_object();
+        std::reverse(obj.begin(), obj.end());
+        std::swap(*obj.begin(), *(obj.begin() + 1));
+        obj.begin()->first = U("renamed");
+        for (int i = 0; i < count - 2; ++i)
+        {
+            VERIFY_ARE_EQUAL(i, v.at(U("id") + utility::conversions::details::to_string_t(i)).as_integer());
+        }
+        VERIFY_ARE_EQUAL(count - 2, v.at(U("renamed")).as_integer());
+        VERIFY_IS_FALSE(v.has_field(U("id") + utility::conversions::details::to_string_t(count - 2)));
+
+        // The next non-const lookup rebuilds the index.
+        v[U("extra")] = 0;
+        VERIFY_ARE_EQUAL(count - 1, v.at(U("id") + utility::conversions::details::to_string_t(count - 1)).as_integer());
+        VERIFY_ARE_EQUAL(count - 2, v.at(U("renamed")).as_integer());
+    }
+
 } // SUITE(construction_tests)
 
 } // namespace json_tests
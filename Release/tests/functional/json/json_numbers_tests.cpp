@@ -14,7 +14,9 @@
 #include "cpprest/json.h"
 #include "unittestpp.h"
 #include <clocale>
+#include <cstring>
 #include <iomanip>
+#include <random>
 
 using namespace web;
 using namespace utility;
@@ -317,6 +319,77 @@ SUITE(json_numbers_tests)
         VERIFY_ARE_EQUAL(json::value::parse(U("0")), json::value::parse(U("-0")));
     }
 
+    TEST(serialize_shortest_doubles)
+    {
+        VERIFY_ARE_EQUAL(U("0.1"), json::value(0.1).serialize());
+        VERIFY_ARE_EQUAL(U("0.3333333333333333"), json::value(1.0 / 3.0).serialize());
+        VERIFY_ARE_EQUAL(U("-123456.789"), json::value(-123456.789).serialize());
+        VERIFY_ARE_EQUAL(U("100"), json::value(100.0).serialize());
+        VERIFY_ARE_EQUAL(U("10000000000000000"), json::value(1e16).serialize());
+        VERIFY_ARE_EQUAL(U("1e+17"), json::value(1e17).serialize());
+        VERIFY_ARE_EQUAL(U("0.0001"), json::value(1e-4).serialize());
+        VERIFY_ARE_EQUAL(U("1.5e-05"), json::value(1.5e-5).serialize());
+        VERIFY_ARE_EQUAL(U("1.7976931348623157e+308"), json::value(std::numeric_limits<double>::max()).serialize());
+        VERIFY_ARE_EQUAL(U("5e-324"), json::value(std::numeric_limits<double>::denorm_min()).serialize());
+        VERIFY_ARE_EQUAL(U("-0"), json::value(-0.0).serialize());
+        VERIFY_ARE_EQUAL(U("0"), json::value(0.0).serialize());
+    }
+
+    TEST(doubles_round_trip)
+    {
+        std::mt19937_64 random(42);
+        for (int i = 0; i < 100000; ++i)
+        {
+            const uint64_t bits = random();
+            double d;
+            memcpy(&d, &bits, sizeof(d));
+            if (d != d || d - d != 0.0)
+            {
+                continue;
+            }
+
+            const auto str = json::value(d).serialize();
+            const double parsed = json::value::parse(str).as_double();
+            VERIFY_ARE_EQUAL(0, memcmp(&d, &parsed, sizeof(d)));
+            if (memcmp(&d, &parsed, sizeof(d)) != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    TEST(parse_doubles_like_strtod)
+    {
+        // Short literals take the exact fast path, long ones go through strtod; both must agree with strtod.
+        std::mt19937 random(7);
+        for (int i = 0; i < 100000; ++i)
+        {
+            std::string literal = std::to_string(random() % 100000);
+            const int fraction = random() % 20;
+            if (fraction != 0)
+            {
+                literal += '.';
+                for (int j = 0; j < fraction; ++j)
+                {
+                    literal += static_cast<char>('0' + random() % 10);
+                }
+            }
+            if (random() % 2 == 0)
+            {
+                literal += 'e';
+                literal += std::to_string(static_cast<int>(random() % 61) - 30);
+            }
+
+            const double expected = strtod(literal.c_str(), nullptr);
+            const double parsed = json::value::parse(utility::conversions::to_string_t(literal)).as_double();
+            VERIFY_ARE_EQUAL(expected, parsed);
+            if (expected != parsed)
+            {
+                break;
+            }
+        }
+    }
+
 } // SUITE(json_numbers_tests)
 
 } // namespace json_tests
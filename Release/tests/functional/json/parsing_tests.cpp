@@ -936,6 +936,138 @@ SUITE(parsing_tests)
         VERIFY_ARE_EQUAL(3, count); // Update this accordingly, if the number of items changes
     }
 
+    TEST(long_strings)
+    {
+        // Place quotes, escapes and control characters at every offset within a block of the string scanner.
+        for (size_t prefix = 0; prefix < 40; ++prefix)
+        {
+            const utility::string_t plain(prefix, U('a'));
+
+            auto v = json::value::parse(U("\"") + plain + U("\""));
+            VERIFY_ARE_EQUAL(plain, v.as_string());
+
+            v = json::value::parse(U("\"") + plain + U("\\\"") + plain + U("\\\\\""));
+            VERIFY_ARE_EQUAL(plain + U("\"") + plain + U("\\"), v.as_string());
+
+            v = json::value::parse(U("[\"") + plain + U("\\u00e9") + plain + U("\",\"") + plain + U("\"]"));
+            VERIFY_ARE_EQUAL(json::value::string(plain + utility::conversions::to_string_t("\xc3\xa9") + plain),
+                             v.at(0));
+            VERIFY_ARE_EQUAL(plain, v.at(1).as_string());
+
+            VERIFY_THROWS(json::value::parse(U("\"") + plain + U("\t") + plain + U("\"")), json::json_exception);
+            VERIFY_THROWS(json::value::parse(U("\"") + plain), json::json_exception);
+        }
+
+        // Bytes with the high bit set are ordinary string characters.
+        const std::string utf8 = "\"\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e \xc3\xa9\xc3\xa8\xc3\xaa \xf0\x9f\x98\x80 abcdefgh\"";
+        VERIFY_ARE_EQUAL(json::value::string(utility::conversions::to_string_t(utf8.substr(1, utf8.size() - 2))),
+                         json::value::parse(utility::conversions::to_string_t(utf8)));
+    }
+
+    TEST(long_whitespace_runs)
+    {
+        const utility::string_t indent(37, U(' '));
+        auto v = json::value::parse(U("{\n") + indent + U("\"a\" :") + indent + U("[\n") + indent + U("1,\t") + indent +
+                                    U("2\r\n") + indent + U("]\n") + indent + U("}") + indent);
+        VERIFY_ARE_EQUAL(2u, v.at(U("a")).size());
+        VERIFY_ARE_EQUAL(2, v.at(U("a")).at(1).as_integer());
+
+        // Errors still report the position of the offending token.
+        try
+        {
+            json::value::parse(U("{\n") + indent + U("\"a\": x}"));
+            VERIFY_IS_TRUE(false);
+        }
+        catch (const json::json_exception& e)
+        {
+            VERIFY_ARE_EQUAL(0, std::string(e.what()).find("* Line 2, Column 43 "));
+        }
+    }
+
+    TEST(document_matches_value)
+    {
+        auto doc = json::document::parse(youtubeJson);
+        VERIFY_ARE_EQUAL(json::value::parse(youtubeJson), doc.root().to_value());
+
+        utility::stringstream_t stream(youtubeJson);
+        auto streamed = json::document::parse(stream);
+        VERIFY_ARE_EQUAL(doc.root().to_value(), streamed.root().to_value());
+
+        auto items = doc.root().at(U("items"));
+        VERIFY_IS_TRUE(items.is_array());
+        VERIFY_ARE_EQUAL(3u, items.size());
+        auto thumbnail = items.at(0).at(U("snippet")).at(U("thumbnails")).at(U("default"));
+        VERIFY_ARE_EQUAL(U("https://i.ytimg.com/vi/mvDDHxBrwU8/default.jpg"), thumbnail.at(U("url")).as_string());
+        VERIFY_ARE_EQUAL(120, thumbnail.at(U("width")).as_integer());
+        VERIFY_IS_TRUE(thumbnail.has_field(U("height")));
+        VERIFY_IS_FALSE(thumbnail.has_field(U("depth")));
+    }
+
+    TEST(document_accessors)
+    {
+        auto doc = json::document::parse(
+            U(R"({"b": true, "a": [1, -2, 18446744073709551615, 2.5, null, "xéy", ""], "c": {}})"));
+        auto root = doc.root();
+        VERIFY_IS_TRUE(root.is_object());
+        VERIFY_ARE_EQUAL(3u, root.size());
+        VERIFY_ARE_EQUAL(U("a"), root.field_name(0));
+        VERIFY_ARE_EQUAL(U("c"), root.field_name(2));
+        VERIFY_IS_TRUE(root.field_value(1).as_bool());
+        VERIFY_IS_TRUE(root.at(U("c")).is_object());
+        VERIFY_ARE_EQUAL(0u, root.at(U("c")).size());
+
+        auto a = root.at(U("a"));
+        VERIFY_ARE_EQUAL(7u, a.size());
+        VERIFY_IS_TRUE(a.at(0).is_integer());
+        VERIFY_ARE_EQUAL(1, a.at(0).as_integer());
+        VERIFY_ARE_EQUAL(-2, a.at(1).as_number().to_int64());
+        VERIFY_ARE_EQUAL(18446744073709551615ULL, a.at(2).as_number().to_uint64());
+        VERIFY_IS_TRUE(a.at(3).is_double());
+        VERIFY_ARE_EQUAL(2.5, a.at(3).as_double());
+        VERIFY_IS_TRUE(a.at(4).is_null());
+        VERIFY_ARE_EQUAL(json::value::parse(U(R"("xéy")")).as_string(), a.at(5).as_string());
+        VERIFY_ARE_EQUAL(U(""), a.at(6).as_string());
+
+        VERIFY_THROWS(root.at(U("d")), json::json_exception);
+        VERIFY_THROWS(a.at(7), json::json_exception);
+        VERIFY_THROWS(a.as_string(), json::json_exception);
+        VERIFY_THROWS(root.at(U("b")).as_integer(), json::json_exception);
+    }
+
+    TEST(document_keep_order)
+    {
+        json::keep_object_element_order(true);
+        auto doc = json::document::parse(U(R"({"z": 1, "a": 2, "m": 3})"));
+        json::keep_object_element_order(false);
+
+        auto root = doc.root();
+        VERIFY_ARE_EQUAL(U("z"), root.field_name(0));
+        VERIFY_ARE_EQUAL(U("m"), root.field_name(2));
+        VERIFY_ARE_EQUAL(2, root.at(U("a")).as_integer());
+    }
+
+    TEST(document_parse_failed)
+    {
+        VERIFY_THROWS(json::document::parse(U("{\"a\": [1, 2}")), json::json_exception);
+        VERIFY_THROWS(json::document::parse(U("[] x")), json::json_exception);
+
+        std::error_code err;
+        auto doc = json::document::parse(U("{\"a\": [1, 2}"), err);
+        VERIFY_IS_TRUE(err.value() > 0);
+        VERIFY_IS_TRUE(doc.root().is_null());
+
+        utility::stringstream_t stream(U("[1, 2] 3"));
+        doc = json::document::parse(stream, err);
+        VERIFY_IS_TRUE(err.value() > 0);
+        VERIFY_IS_TRUE(doc.root().is_null());
+
+        doc = json::document::parse(U("[1, 2]"), err);
+        VERIFY_ARE_EQUAL(0, err.value());
+        json::document moved(std::move(doc));
+        VERIFY_ARE_EQUAL(2u, moved.root().size());
+        VERIFY_IS_TRUE(doc.root().is_null());
+    }
+
 } // SUITE(parsing_tests)
 
 } // namespace json_tests
@@ -0,0 +1,263 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * reader_tests.cpp
+ *
+ * Tests for the event based JSON reader
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "cpprest/containerstream.h"
+#include "cpprest/json_reader.h"
+#include "cpprest/producerconsumerstream.h"
+#include "unittestpp.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace web;
+using namespace utility;
+using namespace concurrency::streams;
+
+namespace tests
+{
+namespace functional
+{
+namespace json_tests
+{
+SUITE(reader_tests)
+{
+    // Records every event as a short string.
+    class recording_handler : public json::reader_handler
+    {
+    public:
+        recording_handler() : m_values(0) {}
+
+        virtual void start_object() { m_events.push_back(U("{")); }
+        virtual void key(const utility::string_t& name) { m_events.push_back(U("key:") + name); }
+        virtual void end_object() { m_events.push_back(U("}")); }
+        virtual void start_array() { m_events.push_back(U("[")); }
+        virtual void end_array() { m_events.push_back(U("]")); }
+        virtual void value(const json::value& value)
+        {
+            m_events.push_back(value.serialize());
+            ++m_values;
+        }
+
+        std::vector<utility::string_t> m_events;
+        std::atomic<int> m_values;
+    };
+
+    std::shared_ptr<recording_handler> parse(const std::string& text)
+    {
+        auto handler = std::make_shared<recording_handler>();
+        json::parse_events(bytestream::open_istream(text), handler).wait();
+        return handler;
+    }
+
+    TEST(events_in_document_order)
+    {
+        auto handler = parse(R"( {"a": [1, -2.5, true, null, "x\ty"], "b": {}, "c": []} )");
+        const std::vector<utility::string_t> expected = {U("{"),
+                                                         U("key:a"),
+                                                         U("["),
+                                                         U("1"),
+                                                         U("-2.5"),
+                                                         U("true"),
+                                                         U("null"),
+                                                         U("\"x\\ty\""),
+                                                         U("]"),
+                                                         U("key:b"),
+                                                         U("{"),
+                                                         U("}"),
+                                                         U("key:c"),
+                                                         U("["),
+                                                         U("]"),
+                                                         U("}")};
+        VERIFY_ARE_EQUAL(expected.size(), handler->m_events.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(expected[i], handler->m_events[i]);
+        }
+    }
+
+    TEST(scalar_document)
+    {
+        auto handler = parse("\"\xc3\xa9\"");
+        VERIFY_ARE_EQUAL(1u, handler->m_events.size());
+        VERIFY_ARE_EQUAL(json::value::string(utility::conversions::to_string_t("\xc3\xa9")).serialize(),
+                         handler->m_events[0]);
+    }
+
+    TEST(large_array)
+    {
+        std::string text = "[";
+        for (int i = 0; i < 10000; ++i)
+        {
+            text += (i == 0 ? "" : ",\n  ");
+            text += "{\"id\": " + std::to_string(i) + ", \"name\": \"item\"}";
+        }
+        text += "]";
+
+        auto handler = parse(text);
+        VERIFY_ARE_EQUAL(20000, handler->m_values.load());
+        VERIFY_ARE_EQUAL(U("key:id"), handler->m_events[2]);
+        VERIFY_ARE_EQUAL(U("9999"), handler->m_events[handler->m_events.size() - 5]);
+    }
+
+    TEST(malformed_input)
+    {
+        const char* inputs[] = {"[1, 2", "[1 2]", "{\"a\" 1}", "{1: 2}", "[1,]", "[] []", ""};
+        for (auto input : inputs)
+        {
+            auto handler = std::make_shared<recording_handler>();
+            VERIFY_THROWS(json::parse_events(bytestream::open_istream(std::string(input)), handler).get(),
+                          json::json_exception);
+        }
+    }
+
+    TEST(handler_exception_stops_parse)
+    {
+        class throwing_handler : public json::reader_handler
+        {
+        public:
+            virtual void value(const json::value&) { throw std::runtime_error("stop"); }
+        };
+
+        VERIFY_THROWS(json::parse_events(bytestream::open_istream(std::string("[1, 2]")),
+                                         std::make_shared<throwing_handler>())
+                          .get(),
+                      std::runtime_error);
+    }
+
+    TEST(events_before_input_completes)
+    {
+        producer_consumer_buffer<uint8_t> buffer;
+        auto handler = std::make_shared<recording_handler>();
+        auto done = json::parse_events(buffer.create_istream(), handler);
+
+        const std::string first = "[10, 20, ";
+        buffer.putn_nocopy(reinterpret_cast<const uint8_t*>(first.data()), first.size()).wait();
+        buffer.sync().wait();
+
+        // The first elements are reported while the rest of the array has not been written yet.
+        for (int i = 0; i < 500 && handler->m_values.load() < 2; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        VERIFY_ARE_EQUAL(2, handler->m_values.load());
+        VERIFY_IS_FALSE(done.is_done());
+
+        const std::string rest = "30]";
+        buffer.putn_nocopy(reinterpret_cast<const uint8_t*>(rest.data()), rest.size()).wait();
+        buffer.close(std::ios_base::out).wait();
+        done.wait();
+
+        VERIFY_ARE_EQUAL(3, handler->m_values.load());
+        VERIFY_ARE_EQUAL(U("]"), handler->m_events.back());
+    }
+
+    TEST(tokens_split_across_chunks)
+    {
+        producer_consumer_buffer<uint8_t> buffer;
+        auto handler = std::make_shared<recording_handler>();
+        auto done = json::parse_events(buffer.create_istream(), handler);
+
+        // Every byte is flushed on its own, so that each token is split wherever possible.
+        const std::string text = "/* c */ {\"k\\\"1\": [12.5e1, \"\\u00e9\\\\\", false] // c\n, \"k2\": null}";
+        for (char ch : text)
+        {
+            buffer.putc(static_cast<uint8_t>(ch)).wait();
+            buffer.sync().wait();
+        }
+        buffer.close(std::ios_base::out).wait();
+        done.wait();
+
+        const std::vector<utility::string_t> expected = {U("{"),
+                                                         U("key:k\"1"),
+                                                         U("["),
+                                                         U("125"),
+                                                         json::value::string(U("\u00e9\\")).serialize(),
+                                                         U("false"),
+                                                         U("]"),
+                                                         U("key:k2"),
+                                                         U("null"),
+                                                         U("}")};
+        VERIFY_ARE_EQUAL(expected.size(), handler->m_events.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(expected[i], handler->m_events[i]);
+        }
+    }
+
+    TEST(errors_report_stream_positions)
+    {
+        const std::string text = "[1,\n  2,\n  x]";
+        std::string expected;
+        try
+        {
+            json::value::parse(utility::conversions::to_string_t(text));
+        }
+        catch (const json::json_exception& e)
+        {
+            expected = e.what();
+        }
+        VERIFY_IS_FALSE(expected.empty());
+
+        // The position is the same as for a whole string, even though the input arrives one byte at a time.
+        producer_consumer_buffer<uint8_t> buffer;
+        auto done = json::parse_events(buffer.create_istream(), std::make_shared<recording_handler>());
+        for (char ch : text)
+        {
+            buffer.putc(static_cast<uint8_t>(ch)).wait();
+            buffer.sync().wait();
+        }
+        buffer.close(std::ios_base::out).wait();
+
+        std::string actual;
+        try
+        {
+            done.get();
+        }
+        catch (const json::json_exception& e)
+        {
+            actual = e.what();
+        }
+        VERIFY_ARE_EQUAL(expected, actual);
+    }
+
+    TEST(waiting_parses_hold_no_threads)
+    {
+        // More parses than the thread pool has threads wait for input that is only written by pool tasks.
+        const size_t count = 200;
+        std::vector<producer_consumer_buffer<uint8_t>> buffers(count);
+        std::vector<pplx::task<void>> parses;
+        for (auto& buffer : buffers)
+        {
+            parses.push_back(json::parse_events(buffer.create_istream(), std::make_shared<recording_handler>()));
+        }
+
+        std::vector<pplx::task<void>> writes;
+        for (auto& buffer : buffers)
+        {
+            writes.push_back(pplx::create_task([buffer] {
+                const std::string text = "[1, 2]";
+                producer_consumer_buffer<uint8_t> target(buffer);
+                target.putn_nocopy(reinterpret_cast<const uint8_t*>(text.data()), text.size()).wait();
+                target.close(std::ios_base::out).wait();
+            }));
+        }
+
+        pplx::when_all(writes.begin(), writes.end()).wait();
+        pplx::when_all(parses.begin(), parses.end()).wait();
+    }
+
+} // SUITE(reader_tests)
+
+} // namespace json_tests
+} // namespace functional
+} // namespace tests
@@ -0,0 +1,128 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * writer_tests.cpp
+ *
+ * Tests for the streaming JSON writer
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "cpprest/containerstream.h"
+#include "cpprest/json_writer.h"
+#include "cpprest/producerconsumerstream.h"
+#include "unittestpp.h"
+
+using namespace web;
+using namespace utility;
+using namespace concurrency::streams;
+
+namespace tests
+{
+namespace functional
+{
+namespace json_tests
+{
+SUITE(writer_tests)
+{
+    TEST(events)
+    {
+        container_buffer<std::string> buffer;
+        json::writer writer(buffer);
+        writer.begin_object();
+        writer.key(U("a"));
+        writer.begin_array();
+        writer.value(json::value::number(1));
+        writer.value(json::value::string(U("x\"y")));
+        writer.begin_object();
+        writer.end_object();
+        writer.end_array();
+        writer.key(U("b"));
+        writer.value(json::value::null());
+        writer.end_object();
+        writer.flush().wait();
+
+        VERIFY_ARE_EQUAL("{\"a\":[1,\"x\\\"y\",{}],\"b\":null}", buffer.collection());
+    }
+
+    TEST(dom_matches_serialize)
+    {
+        auto value = json::value::parse(
+            U(R"({"name": "café", "list": [1, 2.5, -3, true, false, null, [], {}], "nested": {"k": "\t"}})"));
+
+        container_buffer<std::string> buffer;
+        json::writer writer(buffer, 8);
+        writer.value(value);
+        writer.flush().wait();
+
+        VERIFY_ARE_EQUAL(utility::conversions::to_utf8string(value.serialize()), buffer.collection());
+    }
+
+    TEST(writes_full_chunks_before_flush)
+    {
+        producer_consumer_buffer<uint8_t> buffer;
+        json::writer writer(buffer, 64);
+
+        writer.begin_array();
+        for (int i = 0; i < 100; ++i)
+        {
+            writer.value(json::value::string(U("0123456789")));
+        }
+
+        // Everything but the last partial chunk is already readable.
+        const size_t total = 1 + 100 * 13 - 1;
+        VERIFY_ARE_EQUAL(total - total % 64, buffer.in_avail());
+
+        writer.end_array();
+        writer.flush().wait();
+        VERIFY_ARE_EQUAL(total + 1, buffer.in_avail());
+    }
+
+    TEST(large_value_spans_many_chunks)
+    {
+        const utility::string_t text(100000, U('x'));
+        producer_consumer_buffer<uint8_t> buffer;
+        json::writer writer(buffer, 16);
+        writer.begin_array();
+        writer.value(json::value::string(text));
+        writer.value(json::value::number(7));
+
+        // All full chunks of the long string are readable, in order, before the rest is flushed.
+        const size_t total = 1 + (text.size() + 2) + 2;
+        VERIFY_ARE_EQUAL(total - total % 16, buffer.in_avail());
+
+        writer.end_array();
+        writer.flush().wait();
+        std::string output(total + 1, '\0');
+        VERIFY_ARE_EQUAL(output.size(), buffer.getn(reinterpret_cast<uint8_t*>(&output[0]), output.size()).get());
+        VERIFY_ARE_EQUAL("[\"" + std::string(text.size(), 'x') + "\",7]", output);
+    }
+
+    TEST(misuse_throws)
+    {
+        container_buffer<std::string> buffer;
+        {
+            json::writer writer(buffer);
+            writer.begin_object();
+            VERIFY_THROWS(writer.value(json::value::number(1)), json::json_exception);
+            VERIFY_THROWS(writer.end_array(), json::json_exception);
+            writer.key(U("a"));
+            VERIFY_THROWS(writer.key(U("b")), json::json_exception);
+            VERIFY_THROWS(writer.end_object(), json::json_exception);
+        }
+        {
+            json::writer writer(buffer);
+            writer.value(json::value::number(1));
+            VERIFY_THROWS(writer.begin_array(), json::json_exception);
+            VERIFY_THROWS(writer.key(U("a")), json::json_exception);
+        }
+    }
+
+} // SUITE(writer_tests)
+
+} // namespace json_tests
+} // namespace functional
+} // namespace tests
@@ -0,0 +1,126 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * Tests for the work stealing pplx scheduler.
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "stdafx.h"
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+namespace tests
+{
+namespace functional
+{
+namespace PPLX
+{
+SUITE(pplx_scheduler_tests)
+{
+    TEST(work_stealing_runs_continuation_chain)
+    {
+        auto sched = std::make_shared<pplx::details::work_stealing_scheduler>(4);
+        VERIFY_ARE_EQUAL(4u, sched->thread_count());
+
+        auto t = pplx::create_task([] { return 0; }, pplx::task_options(sched));
+        for (int i = 0; i < 10000; ++i)
+        {
+            t = t.then([](int n) { return n + 1; });
+        }
+
+        VERIFY_ARE_EQUAL(10000, t.get());
+    }
+
+    TEST(work_stealing_runs_fan_out)
+    {
+        auto sched = std::make_shared<pplx::details::work_stealing_scheduler>(4);
+        std::atomic<int> count(0);
+
+        // the outer tasks schedule from the worker threads, so the inner tasks land in worker queues and get stolen
+        std::vector<pplx::task<void>> outer;
+        for (int i = 0; i < 64; ++i)
+        {
+            outer.push_back(pplx::create_task(
+                [&count, sched] {
+                    std::vector<pplx::task<void>> inner;
+                    for (int j = 0; j < 64; ++j)
+                    {
+                        inner.push_back(pplx::create_task([&count] { ++count; }, pplx::task_options(sched)));
+                    }
+                    return pplx::when_all(inner.begin(), inner.end());
+                },
+                pplx::task_options(sched)));
+        }
+
+        pplx::when_all(outer.begin(), outer.end()).wait();
+        VERIFY_ARE_EQUAL(64 * 64, count.load());
+    }
+
+    TEST(work_stealing_blocked_worker)
+    {
+        // the continuation lands in the LIFO slot of a worker that then blocks; another worker has to steal it
+        auto sched = std::make_shared<pplx::details::work_stealing_scheduler>(2);
+        pplx::task_completion_event<void> tce;
+        pplx::task<void> continuation;
+
+        pplx::create_task(
+            [&] {
+                continuation = pplx::create_task([&tce] { tce.set(); }, pplx::task_options(sched));
+                pplx::create_task(tce).wait();
+            },
+            pplx::task_options(sched))
+            .wait();
+
+        continuation.wait();
+    }
+
+    TEST(work_stealing_destructor_drains)
+    {
+        std::atomic<int> count(0);
+        {
+            pplx::details::work_stealing_scheduler sched(2);
+            for (int i = 0; i < 1000; ++i)
+            {
+                sched.schedule([](void* param) { ++*static_cast<std::atomic<int>*>(param); }, &count);
+            }
+        }
+
+        VERIFY_ARE_EQUAL(1000, count.load());
+    }
+
+    TEST(work_stealing_continuations_inherit_scheduler)
+    {
+        auto sched = std::make_shared<pplx::details::work_stealing_scheduler>(2);
+        pplx::task_options options(sched);
+
+        auto t = pplx::create_task([] {}, options).then([] {});
+        VERIFY_ARE_EQUAL(sched.get(), t.scheduler().get());
+        t.wait();
+    }
+
+    TEST(work_stealing_released_from_own_task)
+    {
+        pplx::task_completion_event<void> done;
+        {
+            // the task holds a reference to the scheduler, so the last one may be dropped on a worker thread
+            auto sched = std::make_shared<pplx::details::work_stealing_scheduler>(2);
+            pplx::create_task([done] { done.set(); }, pplx::task_options(sched));
+        }
+
+        VERIFY_ARE_EQUAL(pplx::completed, pplx::create_task(done).wait());
+    }
+
+} // SUITE(pplx_scheduler_tests)
+} // namespace PPLX
+} // namespace functional
+} // namespace tests
+
+#endif
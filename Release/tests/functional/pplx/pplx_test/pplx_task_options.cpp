@@ -11,6 +11,9 @@
 
 #include "stdafx.h"
 
+#include <atomic>
+#include <thread>
+
 #if (defined(_MSC_VER) && (_MSC_VER >= 1800)) && !CPPREST_FORCE_PPLX
 // Dev12 doesn't have an in-box ambient scheduler, since all tasks execute on ConcRT.
 // Therefore, we need to provide one. A scheduler that directly executes a functor given to it is
@@ -441,6 +444,67 @@ SUITE(pplx_task_options_tests)
         ev.wait();
     }
 
+    TEST(synchronous_continuation_on_completed_task)
+    {
+        const auto caller = std::this_thread::get_id();
+        std::thread::id runner;
+
+        auto t = pplx::task_from_result().then([&runner]() { runner = std::this_thread::get_id(); },
+                                               pplx::task_continuation_context::use_synchronous_execution());
+
+        VERIFY_IS_TRUE(t.is_done());
+        VERIFY_IS_TRUE(caller == runner);
+    }
+
+    TEST(synchronous_continuation_runs_on_completing_thread)
+    {
+        pplx::task_completion_event<int> tce;
+        std::thread::id runner;
+
+        auto t = pplx::create_task(tce).then(
+            [&runner](int n) {
+                runner = std::this_thread::get_id();
+                return n + 1;
+            },
+            pplx::task_continuation_context::use_synchronous_execution());
+
+        tce.set(41);
+
+        VERIFY_IS_TRUE(t.is_done());
+        VERIFY_IS_TRUE(std::this_thread::get_id() == runner);
+        VERIFY_ARE_EQUAL(42, t.get());
+    }
+
+    TEST(synchronous_continuation_depth_bounded)
+    {
+        pplx::task_completion_event<int> tce;
+        const auto caller = std::this_thread::get_id();
+        std::atomic<int> inlined(0);
+
+        auto t = pplx::create_task(tce);
+        for (int i = 0; i < 1000; ++i)
+        {
+            t = t.then(
+                [caller, &inlined](int n) {
+                    if (std::this_thread::get_id() == caller)
+                    {
+                        ++inlined;
+                    }
+                    return n + 1;
+                },
+                pplx::task_continuation_context::use_synchronous_execution());
+        }
+
+        tce.set(0);
+
+        VERIFY_ARE_EQUAL(1000, t.get());
+#if defined(PPLX_MAX_INLINE_CONTINUATION_DEPTH)
+        VERIFY_ARE_EQUAL(PPLX_MAX_INLINE_CONTINUATION_DEPTH, inlined.load());
+#else
+        VERIFY_IS_TRUE(inlined.load() > 0);
+#endif
+    }
+
 } // SUITE(pplx_task_options_tests)
 } // namespace PPLX
 } // namespace functional